@@ -111,6 +111,9 @@ public:
     void *getAddr() { return m_ref.code().executableAddress(); }
 #endif
 
+    void *get16BitCodeAddr() { return m_ref16.code().executableAddress(); }
+    size_t get16BitCodeSize() { return m_ref16.size(); }
+
     void clear()
     {
         m_ref8 = MacroAssemblerCodeRef();
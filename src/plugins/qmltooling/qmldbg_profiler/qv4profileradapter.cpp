@@ -43,7 +43,7 @@
 QT_BEGIN_NAMESPACE
 
 QV4ProfilerAdapter::QV4ProfilerAdapter(QQmlProfilerService *service, QV4::ExecutionEngine *engine) :
-    m_functionCallPos(0), m_memoryPos(0)
+    m_functionCallPos(0), m_memoryPos(0), m_allocationStatisticsPos(0)
 {
     setService(service);
     engine->setProfiler(new QV4::Profiling::Profiler(engine));
@@ -73,15 +73,34 @@ qint64 QV4ProfilerAdapter::appendMemoryEvents(qint64 until, QList<QByteArray> &m
 {
     // Make it const, so that we cannot accidentally detach it.
     const QVector<QV4::Profiling::MemoryAllocationProperties> &memoryData = m_memoryData;
+    const QVector<QV4::Profiling::AllocationStatisticsProperties> &statistics =
+            m_allocationStatistics;
 
-    while (memoryData.length() > m_memoryPos && memoryData[m_memoryPos].timestamp <= until) {
-        const QV4::Profiling::MemoryAllocationProperties &props = memoryData[m_memoryPos];
-        d << props.timestamp << int(MemoryAllocation) << int(props.type) << props.size;
-        ++m_memoryPos;
+    while (true) {
+        const qint64 memoryNext = memoryData.length() == m_memoryPos
+                ? -1 : memoryData[m_memoryPos].timestamp;
+        const qint64 statisticsNext = statistics.length() == m_allocationStatisticsPos
+                ? -1 : statistics[m_allocationStatisticsPos].timestamp;
+        if (statisticsNext != -1 && statisticsNext <= until
+                && (memoryNext == -1 || statisticsNext < memoryNext)) {
+            const QV4::Profiling::AllocationStatisticsProperties &props =
+                    statistics[m_allocationStatisticsPos];
+            d << props.timestamp << int(AllocationStatistics) << int(props.type)
+              << props.name << props.file << props.line << props.allocations << props.bytes
+              << props.survivors << props.survivedBytes;
+            ++m_allocationStatisticsPos;
+        } else if (memoryNext != -1 && memoryNext <= until) {
+            const QV4::Profiling::MemoryAllocationProperties &props = memoryData[m_memoryPos];
+            d << props.timestamp << int(MemoryAllocation) << int(props.type) << props.size;
+            ++m_memoryPos;
+        } else if (memoryNext == -1) {
+            return statisticsNext;
+        } else {
+            return statisticsNext == -1 ? memoryNext : qMin(memoryNext, statisticsNext);
+        }
         messages.append(d.squeezedData());
         d.clear();
     }
-    return memoryData.length() == m_memoryPos ? -1 : memoryData[m_memoryPos].timestamp;
 }
 
 qint64 QV4ProfilerAdapter::finalizeMessages(qint64 until, QList<QByteArray> &messages,
@@ -98,6 +117,8 @@ qint64 QV4ProfilerAdapter::finalizeMessages(qint64 until, QList<QByteArray> &mes
     if (memoryNext == -1) {
         m_memoryData.clear();
         m_memoryPos = 0;
+        m_allocationStatistics.clear();
+        m_allocationStatisticsPos = 0;
         return callNext;
     }
 
@@ -166,7 +187,8 @@ qint64 QV4ProfilerAdapter::sendMessages(qint64 until, QList<QByteArray> &message
 void QV4ProfilerAdapter::receiveData(
         const QV4::Profiling::FunctionLocationHash &locations,
         const QVector<QV4::Profiling::FunctionCallProperties> &functionCallData,
-        const QVector<QV4::Profiling::MemoryAllocationProperties> &memoryData)
+        const QVector<QV4::Profiling::MemoryAllocationProperties> &memoryData,
+        const QVector<QV4::Profiling::AllocationStatisticsProperties> &allocationStatistics)
 {
     // In rare cases it could be that another flush or stop event is processed while data from
     // the previous one is still pending. In that case we just append the data.
@@ -185,6 +207,11 @@ void QV4ProfilerAdapter::receiveData(
     else
         m_memoryData.append(memoryData);
 
+    if (m_allocationStatistics.isEmpty())
+        m_allocationStatistics = allocationStatistics;
+    else
+        m_allocationStatistics.append(allocationStatistics);
+
     service->dataReady(this);
 }
 
@@ -196,6 +223,8 @@ quint64 QV4ProfilerAdapter::translateFeatures(quint64 qmlFeatures)
         v4Features |= (one << QV4::Profiling::FeatureFunctionCall);
     if (qmlFeatures & (one << ProfileMemory))
         v4Features |= (one << QV4::Profiling::FeatureMemoryAllocation);
+    if (qmlFeatures & (one << ProfileAllocationStatistics))
+        v4Features |= (one << QV4::Profiling::FeatureAllocationStatistics);
     return v4Features;
 }
 
@@ -72,7 +72,8 @@ public:
 
     void receiveData(const QV4::Profiling::FunctionLocationHash &,
                      const QVector<QV4::Profiling::FunctionCallProperties> &,
-                     const QVector<QV4::Profiling::MemoryAllocationProperties> &);
+                     const QVector<QV4::Profiling::MemoryAllocationProperties> &,
+                     const QVector<QV4::Profiling::AllocationStatisticsProperties> &);
 
 signals:
     void v4ProfilingEnabled(quint64 v4Features);
@@ -82,8 +83,10 @@ private:
     QV4::Profiling::FunctionLocationHash m_functionLocations;
     QVector<QV4::Profiling::FunctionCallProperties> m_functionCallData;
     QVector<QV4::Profiling::MemoryAllocationProperties> m_memoryData;
+    QVector<QV4::Profiling::AllocationStatisticsProperties> m_allocationStatistics;
     int m_functionCallPos;
     int m_memoryPos;
+    int m_allocationStatisticsPos;
     QStack<qint64> m_stack;
     qint64 appendMemoryEvents(qint64 until, QList<QByteArray> &messages, QQmlDebugPacket &d);
     qint64 finalizeMessages(qint64 until, QList<QByteArray> &messages, qint64 callNext,
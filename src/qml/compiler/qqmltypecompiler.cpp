@@ -150,7 +150,7 @@ QV4::CompiledData::CompilationUnit *QQmlTypeCompiler::compile()
 
         QV4::ExecutionEngine *v4 = engine->v4engine();
         QScopedPointer<QV4::EvalInstructionSelection> isel(v4->iselFactory->create(engine, v4->executableAllocator, &document->jsModule, &document->jsGenerator));
-        isel->setUseFastLookups(false);
+        isel->setUseGlobalLookups(false);
         isel->setUseTypeInference(true);
         document->javaScriptCompilationUnit = isel->compile(/*generated unit data*/false);
     }
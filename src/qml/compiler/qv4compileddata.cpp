@@ -47,6 +47,7 @@
 #include <private/qv4lookup_p.h>
 #include <private/qv4regexpobject_p.h>
 #include <private/qv4regexp_p.h>
+#include <private/qv4tiering_p.h>
 #include <private/qqmlpropertycache_p.h>
 #include <private/qqmltypeloader_p.h>
 #include <private/qqmlengine_p.h>
@@ -132,22 +133,10 @@ QV4::Function *CompilationUnit::linkToEngine(ExecutionEngine *engine)
     for (uint i = 0; i < data->stringTableSize; ++i)
         runtimeStrings[i] = engine->newString(data->stringAt(i));
 
+    // Regular expressions are compiled when their literal is first evaluated, see
+    // regularExpressionAt(). Most of them never are during start-up.
     runtimeRegularExpressions = new QV4::Value[data->regexpTableSize];
-    // memset the regexps to 0 in case a GC run happens while we're within the loop below
     memset(runtimeRegularExpressions, 0, data->regexpTableSize * sizeof(QV4::Value));
-    for (uint i = 0; i < data->regexpTableSize; ++i) {
-        const CompiledData::RegExp *re = data->regexpAt(i);
-        bool global = false;
-        bool multiline = false;
-        bool ignoreCase = false;
-        if (re->flags & CompiledData::RegExp::RegExp_Global)
-            global = true;
-        if (re->flags & CompiledData::RegExp::RegExp_IgnoreCase)
-            ignoreCase = true;
-        if (re->flags & CompiledData::RegExp::RegExp_Multiline)
-            multiline = true;
-        runtimeRegularExpressions[i] = QV4::RegExp::create(engine, data->stringAt(re->stringIndex), ignoreCase, multiline, global);
-    }
 
     if (data->lookupTableSize) {
         runtimeLookups = new QV4::Lookup[data->lookupTableSize];
@@ -209,6 +198,28 @@ QV4::Function *CompilationUnit::linkToEngine(ExecutionEngine *engine)
         return 0;
 }
 
+QV4::RegExp *CompilationUnit::regularExpressionAt(int index)
+{
+    QV4::Value &value = runtimeRegularExpressions[index];
+    if (value.isUndefined()) {
+        const CompiledData::RegExp *re = data->regexpAt(index);
+        bool global = false;
+        bool multiline = false;
+        bool ignoreCase = false;
+        if (re->flags & CompiledData::RegExp::RegExp_Global)
+            global = true;
+        if (re->flags & CompiledData::RegExp::RegExp_IgnoreCase)
+            ignoreCase = true;
+        if (re->flags & CompiledData::RegExp::RegExp_Multiline)
+            multiline = true;
+        value = QV4::RegExp::create(engine, data->stringAt(re->stringIndex), ignoreCase, multiline, global);
+    } else if (!value.as<QV4::RegExp>()->cache()) {
+        // evicted from the RegExpCache, and with it its JIT code
+        value = QV4::RegExp::reviveIfEvicted(engine, value.as<QV4::RegExp>()->d());
+    }
+    return value.as<QV4::RegExp>();
+}
+
 void CompilationUnit::unlink()
 {
     if (engine)
@@ -237,6 +248,14 @@ void CompilationUnit::unlink()
     qmlEngine = 0;
     free(runtimeStrings);
     runtimeStrings = 0;
+    if (runtimeLookups) {
+        const bool showLookupStatistics = QV4::Lookup::showStatistics();
+        for (uint i = 0; i < data->lookupTableSize; ++i) {
+            if (showLookupStatistics)
+                runtimeLookups[i].dumpStatistics(fileName(), data->stringAt(data->lookupTable()[i].nameIndex));
+            runtimeLookups[i].releaseCaches();
+        }
+    }
     delete [] runtimeLookups;
     runtimeLookups = 0;
     delete [] runtimeRegularExpressions;
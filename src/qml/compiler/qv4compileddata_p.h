@@ -846,7 +846,7 @@ struct Q_QML_PRIVATE_EXPORT CompilationUnit : public CompilationUnitBase, public
     QUrl url() const { if (m_url.isNull) m_url = QUrl(fileName()); return m_url; }
 
     QV4::Lookup *runtimeLookups;
-    QV4::Value *runtimeRegularExpressions;
+    QV4::Value *runtimeRegularExpressions; // filled on demand by regularExpressionAt()
     QV4::InternalClass **runtimeClasses;
     QVector<QV4::Function *> runtimeFunctions;
     mutable QQmlNullableValue<QUrl> m_url;
@@ -870,6 +870,8 @@ struct Q_QML_PRIVATE_EXPORT CompilationUnit : public CompilationUnitBase, public
     // pointers either to data->constants() or little-endian memory copy.
     const Value* constants;
 
+    QV4::RegExp *regularExpressionAt(int index);
+
     void finalizeCompositeType(QQmlEnginePrivate *qmlEngine);
 
     int totalBindingsCount; // Number of bindings used in this type
@@ -887,6 +889,9 @@ struct Q_QML_PRIVATE_EXPORT CompilationUnit : public CompilationUnitBase, public
 
     QScopedPointer<CompilationUnitMapper> backingFile;
 
+    // Set on units that start out in the interpreter, see qv4tiering_p.h
+    QScopedPointer<TieringSource> tieringSource;
+
     // --- interface for QQmlPropertyCacheCreator
     typedef Object CompiledObject;
     int objectCount() const { return data->nObjects; }
@@ -159,6 +159,7 @@ QT_BEGIN_NAMESPACE
     F(Mul, mul) \
     F(Sub, sub) \
     F(BinopContext, binopContext) \
+    F(RecordTypes, recordTypes) \
     F(LoadThis, loadThis) \
     F(LoadQmlContext, loadQmlContext) \
     F(LoadQmlImportedScripts, loadQmlImportedScripts) \
@@ -776,6 +777,12 @@ union Instr
         Param rhs;
         Param result;
     };
+    struct instr_recordTypes {
+        MOTH_INSTR_HEADER
+        quint32 statement; // IR statement id, see Tiering::recordTypes()
+        Param lhs;
+        Param rhs;
+    };
     struct instr_loadThis {
         MOTH_INSTR_HEADER
         Param result;
@@ -885,6 +892,7 @@ union Instr
     instr_mul mul;
     instr_sub sub;
     instr_binopContext binopContext;
+    instr_recordTypes recordTypes;
     instr_loadThis loadThis;
     instr_loadQmlContext loadQmlContext;
     instr_loadQmlImportedScripts loadQmlImportedScripts;
@@ -192,6 +192,7 @@ void InstructionSelection::run(int functionIndex)
     qSwap(codeNext, _codeNext);
     qSwap(codeEnd, _codeEnd);
 
+    setTypeFeedbackStatementLimit(_function);
     IR::Optimizer opt(_function);
     opt.run(qmlEngine, useTypeInference, /*peelLoops =*/ false);
     if (opt.isInSSA()) {
@@ -386,7 +387,7 @@ void InstructionSelection::constructActivationProperty(IR::Name *func,
                                                        IR::ExprList *args,
                                                        IR::Expr *target)
 {
-    if (useFastLookups && func->global) {
+    if (useGlobalLookups && func->global) {
         Instruction::ConstructGlobalLookup call;
         call.index = registerGlobalGetterLookup(*func->id);
         prepareCallArgs(args, call.argc);
@@ -491,7 +492,7 @@ void InstructionSelection::loadRegexp(IR::RegExp *sourceRegexp, IR::Expr *target
 
 void InstructionSelection::getActivationProperty(const IR::Name *name, IR::Expr *target)
 {
-    if (useFastLookups && name->global) {
+    if (useGlobalLookups && name->global) {
         Instruction::GetGlobalLookup load;
         load.index = registerGlobalGetterLookup(*name->id);
         load.result = getResultParam(target);
@@ -775,6 +776,15 @@ void InstructionSelection::binop(IR::AluOp oper, IR::Expr *leftSource, IR::Expr
 
 Param InstructionSelection::binopHelper(IR::AluOp oper, IR::Expr *leftSource, IR::Expr *rightSource, IR::Expr *target)
 {
+    if (collectTypeFeedback && hasTypeFeedback(oper) && _currentStatement
+            && _currentStatement->id() >= 0 && _currentStatement->id() < typeFeedbackStatementLimit) {
+        Instruction::RecordTypes record;
+        record.statement = _currentStatement->id();
+        record.lhs = getParam(leftSource);
+        record.rhs = getParam(rightSource);
+        addInstruction(record);
+    }
+
     if (oper == IR::OpAdd) {
         Instruction::Add add;
         add.lhs = getParam(leftSource);
@@ -1015,7 +1025,7 @@ void InstructionSelection::visitRet(IR::Ret *s)
 
 void InstructionSelection::callBuiltinInvalid(IR::Name *func, IR::ExprList *args, IR::Expr *result)
 {
-    if (useFastLookups && func->global) {
+    if (useGlobalLookups && func->global) {
         Instruction::CallGlobalLookup call;
         call.index = registerGlobalGetterLookup(*func->id);
         prepareCallArgs(args, call.argc);
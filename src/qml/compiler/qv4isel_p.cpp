@@ -54,7 +54,11 @@ using namespace QV4::IR;
 
 EvalInstructionSelection::EvalInstructionSelection(QV4::ExecutableAllocator *execAllocator, Module *module, QV4::Compiler::JSUnitGenerator *jsGenerator, EvalISelFactory *iselFactory)
     : useFastLookups(true)
+    , useGlobalLookups(true)
     , useTypeInference(true)
+    , collectTypeFeedback(false)
+    , typeFeedback(0)
+    , typeFeedbackStatementLimit(0)
     , executableAllocator(execAllocator)
     , irModule(module)
 {
@@ -87,6 +91,30 @@ QQmlRefPointer<CompiledData::CompilationUnit> EvalInstructionSelection::compile(
     return unit;
 }
 
+bool EvalInstructionSelection::hasTypeFeedback(IR::AluOp op)
+{
+    switch (op) {
+    case IR::OpAdd:
+    case IR::OpDiv:
+    case IR::OpGt:
+    case IR::OpLt:
+    case IR::OpGe:
+    case IR::OpLe:
+        return true;
+    default:
+        return false;
+    }
+}
+
+quint8 EvalInstructionSelection::observedTypes(int functionIndex, IR::Stmt *s) const
+{
+    if (!typeFeedback || !s || s->id() < 0 || s->id() >= typeFeedbackStatementLimit)
+        return 0;
+    if (functionIndex >= typeFeedback->size())
+        return 0;
+    return typeFeedback->at(functionIndex).value(s->id());
+}
+
 void IRDecoder::visitMove(IR::Move *s)
 {
     if (IR::Name *n = s->target->asName()) {
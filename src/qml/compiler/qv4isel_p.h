@@ -77,9 +77,18 @@ public:
 
     QQmlRefPointer<QV4::CompiledData::CompilationUnit> compile(bool generateUnitData = true);
 
-    void setUseFastLookups(bool b) { useFastLookups = b; }
+    void setUseFastLookups(bool b) { useFastLookups = b; useGlobalLookups = b; }
+    // Global lookups read names straight from the global object. Code that runs in a QML
+    // context has to resolve them through the context, but can still use member lookups.
+    void setUseGlobalLookups(bool b) { useGlobalLookups = b; }
     void setUseTypeInference(bool onoff) { useTypeInference = onoff; }
 
+    // Tiered execution: the interpreter records the operand types of some binary operations,
+    // and the JIT reads them back when the unit gets compiled a second time. The feedback is
+    // indexed by function index and by the id of the IR statement holding the operation.
+    void setCollectTypeFeedback(bool onoff) { collectTypeFeedback = onoff; }
+    void setTypeFeedback(const QVector<QVector<quint8> > *feedback) { typeFeedback = feedback; }
+
     int registerString(const QString &str) { return jsGenerator->registerString(str); }
     uint registerIndexedGetterLookup() { return jsGenerator->registerIndexedGetterLookup(); }
     uint registerIndexedSetterLookup() { return jsGenerator->registerIndexedSetterLookup(); }
@@ -94,8 +103,18 @@ protected:
     virtual void run(int functionIndex) = 0;
     virtual QQmlRefPointer<QV4::CompiledData::CompilationUnit> backendCompileStep() = 0;
 
+    static bool hasTypeFeedback(IR::AluOp op);
+    // Only statements created by the code generator have the same id in the interpreter and
+    // the JIT pipelines. Call before running the optimizer on the function.
+    void setTypeFeedbackStatementLimit(IR::Function *function) { typeFeedbackStatementLimit = function->statementCount(); }
+    quint8 observedTypes(int functionIndex, IR::Stmt *s) const;
+
     bool useFastLookups;
+    bool useGlobalLookups;
     bool useTypeInference;
+    bool collectTypeFeedback;
+    const QVector<QVector<quint8> > *typeFeedback;
+    int typeFeedbackStatementLimit;
     QV4::ExecutableAllocator *executableAllocator;
     QV4::Compiler::JSUnitGenerator *jsGenerator;
     QScopedPointer<QV4::Compiler::JSUnitGenerator> ownJSGenerator;
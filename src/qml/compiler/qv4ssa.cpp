@@ -66,6 +66,9 @@ namespace {
 
 enum { DebugMoveMapping = 0 };
 
+// Larger functions are not converted to SSA form, and are not optimized.
+enum { MaxStatementsForSSA = 300 };
+
 #ifdef QT_NO_DEBUG
 enum { DoVerification = 0 };
 #else
@@ -1190,6 +1193,12 @@ public:
         return _defUses[variable.index].blockOfStatement;
     }
 
+    void setDefStmtBlock(const Temp &variable, BasicBlock *block)
+    {
+        Q_ASSERT(static_cast<unsigned>(variable.index) < _defUses.size());
+        _defUses[variable.index].blockOfStatement = block;
+    }
+
     void replaceBasicBlock(BasicBlock *from, BasicBlock *to)
     {
         for (auto &du : _defUses) {
@@ -4741,6 +4750,779 @@ private:
     std::vector<int> tempForLocal;
 };
 
+// Inlines calls to small functions declared inside the function being optimized.
+//
+// Function declarations are assigned to their local at the very start of the entry block, before
+// any call can happen. When that local is never written again (not by the function itself, and
+// not by any of its nested functions), a call through it always reaches the same IR function. If
+// that callee does not need an execution context of its own (no nested functions, no eval, no
+// arguments object and no use of this), its formals, locals and temps can become temps of the
+// caller, and any access to an enclosing scope simply gets one scope closer.
+//
+// Inlining is done before conversion to SSA, so the inlined code is optimized together with the
+// caller, and both the interpreter and the JIT pick it up.
+class FunctionInliner
+{
+    enum {
+        MaxInlineDepth = 3,
+        MaxCalleeStatements = 40
+    };
+
+public:
+    FunctionInliner(IR::Function *function, int statementBudget)
+        : function(function)
+        , statementBudget(statementBudget)
+        , tempBase(0)
+    {}
+
+    // Returns the number of inlined calls.
+    int run()
+    {
+        if (function->nestedFunctions.isEmpty() || !canInlineInto(function))
+            return 0;
+
+        findConstantClosures();
+        if (closureForLocal.isEmpty())
+            return 0;
+
+        int inlinedCalls = 0;
+        blockDepth.resize(function->basicBlockCount(), 0);
+
+        // Inlining appends the continuation blocks and the inlined blocks to the function, so
+        // they get visited too. That's how calls in the inlined code are inlined in turn.
+        for (int i = 0; i < function->basicBlockCount(); ++i) {
+            BasicBlock *bb = function->basicBlock(i);
+            if (bb->isRemoved() || blockDepth[i] >= MaxInlineDepth)
+                continue;
+
+            for (int s = 0, es = bb->statementCount(); s != es; ++s) {
+                Call *call = callIn(bb->statements().at(s));
+                if (!call)
+                    continue;
+                IR::Function *callee = calleeFor(call);
+                if (!callee)
+                    continue;
+                const int cost = calleeCost.value(callee);
+                if (cost > statementBudget)
+                    continue;
+
+                statementBudget -= cost;
+                inlineCall(bb, s, call, callee);
+                ++inlinedCalls;
+                break; // the rest of this block got moved to the continuation block
+            }
+        }
+
+        return inlinedCalls;
+    }
+
+private:
+    static bool canInlineInto(IR::Function *f)
+    {
+        // eval, with and catch scopes can write to our locals by name, which we can't see.
+        if (f->hasDirectEval || f->hasWith || f->hasTry)
+            return false;
+        for (IR::Function *nested : qAsConst(f->nestedFunctions))
+            if (!canInlineInto(nested))
+                return false;
+        return true;
+    }
+
+    static Call *callIn(Stmt *s)
+    {
+        if (Exp *e = s->asExp())
+            return e->expr->asCall();
+        if (Move *m = s->asMove())
+            if (m->target->asTemp() || m->target->asArgLocal())
+                return m->source->asCall();
+        return nullptr;
+    }
+
+    static bool isCall(Stmt *s)
+    {
+        if (Exp *e = s->asExp())
+            return e->expr->asCall() || e->expr->asNew();
+        if (Move *m = s->asMove())
+            return m->source->asCall() || m->source->asNew();
+        return false;
+    }
+
+    static bool hasMemberResolver(Expr *e)
+    {
+        if (Temp *t = e->asTemp())
+            return t->memberResolver != nullptr;
+        if (Convert *c = e->asConvert())
+            return hasMemberResolver(c->expr);
+        if (Unop *u = e->asUnop())
+            return hasMemberResolver(u->expr);
+        if (Binop *b = e->asBinop())
+            return hasMemberResolver(b->left) || hasMemberResolver(b->right);
+        if (Subscript *s = e->asSubscript())
+            return hasMemberResolver(s->base) || hasMemberResolver(s->index);
+        if (Member *m = e->asMember())
+            return hasMemberResolver(m->base);
+
+        ExprList *args = nullptr;
+        if (Call *c = e->asCall()) {
+            if (hasMemberResolver(c->base))
+                return true;
+            args = c->args;
+        } else if (New *n = e->asNew()) {
+            if (hasMemberResolver(n->base))
+                return true;
+            args = n->args;
+        }
+        for (ExprList *it = args; it; it = it->next)
+            if (hasMemberResolver(it->expr))
+                return true;
+        return false;
+    }
+
+    // Returns the number of statements the callee would add to the caller, or -1 if it cannot
+    // be inlined at all.
+    int inliningCost(IR::Function *callee) const
+    {
+        if (callee->outer != function || !callee->nestedFunctions.isEmpty()
+                || callee->hasDirectEval || callee->usesArgumentsObject || callee->usesThis
+                || callee->hasTry || callee->hasWith || callee->isNamedExpression
+                || callee->isQmlBinding || callee->isStrict != function->isStrict)
+            return -1;
+
+        // QML scope and context lookups record dependencies for the function they are in.
+        if (!callee->idObjectDependencies.isEmpty()
+                || !callee->contextObjectPropertyDependencies.isEmpty()
+                || !callee->scopeObjectPropertyDependencies.isEmpty())
+            return -1;
+
+        int cost = 0;
+        for (BasicBlock *bb : callee->basicBlocks()) {
+            if (bb->isRemoved())
+                continue;
+            if (!bb->isTerminated())
+                return -1;
+            for (Stmt *s : bb->statements()) {
+                if (Exp *e = s->asExp()) {
+                    if (hasMemberResolver(e->expr))
+                        return -1;
+                } else if (Move *m = s->asMove()) {
+                    if (hasMemberResolver(m->target) || hasMemberResolver(m->source))
+                        return -1;
+                } else if (CJump *c = s->asCJump()) {
+                    if (hasMemberResolver(c->cond))
+                        return -1;
+                }
+            }
+            cost += bb->statementCount();
+            if (cost > MaxCalleeStatements)
+                return -1;
+        }
+        return cost;
+    }
+
+    void findConstantClosures()
+    {
+        BasicBlock *entry = function->basicBlock(0);
+        if (!entry->in.isEmpty())
+            return;
+
+        std::vector<int> closureIndex(function->locals.size(), -1);
+        disqualified = QBitArray(function->locals.size());
+
+        bool inPrologue = true;
+        for (BasicBlock *bb : function->basicBlocks()) {
+            if (bb->isRemoved())
+                continue;
+            for (Stmt *s : bb->statements()) {
+                if (bb == entry && isCall(s))
+                    inPrologue = false;
+                Move *m = s->asMove();
+                if (!m)
+                    continue;
+                ArgLocal *al = m->target->asArgLocal();
+                if (!al || al->kind != ArgLocal::Local)
+                    continue;
+
+                // Before the closure is assigned, the local can only be initialized to undefined.
+                if (bb == entry && inPrologue && closureIndex[al->index] == -1) {
+                    if (Closure *c = m->source->asClosure()) {
+                        closureIndex[al->index] = c->value;
+                        continue;
+                    }
+                    if (m->source->asConst())
+                        continue;
+                }
+                disqualified.setBit(al->index);
+            }
+        }
+
+        for (IR::Function *nested : qAsConst(function->nestedFunctions))
+            findScopedWrites(nested, 1);
+
+        for (int i = 0, ei = int(closureIndex.size()); i != ei; ++i) {
+            if (closureIndex[i] == -1 || disqualified.at(i))
+                continue;
+            IR::Function *callee = function->module->functions.at(closureIndex[i]);
+            const int cost = inliningCost(callee);
+            if (cost == -1)
+                continue;
+            closureForLocal.insert(i, callee);
+            calleeCost.insert(callee, cost);
+        }
+    }
+
+    void findScopedWrites(IR::Function *f, unsigned scope)
+    {
+        for (BasicBlock *bb : f->basicBlocks()) {
+            if (bb->isRemoved())
+                continue;
+            for (Stmt *s : bb->statements()) {
+                if (Move *m = s->asMove()) {
+                    ArgLocal *al = m->target->asArgLocal();
+                    if (al && al->kind == ArgLocal::ScopedLocal && al->scope == scope)
+                        disqualified.setBit(al->index);
+                }
+            }
+        }
+
+        for (IR::Function *nested : qAsConst(f->nestedFunctions))
+            findScopedWrites(nested, scope + 1);
+    }
+
+    IR::Function *calleeFor(Call *call) const
+    {
+        ArgLocal *al = call->base->asArgLocal();
+        if (!al || al->kind != ArgLocal::Local)
+            return nullptr;
+        return closureForLocal.value(al->index, nullptr);
+    }
+
+    void inlineCall(BasicBlock *bb, int callIndex, Call *call, IR::Function *callee)
+    {
+        Stmt *callStmt = bb->statements().at(callIndex);
+        const int depth = blockDepth[bb->index()] + 1;
+
+        // Everything after the call goes into a continuation block, which also takes over the
+        // outgoing edges.
+        BasicBlock *continuation = function->newBasicBlock(bb->catchBlock);
+        blockDepth.push_back(depth - 1);
+        const QVector<Stmt *> tail = bb->statements().mid(callIndex + 1);
+        for (Stmt *s : tail)
+            continuation->appendStatement(s);
+        while (bb->statementCount() > callIndex)
+            bb->removeStatement(bb->statementCount() - 1);
+        if (Stmt *terminator = continuation->terminator())
+            if (CJump *cjump = terminator->asCJump())
+                cjump->parent = continuation;
+        for (BasicBlock *out : bb->out) {
+            out->in[out->in.indexOf(bb)] = continuation;
+            continuation->out.append(out);
+        }
+        bb->out.clear();
+
+        tempBase = function->tempCount;
+        function->tempCount += callee->tempCount;
+        function->maxNumberOfArguments = qMax(function->maxNumberOfArguments,
+                                              callee->maxNumberOfArguments);
+        formalTemps.resize(callee->formals.size());
+        for (int &t : formalTemps)
+            t = function->tempCount++;
+        localTemps.resize(callee->locals.size());
+        for (int &t : localTemps)
+            t = function->tempCount++;
+
+        ExprList *arg = call->args;
+        for (int t : qAsConst(formalTemps)) {
+            Stmt *m = bb->MOVE(bb->TEMP(t), arg ? arg->expr : bb->CONST(UndefinedType, 0));
+            m->location = callStmt->location;
+            if (arg)
+                arg = arg->next;
+        }
+
+        Temp *result = nullptr;
+        if (Move *m = callStmt->asMove()) {
+            result = continuation->TEMP(continuation->newTemp(BasicBlock::NewTempForOptimizer));
+            m->source = result;
+            continuation->prependStatement(m);
+        }
+
+        QVector<BasicBlock *> clones(callee->basicBlockCount(), nullptr);
+        for (BasicBlock *calleeBB : callee->basicBlocks())
+            if (!calleeBB->isRemoved())
+                clones[calleeBB->index()] = function->newBasicBlock(bb->catchBlock);
+        blockDepth.resize(function->basicBlockCount(), depth);
+
+        CloneExpr cloneExpr(continuation);
+        auto cloneAndMap = [&](Expr *e) {
+            Expr *c = cloneExpr(e);
+            map(c);
+            return c;
+        };
+
+        for (BasicBlock *calleeBB : callee->basicBlocks()) {
+            if (calleeBB->isRemoved())
+                continue;
+            BasicBlock *clone = clones.at(calleeBB->index());
+            for (Stmt *s : calleeBB->statements()) {
+                Stmt *cloned = nullptr;
+                if (Exp *e = s->asExp()) {
+                    cloned = clone->EXP(cloneAndMap(e->expr));
+                } else if (Move *m = s->asMove()) {
+                    cloned = clone->MOVE(cloneAndMap(m->target), cloneAndMap(m->source));
+                } else if (Jump *j = s->asJump()) {
+                    cloned = clone->JUMP(clones.at(j->target->index()));
+                } else if (CJump *c = s->asCJump()) {
+                    cloned = clone->CJUMP(cloneAndMap(c->cond), clones.at(c->iftrue->index()),
+                                          clones.at(c->iffalse->index()));
+                } else if (Ret *r = s->asRet()) {
+                    if (result) {
+                        Stmt *m = clone->MOVE(CloneExpr::cloneTemp(result, function),
+                                              cloneAndMap(r->expr));
+                        m->location = callStmt->location;
+                    }
+                    cloned = clone->JUMP(continuation);
+                } else {
+                    Q_UNREACHABLE();
+                }
+                // Exceptions thrown by the inlined code are reported at the call.
+                cloned->location = callStmt->location;
+            }
+        }
+
+        Stmt *jump = bb->JUMP(clones.at(0));
+        jump->location = callStmt->location;
+    }
+
+    // Rewrites a cloned expression from the callee's frame into the caller's frame.
+    void map(Expr *&e)
+    {
+        if (Temp *t = e->asTemp()) {
+            t->index += tempBase;
+        } else if (ArgLocal *al = e->asArgLocal()) {
+            if (al->scope == 0) {
+                Temp *t = function->New<Temp>();
+                t->init(Temp::VirtualRegister, al->kind == ArgLocal::Formal
+                        ? formalTemps.at(al->index) : localTemps.at(al->index));
+                e = t;
+            } else if (al->scope == 1) {
+                al->init(al->kind == ArgLocal::ScopedFormal ? ArgLocal::Formal : ArgLocal::Local,
+                         al->index, 0);
+            } else {
+                al->scope = al->scope - 1;
+            }
+        } else if (Convert *c = e->asConvert()) {
+            map(c->expr);
+        } else if (Unop *u = e->asUnop()) {
+            map(u->expr);
+        } else if (Binop *b = e->asBinop()) {
+            map(b->left);
+            map(b->right);
+        } else if (Call *c = e->asCall()) {
+            map(c->base);
+            for (ExprList *it = c->args; it; it = it->next)
+                map(it->expr);
+        } else if (New *n = e->asNew()) {
+            map(n->base);
+            for (ExprList *it = n->args; it; it = it->next)
+                map(it->expr);
+        } else if (Subscript *s = e->asSubscript()) {
+            map(s->base);
+            map(s->index);
+        } else if (Member *m = e->asMember()) {
+            map(m->base);
+        }
+    }
+
+    IR::Function *function;
+    int statementBudget;
+    QHash<int, IR::Function *> closureForLocal;
+    QHash<IR::Function *, int> calleeCost;
+    QBitArray disqualified;
+    std::vector<int> blockDepth;
+
+    unsigned tempBase;
+    QVector<int> formalTemps;
+    QVector<int> localTemps;
+};
+
+// Replaces object literals that do not escape by the values they were initialized with, which
+// saves allocating them. A literal escapes when it is used for anything else than reading one
+// of its own properties: storing it, passing it, returning it, calling a method on it, writing
+// to it, or merging it in a phi-node. Reading any other property would go to the prototype,
+// so it is treated as escaping too. Literals with accessors or array entries are left alone.
+//
+// This runs right after the conversion to SSA form, so type inference sees the values that are
+// read, instead of a generic property lookup.
+class ScalarReplacement
+{
+    typedef QVarLengthArray<QPair<const QString *, Expr *>, 8> Properties;
+
+public:
+    ScalarReplacement(IR::Function *function, DefUses &defUses)
+        : function(function)
+        , defUses(defUses)
+    {}
+
+    int run()
+    {
+        int eliminated = 0;
+        for (BasicBlock *bb : function->basicBlocks()) {
+            if (bb->isRemoved())
+                continue;
+
+            for (int i = 0; i < bb->statementCount();) {
+                Move *m = bb->statements().at(i)->asMove();
+                if (m && tryReplace(m)) {
+                    bb->removeStatement(i);
+                    ++eliminated;
+                } else {
+                    ++i;
+                }
+            }
+        }
+
+        static const bool showCode = qEnvironmentVariableIsSet("QV4_SHOW_IR");
+        if (showCode && eliminated > 0) {
+            qDebug() << "Scalar replacement eliminated" << eliminated << "allocation(s) in function"
+                     << (function->name ? *function->name : QString());
+        }
+
+        return eliminated;
+    }
+
+private:
+    bool tryReplace(Move *m)
+    {
+        Temp *literal = m->target->asTemp();
+        Call *call = m->source->asCall();
+        if (!literal || !call)
+            return false;
+        Name *base = call->base->asName();
+        if (!base || base->builtin != Name::builtin_define_object_literal)
+            return false;
+
+        // The arguments are the number of key/value pairs, followed by the pairs, followed by
+        // the array entries. A data pair is: name, true, value.
+        ExprList *it = call->args;
+        const int keyValueCount = int(it->expr->asConst()->value);
+        Properties properties;
+        for (int i = 0; i < keyValueCount; ++i) {
+            it = it->next;
+            const QString *key = it->expr->asName()->id;
+            it = it->next;
+            if (!it->expr->asConst()->value || *key == QLatin1String("__proto__"))
+                return false;
+            it = it->next;
+            properties.append(qMakePair(key, it->expr));
+        }
+        if (it->next)
+            return false;
+
+        const QVector<Stmt *> uses = defUses.uses(*literal);
+        for (Stmt *use : uses) {
+            if (!valueRead(use, *literal, properties))
+                return false;
+        }
+
+        for (Stmt *use : uses) {
+            Move *read = use->asMove();
+            Expr *value = valueRead(use, *literal, properties);
+            defUses.removeUse(read, *literal);
+            if (Temp *t = value->asTemp()) {
+                read->source = CloneExpr::cloneTemp(t, function);
+                defUses.addUse(*t, read);
+            } else {
+                read->source = CloneExpr::cloneConst(value->asConst(), function);
+            }
+        }
+
+        defUses.removeDefUses(m);
+        return true;
+    }
+
+    // Returns the value of the property that is read by the statement, if all that the
+    // statement does is reading an own property of the literal.
+    static Expr *valueRead(Stmt *s, const Temp &literal, const Properties &properties)
+    {
+        Move *m = s->asMove();
+        if (!m || !(m->target->asTemp() || m->target->asArgLocal()))
+            return nullptr;
+        if (Temp *t = m->target->asTemp())
+            if (*t == literal)
+                return nullptr;
+        Member *member = m->source->asMember();
+        if (!member || member->kind != Member::UnspecifiedMember || member->property)
+            return nullptr;
+        Temp *base = member->base->asTemp();
+        if (!base || *base != literal)
+            return nullptr;
+
+        for (const auto &property : properties) {
+            if (*property.first == *member->name)
+                return property.second;
+        }
+        return nullptr;
+    }
+
+    IR::Function *function;
+    DefUses &defUses;
+};
+
+static bool isInLoop(BasicBlock *bb, BasicBlock *loopHeader)
+{
+    for (BasicBlock *it = bb; it; it = it->containingGroup()) {
+        if (it == loopHeader)
+            return true;
+    }
+    return false;
+}
+
+// Types the counter of a loop like "for (var i = 0; i < n; ++i)" as int32. Type inference merges
+// the int32 start value with the result of the addition, which is a double, so the counter ends
+// up as a double. But when n is an int32, and the loop is left when i < n does not hold, i + 1
+// cannot get larger than INT_MAX inside the loop. So the counter and the increment can be int32,
+// which also lets the JIT do the addition without an overflow check, and index arrays with an
+// integer.
+class InductionVariables
+{
+public:
+    InductionVariables(DefUses &defUses, const DominatorTree &dt)
+        : defUses(defUses)
+        , dt(dt)
+    {}
+
+    void run(IR::Function *function)
+    {
+        PropagateTempTypes propagator(defUses);
+
+        for (BasicBlock *header : function->basicBlocks()) {
+            if (header->isRemoved() || !header->isGroupStart())
+                continue;
+            Stmt *terminator = header->terminator();
+            CJump *cjump = terminator ? terminator->asCJump() : nullptr;
+            if (!cjump)
+                continue;
+            Binop *cond = cjump->cond->asBinop();
+            if (!cond)
+                continue;
+
+            Expr *counter = nullptr;
+            Expr *bound = nullptr;
+            BasicBlock *body = nullptr;
+            BasicBlock *exit = nullptr;
+            switch (cond->op) {
+            case OpLt:
+                counter = cond->left; bound = cond->right;
+                body = cjump->iftrue; exit = cjump->iffalse;
+                break;
+            case OpGt:
+                counter = cond->right; bound = cond->left;
+                body = cjump->iftrue; exit = cjump->iffalse;
+                break;
+            case OpGe:
+                counter = cond->left; bound = cond->right;
+                body = cjump->iffalse; exit = cjump->iftrue;
+                break;
+            default:
+                continue;
+            }
+            if (bound->type != SInt32Type || !isInLoop(body, header) || isInLoop(exit, header))
+                continue;
+
+            Temp *i = counter->asTemp();
+            if (!i)
+                continue;
+            Phi *phi = defUses.defStmt(*i) ? defUses.defStmt(*i)->asPhi() : nullptr;
+            if (!phi || defUses.defStmtBlock(*i) != header || phi->incoming.size() != 2)
+                continue;
+
+            const int initIdx = isInLoop(header->in.at(0), header) ? 1 : 0;
+            if (isInLoop(header->in.at(initIdx), header) || !isInLoop(header->in.at(1 - initIdx), header))
+                continue;
+            if (phi->incoming.at(initIdx)->type != SInt32Type)
+                continue;
+
+            // The back-edge value has to be i + 1, calculated after the check.
+            Temp *next = phi->incoming.at(1 - initIdx)->asTemp();
+            if (!next)
+                continue;
+            Move *increment = defUses.defStmt(*next) ? defUses.defStmt(*next)->asMove() : nullptr;
+            if (!increment || !dt.dominates(body, defUses.defStmtBlock(*next)))
+                continue;
+            Binop *add = increment->source->asBinop();
+            if (!add || add->op != OpAdd)
+                continue;
+            Expr *operand = add->left;
+            if (!isOne(add->right)) {
+                if (!isOne(add->left))
+                    continue;
+                operand = add->right;
+            }
+
+            // i++ is done as: x = +i; next = x + 1
+            Temp *copy = nullptr;
+            Temp *operandTemp = operand->asTemp();
+            if (!operandTemp)
+                continue;
+            if (UntypedTemp(*operandTemp) != UntypedTemp(*i)) {
+                Move *m = defUses.defStmt(*operandTemp) ? defUses.defStmt(*operandTemp)->asMove() : nullptr;
+                if (!m)
+                    continue;
+                Expr *source = m->source;
+                if (Unop *u = source->asUnop())
+                    source = u->op == OpUPlus ? u->expr : nullptr;
+                Temp *sourceTemp = source ? source->asTemp() : nullptr;
+                if (!sourceTemp || UntypedTemp(*sourceTemp) != UntypedTemp(*i))
+                    continue;
+                copy = operandTemp;
+            }
+
+            propagator.run(*i, SInt32Type);
+            if (copy) {
+                propagator.run(*copy, SInt32Type);
+                Move *m = defUses.defStmt(*copy)->asMove();
+                if (Unop *u = m->source->asUnop())
+                    u->type = SInt32Type;
+            }
+            propagator.run(*next, SInt32Type);
+            add->type = SInt32Type;
+        }
+    }
+
+private:
+    bool isOne(Expr *e) const
+    {
+        if (Temp *t = e->asTemp()) {
+            Stmt *def = defUses.defStmt(*t);
+            Move *m = def ? def->asMove() : nullptr;
+            if (!m)
+                return false;
+            e = m->source;
+        }
+        Const *c = e->asConst();
+        return c && c->type == SInt32Type && c->value == 1;
+    }
+
+    DefUses &defUses;
+    const DominatorTree &dt;
+};
+
+// Moves calculations that do not change during a loop into the block that leads into the loop.
+// Only arithmetic on numbers and booleans is moved: that cannot call out to JavaScript, cannot
+// throw, and has no side effects, so it is fine to calculate it even when the loop body would
+// not have done so.
+class LoopInvariantCodeMotion
+{
+public:
+    LoopInvariantCodeMotion(IR::Function *function, DefUses &defUses)
+        : function(function)
+        , defUses(defUses)
+    {}
+
+    int run()
+    {
+        // Do inner loops first, so whatever is moved into the preheader of an inner loop can be
+        // moved out of the outer loop too.
+        QVector<QPair<int, BasicBlock *> > headers;
+        for (BasicBlock *bb : function->basicBlocks()) {
+            if (bb->isRemoved() || !bb->isGroupStart())
+                continue;
+            int depth = 0;
+            for (BasicBlock *outer = bb->containingGroup(); outer; outer = outer->containingGroup())
+                ++depth;
+            headers.append(qMakePair(-depth, bb));
+        }
+        std::sort(headers.begin(), headers.end());
+
+        int hoisted = 0;
+        for (const auto &header : qAsConst(headers))
+            hoisted += hoistFrom(header.second);
+        return hoisted;
+    }
+
+private:
+    int hoistFrom(BasicBlock *header)
+    {
+        BasicBlock *preheader = nullptr;
+        for (BasicBlock *in : header->in) {
+            if (isInLoop(in, header))
+                continue;
+            if (preheader)
+                return 0;
+            preheader = in;
+        }
+        if (!preheader || preheader->out.size() != 1)
+            return 0;
+
+        QVector<BasicBlock *> body;
+        for (BasicBlock *bb : function->basicBlocks())
+            if (!bb->isRemoved() && isInLoop(bb, header))
+                body.append(bb);
+
+        int hoisted = 0;
+        for (bool changed = true; changed; ) {
+            changed = false;
+            for (BasicBlock *bb : qAsConst(body)) {
+                for (int i = 0; i < bb->statementCount();) {
+                    Stmt *s = bb->statements().at(i);
+                    if (isInvariant(s, header)) {
+                        bb->removeStatement(i);
+                        preheader->insertStatementBeforeTerminator(s);
+                        defUses.setDefStmtBlock(*s->asMove()->target->asTemp(), preheader);
+                        ++hoisted;
+                        changed = true;
+                    } else {
+                        ++i;
+                    }
+                }
+            }
+        }
+        return hoisted;
+    }
+
+    static bool isNumberOrBool(Expr *e)
+    {
+        return e->type != UnknownType && (e->type & ~(NumberType | BoolType)) == 0;
+    }
+
+    bool isInvariantOperand(Expr *e, BasicBlock *header) const
+    {
+        if (e->asConst())
+            return isNumberOrBool(e);
+        if (Temp *t = e->asTemp()) {
+            BasicBlock *defBlock = defUses.defStmtBlock(*t);
+            return isNumberOrBool(t) && defBlock && !isInLoop(defBlock, header);
+        }
+        return false;
+    }
+
+    bool isInvariant(Stmt *s, BasicBlock *header) const
+    {
+        Move *m = s->asMove();
+        if (!m || !m->target->asTemp())
+            return false;
+
+        if (Binop *b = m->source->asBinop()) {
+            switch (b->op) {
+            case OpInstanceof:
+            case OpIn:
+            case OpAnd:
+            case OpOr:
+                return false;
+            default:
+                return isInvariantOperand(b->left, header) && isInvariantOperand(b->right, header);
+            }
+        } else if (Unop *u = m->source->asUnop()) {
+            return isInvariantOperand(u->expr, header);
+        } else if (Convert *c = m->source->asConvert()) {
+            return isNumberOrBool(c) && isInvariantOperand(c->expr, header);
+        }
+        return false;
+    }
+
+    IR::Function *function;
+    DefUses &defUses;
+};
+
 class CloneBasicBlock: protected CloneExpr
 {
 public:
@@ -5379,6 +6161,9 @@ LifeTimeIntervals::~LifeTimeIntervals()
 Optimizer::Optimizer(IR::Function *function)
     : function(function)
     , inSSA(false)
+    , inlinedCalls(0)
+    , replacedAllocations(0)
+    , hoistedStatements(0)
 {}
 
 void Optimizer::run(QQmlEnginePrivate *qmlEngine, bool doTypeInference, bool peelLoops)
@@ -5396,9 +6181,17 @@ void Optimizer::run(QQmlEnginePrivate *qmlEngine, bool doTypeInference, bool pee
 
     static bool doSSA = qEnvironmentVariableIsEmpty("QV4_NO_SSA");
 
-    if (!function->hasTry && !function->hasWith && !function->module->debugMode && doSSA && statementCount <= 300) {
+    if (!function->hasTry && !function->hasWith && !function->module->debugMode && doSSA && statementCount <= MaxStatementsForSSA) {
 //        qout << "SSA for " << (function->name ? qPrintable(*function->name) : "<anonymous>") << endl;
 
+        static const bool doInlining = qEnvironmentVariableIsEmpty("QV4_NO_INLINING");
+        if (doInlining)
+            inlinedCalls = FunctionInliner(function, MaxStatementsForSSA - statementCount).run();
+        if (inlinedCalls > 0) {
+            cleanupBasicBlocks(function);
+            showMeTheCode(function, "After inlining");
+        }
+
         mergeBasicBlocks(function, nullptr, nullptr);
 
         ConvertArgLocals(function).toTemps();
@@ -5451,6 +6244,12 @@ void Optimizer::run(QQmlEnginePrivate *qmlEngine, bool doTypeInference, bool pee
         cleanupPhis(defUses);
         showMeTheCode(function, "After cleaning up phi-nodes");
 
+        static const bool doScalarReplacement = qEnvironmentVariableIsEmpty("QV4_NO_SCALAR_REPLACEMENT");
+        if (doScalarReplacement)
+            replacedAllocations = ScalarReplacement(function, defUses).run();
+        if (replacedAllocations > 0)
+            showMeTheCode(function, "After scalar replacement");
+
         StatementWorklist worklist(function);
 
         if (doTypeInference) {
@@ -5462,6 +6261,8 @@ void Optimizer::run(QQmlEnginePrivate *qmlEngine, bool doTypeInference, bool pee
             ReverseInference(defUses).run(function);
 //            showMeTheCode(function);
 
+            InductionVariables(defUses, df).run(function);
+
 //            qout << "Doing type propagation..." << endl;
             TypePropagation(defUses).run(function, worklist);
 //            showMeTheCode(function);
@@ -5475,6 +6276,10 @@ void Optimizer::run(QQmlEnginePrivate *qmlEngine, bool doTypeInference, bool pee
             optimizeSSA(worklist, defUses, df);
             showMeTheCode(function, "After optimization");
 
+            hoistedStatements = LoopInvariantCodeMotion(function, defUses).run();
+            if (hoistedStatements > 0)
+                showMeTheCode(function, "After loop-invariant code motion");
+
             verifyImmediateDominators(df, function);
             verifyCFG(function);
         }
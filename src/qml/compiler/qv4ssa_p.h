@@ -251,6 +251,14 @@ public:
     bool isInSSA() const
     { return inSSA; }
 
+    // for unit-testing
+    int inlinedCallCount() const
+    { return inlinedCalls; }
+    int replacedAllocationCount() const
+    { return replacedAllocations; }
+    int hoistedStatementCount() const
+    { return hoistedStatements; }
+
     QHash<BasicBlock *, BasicBlock *> loopStartEndBlocks() const { return startEndLoops; }
 
     LifeTimeIntervals::Ptr lifeTimeIntervals() const;
@@ -262,6 +270,9 @@ public:
 private:
     Function *function;
     bool inSSA;
+    int inlinedCalls;
+    int replacedAllocations;
+    int hoistedStatements;
     QHash<BasicBlock *, BasicBlock *> startEndLoops;
 };
 
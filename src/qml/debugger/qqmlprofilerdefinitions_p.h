@@ -69,6 +69,7 @@ struct QQmlProfilerDefinitions {
         PixmapCacheEvent,
         SceneGraphFrame,
         MemoryAllocation,
+        AllocationStatistics,
 
         MaximumMessage
     };
@@ -129,6 +130,7 @@ struct QQmlProfilerDefinitions {
     };
 
     typedef QV4::Profiling::MemoryType MemoryType;
+    typedef QV4::Profiling::AllocationStatisticsType AllocationStatisticsType;
 
     enum ProfileFeature {
         ProfileJavaScript,
@@ -143,6 +145,7 @@ struct QQmlProfilerDefinitions {
         ProfileHandlingSignal,
         ProfileInputEvents,
         ProfileDebugMessages,
+        ProfileAllocationStatistics,
 
         MaximumProfileFeature
     };
@@ -48,6 +48,7 @@
 
 #if !defined(V4_BOOTSTRAP)
 #include "qv4function_p.h"
+#include "qv4perfmap_p.h"
 #endif
 
 #include <iostream>
@@ -96,6 +97,11 @@ bool CompilationUnit::memoryMapCode(QString *errorString)
         JSC::ExecutableAllocator::makeExecutable(codePtr, compiledFunction->codeSize);
         codeRefs[i] = codeRef;
 
+        if (PerfMap::isEnabled()) {
+            PerfMap::recordFunction(codePtr, compiledFunction->codeSize, stringAt(compiledFunction->nameIndex),
+                                    fileName(), compiledFunction->location.line);
+        }
+
         static const bool showCode = qEnvironmentVariableIsSet("QV4_SHOW_ASM");
         if (showCode) {
             WTF::dataLogF("Mapped JIT code for %s\n", qPrintable(stringAt(compiledFunction->nameIndex)));
@@ -450,6 +456,13 @@ typename Assembler<TargetConfiguration>::Jump Assembler<TargetConfiguration>::ge
 template <typename TargetConfiguration>
 typename Assembler<TargetConfiguration>::Jump Assembler<TargetConfiguration>::branchDouble(bool invertCondition, IR::AluOp op,
                                                    IR::Expr *left, IR::Expr *right)
+{
+    return branchDouble(invertCondition, op, toDoubleRegister(left, FPGpr0), toDoubleRegister(right, JITTargetPlatform::FPGpr1));
+}
+
+template <typename TargetConfiguration>
+typename Assembler<TargetConfiguration>::Jump Assembler<TargetConfiguration>::branchDouble(bool invertCondition, IR::AluOp op,
+                                                   FPRegisterID left, FPRegisterID right)
 {
     DoubleCondition cond;
     switch (op) {
@@ -467,7 +480,7 @@ typename Assembler<TargetConfiguration>::Jump Assembler<TargetConfiguration>::br
     if (invertCondition)
         cond = TargetConfiguration::MacroAssembler::invert(cond);
 
-    return TargetConfiguration::MacroAssembler::branchDouble(cond, toDoubleRegister(left, FPGpr0), toDoubleRegister(right, JITTargetPlatform::FPGpr1));
+    return TargetConfiguration::MacroAssembler::branchDouble(cond, left, right);
 }
 
 template <typename TargetConfiguration>
@@ -582,19 +595,6 @@ static void printDisassembledOutputWithCalls(QByteArray processedOutput, const Q
     qDebug("%s", processedOutput.constData());
 }
 
-#if defined(Q_OS_LINUX)
-static FILE *pmap;
-
-static void qt_closePmap()
-{
-    if (pmap) {
-        fclose(pmap);
-        pmap = 0;
-    }
-}
-
-#endif
-
 template <typename TargetConfiguration>
 JSC::MacroAssemblerCodeRef Assembler<TargetConfiguration>::link(int *codeSize)
 {
@@ -657,44 +657,10 @@ JSC::MacroAssemblerCodeRef Assembler<TargetConfiguration>::link(int *codeSize)
         codeRef = linkBuffer.finalizeCodeWithoutDisassembly();
     }
 
-#if defined(Q_OS_LINUX)
-    // This implements writing of JIT'd addresses so that perf can find the
-    // symbol names.
-    //
-    // Perf expects the mapping to be in a certain place and have certain
-    // content, for more information, see:
-    // https://github.com/torvalds/linux/blob/master/tools/perf/Documentation/jit-interface.txt
-    static bool doProfile = !qEnvironmentVariableIsEmpty("QV4_PROFILE_WRITE_PERF_MAP");
-    static bool profileInitialized = false;
-    if (doProfile && !profileInitialized) {
-        profileInitialized = true;
-
-        char pname[PATH_MAX];
-        snprintf(pname, PATH_MAX - 1, "/tmp/perf-%lu.map",
-                                      (unsigned long)QCoreApplication::applicationPid());
-
-        pmap = fopen(pname, "w");
-        if (!pmap)
-            qWarning("QV4: Can't write %s, call stacks will not contain JavaScript function names", pname);
-
-        // make sure we clean up nicely
-        std::atexit(qt_closePmap);
-    }
-
-    if (pmap) {
-        // this may have been pre-populated, if QV4_SHOW_ASM was on
-        if (name.isEmpty()) {
-            name = _function->name->toUtf8();
-            if (name.isEmpty())
-                name = "IR::Function(0x" + QByteArray::number(quintptr(_function), 16) + ')';
-        }
-
-        fprintf(pmap, "%llx %x %.*s\n",
-                      (long long unsigned int)codeRef.code().executableAddress(),
-                      *codeSize,
-                      name.length(),
-                      name.constData());
-        fflush(pmap);
+#if !defined(V4_BOOTSTRAP)
+    if (PerfMap::isEnabled()) {
+        PerfMap::recordFunction(codeRef.code().executableAddress(), *codeSize, *_function->name,
+                                _function->module->fileName, _function->line);
     }
 #endif
 
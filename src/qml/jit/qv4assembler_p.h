@@ -988,6 +988,7 @@ public:
 
     Jump genTryDoubleConversion(IR::Expr *src, FPRegisterID dest);
     Jump branchDouble(bool invertCondition, IR::AluOp op, IR::Expr *left, IR::Expr *right);
+    Jump branchDouble(bool invertCondition, IR::AluOp op, FPRegisterID left, FPRegisterID right);
     Jump branchInt32(bool invertCondition, IR::AluOp op, IR::Expr *left, IR::Expr *right);
 
     Pointer loadAddress(RegisterID tmp, IR::Expr *t);
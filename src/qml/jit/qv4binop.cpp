@@ -235,7 +235,7 @@ void Binop<JITAssembler>::generate(IR::Expr *lhs, IR::Expr *rhs, IR::Expr *targe
     }
 
     Jump done;
-    if (lhs->type != IR::StringType && rhs->type != IR::StringType)
+    if (inlineNumbers && lhs->type != IR::StringType && rhs->type != IR::StringType)
         done = genInlineBinop(lhs, rhs, target);
 
     // TODO: inline var===null and var!==null
@@ -554,17 +554,6 @@ bool Binop<JITAssembler>::int32Binop(IR::Expr *leftSource, IR::Expr *rightSource
     return true;
 }
 
-template <typename JITAssembler>
-inline typename JITAssembler::FPRegisterID getFreeFPReg(IR::Expr *shouldNotOverlap, unsigned hint)
-{
-    if (IR::Temp *t = shouldNotOverlap->asTemp())
-        if (t->type == IR::DoubleType)
-            if (t->kind == IR::Temp::PhysicalRegister)
-                if (t->index == hint)
-                    return typename JITAssembler::FPRegisterID(hint + 1);
-    return typename JITAssembler::FPRegisterID(hint);
-}
-
 template <typename JITAssembler>
 typename JITAssembler::Jump Binop<JITAssembler>::genInlineBinop(IR::Expr *leftSource, IR::Expr *rightSource, IR::Expr *target)
 {
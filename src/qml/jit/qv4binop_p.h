@@ -61,11 +61,23 @@ QT_BEGIN_NAMESPACE
 namespace QV4 {
 namespace JIT {
 
+template <typename JITAssembler>
+inline typename JITAssembler::FPRegisterID getFreeFPReg(IR::Expr *shouldNotOverlap, unsigned hint)
+{
+    if (IR::Temp *t = shouldNotOverlap->asTemp())
+        if (t->type == IR::DoubleType)
+            if (t->kind == IR::Temp::PhysicalRegister)
+                if (t->index == hint)
+                    return typename JITAssembler::FPRegisterID(hint + 1);
+    return typename JITAssembler::FPRegisterID(hint);
+}
+
 template <typename JITAssembler>
 struct Binop {
     Binop(JITAssembler *assembler, IR::AluOp operation)
         : as(assembler)
         , op(operation)
+        , inlineNumbers(true)
     {}
 
     using Jump = typename JITAssembler::Jump;
@@ -244,6 +256,8 @@ struct Binop {
 
     JITAssembler *as;
     IR::AluOp op;
+    // Whether to try the inline paths for operands that turn out to be numbers at run-time.
+    bool inlineNumbers;
 };
 
 }
@@ -45,6 +45,7 @@
 #include "qv4assembler_p.h"
 #include "qv4unop_p.h"
 #include "qv4binop_p.h"
+#include "qv4tiering_p.h"
 
 #include <QtCore/QBuffer>
 #include <QtCore/QCoreApplication>
@@ -69,6 +70,8 @@ InstructionSelection<JITAssembler>::InstructionSelection(QQmlEnginePrivate *qmlE
     : EvalInstructionSelection(execAllocator, module, jsGenerator, iselFactory)
     , _block(0)
     , _as(0)
+    , _functionIndex(-1)
+    , _currentStatement(0)
     , compilationUnit(new CompilationUnit)
     , qmlEngine(qmlEngine)
 {
@@ -87,7 +90,9 @@ void InstructionSelection<JITAssembler>::run(int functionIndex)
 {
     IR::Function *function = irModule->functions[functionIndex];
     qSwap(_function, function);
+    _functionIndex = functionIndex;
 
+    setTypeFeedbackStatementLimit(_function);
     IR::Optimizer opt(_function);
     opt.run(qmlEngine);
 
@@ -138,9 +143,11 @@ void InstructionSelection<JITAssembler>::run(int functionIndex)
                     lastLine = s->location.startLine;
                 }
             }
+            _currentStatement = s;
             visit(s);
         }
     }
+    _currentStatement = 0;
 
     if (!_as->exceptionReturnLabel.isSet())
         visitRet(0);
@@ -168,7 +175,7 @@ void InstructionSelection<JITAssembler>::callBuiltinInvalid(IR::Name *func, IR::
 {
     prepareCallData(args, 0);
 
-    if (useFastLookups && func->global) {
+    if (useGlobalLookups && func->global) {
         uint index = registerGlobalGetterLookup(*func->id);
         generateRuntimeCall(_as, result, callGlobalLookup,
                              JITTargetPlatform::EngineRegister,
@@ -517,7 +524,7 @@ void InstructionSelection<JITAssembler>::loadRegexp(IR::RegExp *sourceRegexp, IR
 template <typename JITAssembler>
 void InstructionSelection<JITAssembler>::getActivationProperty(const IR::Name *name, IR::Expr *target)
 {
-    if (useFastLookups && name->global) {
+    if (useGlobalLookups && name->global) {
         uint index = registerGlobalGetterLookup(*name->id);
         generateLookupCall(target, index, offsetof(QV4::Lookup, globalGetter), JITTargetPlatform::EngineRegister, JITAssembler::Void);
         return;
@@ -812,6 +819,10 @@ template <typename JITAssembler>
 void InstructionSelection<JITAssembler>::binop(IR::AluOp oper, IR::Expr *leftSource, IR::Expr *rightSource, IR::Expr *target)
 {
     QV4::JIT::Binop<JITAssembler> binop(_as, oper);
+    // No use trying the inline number paths when the interpreter only ever saw other types.
+    const quint8 observed = observedTypes(_functionIndex, _currentStatement);
+    if (observed && !(observed & Tiering::ObservedNumber))
+        binop.inlineNumbers = false;
     binop.generate(leftSource, rightSource, target);
 }
 
@@ -1128,7 +1139,7 @@ void InstructionSelection<JITAssembler>::constructActivationProperty(IR::Name *f
     Q_ASSERT(func != 0);
     prepareCallData(args, 0);
 
-    if (useFastLookups && func->global) {
+    if (useGlobalLookups && func->global) {
         uint index = registerGlobalGetterLookup(*func->id);
         generateRuntimeCall(_as, result, constructGlobalLookup,
                              JITTargetPlatform::EngineRegister,
@@ -1238,6 +1249,8 @@ void InstructionSelection<JITAssembler>::visitCJump(IR::CJump *s)
             return;
         }
 
+        visitCJumpObservedNumbers(b, s->iftrue, s->iffalse);
+
         typename JITAssembler::RuntimeCall op;
         typename JITAssembler::RuntimeCall opContext;
         const char *opName = 0;
@@ -1386,6 +1399,43 @@ bool InstructionSelection<JITAssembler>::visitCJumpDouble(IR::AluOp op, IR::Expr
     return true;
 }
 
+// The interpreter only saw numbers as operands of this relational comparison: convert them
+// inline and compare the doubles. When either operand turns out to be something else, the code
+// falls through to the generic comparison that follows.
+template <typename JITAssembler>
+void InstructionSelection<JITAssembler>::visitCJumpObservedNumbers(IR::Binop *binop, IR::BasicBlock *trueBlock,
+                                                                   IR::BasicBlock *falseBlock)
+{
+    switch (binop->op) {
+    case IR::OpGt:
+    case IR::OpLt:
+    case IR::OpGe:
+    case IR::OpLe:
+        break;
+    default:
+        return;
+    }
+
+    if (binop->left->type == IR::StringType || binop->right->type == IR::StringType)
+        return;
+    const quint8 observed = observedTypes(_functionIndex, _currentStatement);
+    if (!observed || (observed & ~Tiering::ObservedNumber))
+        return;
+
+    FPRegisterID lReg = getFreeFPReg<JITAssembler>(binop->right, 2);
+    FPRegisterID rReg = getFreeFPReg<JITAssembler>(binop->left, 4);
+    Jump leftIsNoDbl = _as->genTryDoubleConversion(binop->left, lReg);
+    Jump rightIsNoDbl = _as->genTryDoubleConversion(binop->right, rReg);
+
+    _as->addPatch(trueBlock, _as->branchDouble(false, binop->op, lReg, rReg));
+    _as->addPatch(falseBlock, _as->jump());
+
+    if (leftIsNoDbl.isSet())
+        leftIsNoDbl.link(_as);
+    if (rightIsNoDbl.isSet())
+        rightIsNoDbl.link(_as);
+}
+
 template <typename JITAssembler>
 bool InstructionSelection<JITAssembler>::visitCJumpSInt32(IR::AluOp op, IR::Expr *left, IR::Expr *right,
                                             IR::BasicBlock *iftrue, IR::BasicBlock *iffalse)
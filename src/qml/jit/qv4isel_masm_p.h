@@ -192,6 +192,7 @@ protected:
     bool visitCJumpNullUndefined(IR::Type nullOrUndef, IR::Binop *binop,
                                  IR::BasicBlock *trueBlock, IR::BasicBlock *falseBlock);
     void visitCJumpEqual(IR::Binop *binop, IR::BasicBlock *trueBlock, IR::BasicBlock *falseBlock);
+    void visitCJumpObservedNumbers(IR::Binop *binop, IR::BasicBlock *trueBlock, IR::BasicBlock *falseBlock);
 
 private:
     void convertTypeSlowPath(IR::Expr *source, IR::Expr *target);
@@ -283,6 +284,8 @@ private:
     IR::BasicBlock *_block;
     BitVector _removableJumps;
     JITAssembler* _as;
+    int _functionIndex;
+    IR::Stmt *_currentStatement;
 
     QScopedPointer<CompilationUnit> compilationUnit;
     QQmlEnginePrivate *qmlEngine;
@@ -48,6 +48,7 @@
 #include "private/qv4globalobject_p.h"
 #include "private/qv4script_p.h"
 #include "private/qv4runtime_p.h"
+#include "private/qv4jsonobject_p.h"
 #include <private/qqmlbuiltinfunctions_p.h>
 #include <private/qqmldebugconnector_p.h>
 #include <private/qv4qobjectwrapper_p.h>
@@ -338,7 +339,7 @@ QJSEngine::~QJSEngine()
 */
 void QJSEngine::collectGarbage()
 {
-    d->m_v4Engine->memoryManager->runGC();
+    d->m_v4Engine->memoryManager->runGC(/*forceFullCollection*/true);
 }
 
 #if QT_DEPRECATED_SINCE(5, 6)
@@ -753,6 +754,289 @@ void QJSEnginePrivate::removeFromDebugServer(QJSEngine *q)
         server->removeEngine(q);
 }
 
+/*!
+    \internal
+
+    Sets the per-frame time budget of the garbage collector to \a msecs milliseconds.
+
+    With a budget greater than 0, the marking phase of a full garbage collection is
+    split into small steps, which are driven by the animation timer of the engine's thread
+    and take at most \a msecs milliseconds each. This avoids long pauses when the heap is
+    large. A budget of 0 disables incremental garbage collection.
+
+    Incremental garbage collection tracks modifications of the heap with the soft-dirty
+    page bits of the Linux kernel. As those bits are shared by the whole process, and
+    resetting them interferes with other users like checkpointing tools, they are only used
+    if the \c QV4_MM_SOFT_DIRTY_PAGES environment variable is set. Otherwise, and on other
+    platforms, the budget is ignored.
+
+    The default budget can be set with the \c QV4_MM_INCREMENTAL_GC_BUDGET environment
+    variable. Otherwise it is 0.
+
+    \sa garbageCollectionFrameBudget(), QJSEngine::collectGarbage()
+*/
+void QJSEnginePrivate::setGarbageCollectionFrameBudget(QJSEngine *q, int msecs)
+{
+    QV8Engine::getV4(q->handle())->memoryManager->setIncrementalGCBudget(msecs);
+}
+
+/*!
+    \internal
+
+    Returns the per-frame time budget of the garbage collector in milliseconds.
+
+    \sa setGarbageCollectionFrameBudget()
+*/
+int QJSEnginePrivate::garbageCollectionFrameBudget(const QJSEngine *q)
+{
+    return QV8Engine::getV4(q->handle())->memoryManager->incrementalGCBudget();
+}
+
+/*!
+    \internal
+
+    Sets the number of threads the garbage collector uses to find the reachable objects
+    to \a count, including the thread the engine lives in.
+
+    With more than one thread, the marking phase of a collection is split up between the
+    threads, which shortens the pauses on multi-core systems for large heaps. Small heaps
+    are always marked by the engine's thread alone.
+
+    The default can be set with the \c QV4_MM_GC_THREADS environment variable. Otherwise
+    it is 1.
+
+    \sa garbageCollectionThreadCount(), QJSEngine::collectGarbage()
+*/
+void QJSEnginePrivate::setGarbageCollectionThreadCount(QJSEngine *q, int count)
+{
+    QV8Engine::getV4(q->handle())->memoryManager->setGCThreadCount(count);
+}
+
+/*!
+    \internal
+
+    Returns the number of threads used by the garbage collector.
+
+    \sa setGarbageCollectionThreadCount()
+*/
+int QJSEnginePrivate::garbageCollectionThreadCount(const QJSEngine *q)
+{
+    return QV8Engine::getV4(q->handle())->memoryManager->gcThreadCount();
+}
+
+/*!
+    \internal
+
+    Writes a snapshot of the JavaScript heap to the file \a fileName. Returns \c true
+    on success.
+
+    The snapshot lists every object reachable from the roots of the engine: the JavaScript
+    stack, the persistent values held from C++, and the wrappers of QObjects kept alive by
+    their ownership. It records the type and size of each object and the references between
+    them, in the \c .heapsnapshot format of the Chrome developer tools. Loading it there
+    shows which objects retain memory, for example when a closure keeps a whole tree of
+    delegates alive.
+
+    The heap is not collected or modified when taking a snapshot. Call
+    QJSEngine::collectGarbage() first to leave out the objects that are only referenced
+    through stale stack slots.
+*/
+bool QJSEnginePrivate::writeHeapSnapshot(QJSEngine *q, const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return QV8Engine::getV4(q->handle())->memoryManager->writeHeapSnapshot(&file) && file.flush();
+}
+
+/*!
+    \internal
+
+    Sets the factor by which the JavaScript heap may grow beyond the memory in use after a
+    garbage collection, before the next collection is run, to \a factor. The default is 2.0.
+    Smaller factors save memory at the cost of more frequent collections. The lowest
+    allowed factor is 1.1.
+
+    The default can be set in percent with the \c QV4_MM_HEAP_GROWTH environment variable.
+
+    \sa setMaximumHeapSize(), collectGarbageWhenIdle()
+*/
+void QJSEnginePrivate::setGarbageCollectionGrowthFactor(QJSEngine *q, qreal factor)
+{
+    QV8Engine::getV4(q->handle())->memoryManager->setHeapGrowthFactor(qRound(factor * 100));
+}
+
+/*!
+    \internal
+
+    Returns the factor by which the JavaScript heap may grow before the next garbage
+    collection is run.
+
+    \sa setGarbageCollectionGrowthFactor()
+*/
+qreal QJSEnginePrivate::garbageCollectionGrowthFactor(const QJSEngine *q)
+{
+    return QV8Engine::getV4(q->handle())->memoryManager->heapGrowthFactor() / qreal(100);
+}
+
+/*!
+    \internal
+
+    Sets the size of the JavaScript heap in \a bytes above which the garbage collector runs
+    as often as needed to keep the heap from growing further. Memory that is still in use is
+    never freed, so the heap can grow beyond this size. A size of 0, the default, means
+    there is no limit.
+
+    The default can be set with the \c QV4_MM_MAX_HEAP_SIZE environment variable.
+
+    \sa maximumHeapSize(), setGarbageCollectionGrowthFactor()
+*/
+void QJSEnginePrivate::setMaximumHeapSize(QJSEngine *q, qint64 bytes)
+{
+    QV8Engine::getV4(q->handle())->memoryManager->setMaximumHeapSize(
+                static_cast<std::size_t>(qMax<qint64>(0, bytes)));
+}
+
+/*!
+    \internal
+
+    Returns the size of the JavaScript heap above which garbage is collected aggressively,
+    or 0 if there is no limit.
+
+    \sa setMaximumHeapSize()
+*/
+qint64 QJSEnginePrivate::maximumHeapSize(const QJSEngine *q)
+{
+    return static_cast<qint64>(QV8Engine::getV4(q->handle())->memoryManager->maximumHeapSize());
+}
+
+/*!
+    \internal
+
+    Uses up to \a msecs milliseconds of idle time for garbage collection, for example when
+    the render loop finished a frame early. Returns \c true if any collection work was done.
+
+    An incremental collection in progress is continued. Otherwise a collection is only run
+    if a good part of the heap growth allowed until the next collection was already
+    allocated, and if it's expected to fit into the idle time. Collections done at idle time
+    are then not needed while the application is busy.
+
+    \sa collectGarbageIfCheap(), setGarbageCollectionFrameBudget()
+*/
+bool QJSEnginePrivate::collectGarbageWhenIdle(QJSEngine *q, int msecs)
+{
+    return QV8Engine::getV4(q->handle())->memoryManager->collectWhenIdle(msecs);
+}
+
+/*!
+    \internal
+
+    Runs the garbage collector if it's expected to take less than a millisecond, or less
+    than the frame budget if one is set. Returns \c true if the collection was run.
+
+    The cost of a collection is estimated from the duration of the last one and the current
+    size of the heap.
+
+    \sa QJSEngine::collectGarbage(), collectGarbageWhenIdle(), garbageCollectionNotifier()
+*/
+bool QJSEnginePrivate::collectGarbageIfCheap(QJSEngine *q)
+{
+    return QV8Engine::getV4(q->handle())->memoryManager->collectIfCheap();
+}
+
+/*!
+    \internal
+
+    Returns the object that notifies about the garbage collections of the engine \a q,
+    creating it if necessary.
+
+    \sa QJSEngineGarbageCollectionNotifier
+*/
+QJSEngineGarbageCollectionNotifier *QJSEnginePrivate::garbageCollectionNotifier(QJSEngine *q)
+{
+    QJSEnginePrivate *d = get(q);
+    if (!d->gcNotifier)
+        d->gcNotifier = new QJSEngineGarbageCollectionNotifier(q);
+    return d->gcNotifier;
+}
+
+/*!
+    \class QJSEngineGarbageCollectionNotifier
+    \internal
+
+    Emits garbageCollected(qint64 pauseNsecs, qint64 heapSizeBefore, qint64 heapSizeAfter)
+    after each garbage collection of its engine. \a pauseNsecs is the time in nanoseconds
+    the engine was blocked by the collection, \a heapSizeBefore and \a heapSizeAfter the
+    size of the JavaScript heap in bytes before and after it.
+
+    The signal is delivered through the event loop, as collections run in the middle of
+    allocations where no JavaScript code may be executed. It's only posted if something is
+    connected to it.
+*/
+
+/*!
+    \internal
+
+    Returns \c true if something is connected to garbageCollected().
+*/
+bool QJSEngineGarbageCollectionNotifier::isGarbageCollectedConnected() const
+{
+    static const QMetaMethod garbageCollectedSignal
+            = QMetaMethod::fromSignal(&QJSEngineGarbageCollectionNotifier::garbageCollected);
+    return isSignalConnected(garbageCollectedSignal);
+}
+
+/*!
+    \internal
+
+    Returns \a value serialized as UTF-8 encoded JSON, the same way \c JSON.stringify()
+    serializes it. With an \a indent greater than 0, nested objects and arrays are put on
+    separate lines, indented by that many spaces per level, up to 10.
+
+    Returns an empty byte array if the value can't be serialized, for example because it is
+    undefined or a function, or because it contains a cycle.
+
+    \sa writeJson()
+*/
+QByteArray QJSEnginePrivate::toJson(QJSEngine *q, const QJSValue &value, int indent)
+{
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(q->handle());
+    QV4::Scope scope(v4);
+    QV4::ScopedValue v(scope, QJSValuePrivate::convertedToValue(v4, value));
+    QByteArray json;
+    if (!QV4::JsonObject::writeJson(v4, v, QString(qBound(0, indent, 10), QLatin1Char(' ')), &json))
+        return QByteArray();
+    return json;
+}
+
+/*!
+    \internal
+
+    Writes \a value as UTF-8 encoded JSON to \a device, the same way \c JSON.stringify()
+    serializes it. Returns \c true on success.
+
+    The output is written in pieces while the value is traversed, so serializing large
+    values doesn't need memory for the whole output. With an \a indent greater than 0,
+    nested objects and arrays are put on separate lines, indented by that many spaces per
+    level, up to 10.
+
+    The function fails if the value can't be serialized, for example because it is
+    undefined or a function, or because it contains a cycle. In that case, part of the
+    output may already have been written to the device.
+
+    \sa toJson()
+*/
+bool QJSEnginePrivate::writeJson(QJSEngine *q, const QJSValue &value, QIODevice *device, int indent)
+{
+    if (!device)
+        return false;
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(q->handle());
+    QV4::Scope scope(v4);
+    QV4::ScopedValue v(scope, QJSValuePrivate::convertedToValue(v4, value));
+    QByteArray buffer;
+    return QV4::JsonObject::writeJson(v4, v, QString(qBound(0, indent, 10), QLatin1Char(' ')), &buffer, device);
+}
+
 /*!
    \since 5.5
    \relates QJSEngine
@@ -774,3 +1058,4 @@ QJSEngine *qjsEngine(const QObject *object)
 QT_END_NAMESPACE
 
 #include "moc_qjsengine.cpp"
+#include "moc_qjsengine_p.cpp"
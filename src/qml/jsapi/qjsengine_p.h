@@ -60,6 +60,8 @@
 QT_BEGIN_NAMESPACE
 
 class QQmlPropertyCache;
+class QJSEngineGarbageCollectionNotifier;
+class QIODevice;
 
 namespace QV4 {
 struct ExecutionEngine;
@@ -80,6 +82,26 @@ public:
     static void addToDebugServer(QJSEngine *q);
     static void removeFromDebugServer(QJSEngine *q);
 
+    // Garbage collector tuning. Private, so that it can still change before it's made public.
+    static void setGarbageCollectionFrameBudget(QJSEngine *q, int msecs);
+    static int garbageCollectionFrameBudget(const QJSEngine *q);
+    static void setGarbageCollectionThreadCount(QJSEngine *q, int count);
+    static int garbageCollectionThreadCount(const QJSEngine *q);
+
+    static void setGarbageCollectionGrowthFactor(QJSEngine *q, qreal factor);
+    static qreal garbageCollectionGrowthFactor(const QJSEngine *q);
+    static void setMaximumHeapSize(QJSEngine *q, qint64 bytes);
+    static qint64 maximumHeapSize(const QJSEngine *q);
+    static bool collectGarbageWhenIdle(QJSEngine *q, int msecs);
+    static bool collectGarbageIfCheap(QJSEngine *q);
+    static QJSEngineGarbageCollectionNotifier *garbageCollectionNotifier(QJSEngine *q);
+
+    static bool writeHeapSnapshot(QJSEngine *q, const QString &fileName);
+
+    // JSON serialization without going through a JSON.stringify() call
+    static QByteArray toJson(QJSEngine *q, const QJSValue &value, int indent = 0);
+    static bool writeJson(QJSEngine *q, const QJSValue &value, QIODevice *device, int indent = 0);
+
     // Locker locks the QQmlEnginePrivate data structures for read and write, if necessary.
     // Currently, locking is only necessary if the threaded loader is running concurrently.  If it is
     // either idle, or is running with the main thread blocked, no locking is necessary.  This way
@@ -107,12 +129,25 @@ public:
     // Shared by QQmlEngine
     mutable QMutex mutex;
 
+    QJSEngineGarbageCollectionNotifier *gcNotifier = nullptr;
 
     // These methods may be called from the QML loader thread
     inline QQmlPropertyCache *cache(QObject *obj);
     inline QQmlPropertyCache *cache(const QMetaObject *);
 };
 
+class Q_QML_PRIVATE_EXPORT QJSEngineGarbageCollectionNotifier : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QJSEngineGarbageCollectionNotifier(QJSEngine *engine) : QObject(engine) {}
+
+    bool isGarbageCollectedConnected() const;
+
+Q_SIGNALS:
+    void garbageCollected(qint64 pauseNsecs, qint64 heapSizeBefore, qint64 heapSizeAfter);
+};
+
 QJSEnginePrivate::Locker::Locker(const QJSEngine *e)
 : m_ep(QJSEnginePrivate::get(e))
 {
@@ -35,6 +35,8 @@ SOURCES += \
     $$PWD/qv4regexp.cpp \
     $$PWD/qv4serialize.cpp \
     $$PWD/qv4script.cpp \
+    $$PWD/qv4tiering.cpp \
+    $$PWD/qv4perfmap.cpp \
     $$PWD/qv4sequenceobject.cpp \
     $$PWD/qv4include.cpp \
     $$PWD/qv4qobjectwrapper.cpp \
@@ -81,8 +83,11 @@ HEADERS += \
     $$PWD/qv4property_p.h \
     $$PWD/qv4objectiterator_p.h \
     $$PWD/qv4regexp_p.h \
+    $$PWD/qv4regexpcache_p.h \
     $$PWD/qv4serialize_p.h \
     $$PWD/qv4script_p.h \
+    $$PWD/qv4tiering_p.h \
+    $$PWD/qv4perfmap_p.h \
     $$PWD/qv4scopedvalue_p.h \
     $$PWD/qv4executableallocator_p.h \
     $$PWD/qv4sequenceobject_p.h \
@@ -146,12 +146,27 @@ void ArrayData::realloc(Object *o, Type newType, uint requested, bool enforceAtt
     if (enforceAttributes)
         size += alloc*sizeof(PropertyAttributes);
 
+    if (d && newType == Heap::ArrayData::Simple && d->type() == Heap::ArrayData::Simple) {
+        // Huge arrays can usually grow in place, which saves copying all the elements.
+        Heap::SimpleArrayData *sd = static_cast<Heap::SimpleArrayData *>(d->d());
+        const uint oldAlloc = sd->alloc;
+        if (scope.engine->memoryManager->tryGrow(sd, size)) {
+            // move the elements wrapped around to the start behind the old end
+            if (sd->offset + sd->len > oldAlloc)
+                memcpy(sd->arrayData + oldAlloc, sd->arrayData, sizeof(Value)*(sd->offset + sd->len - oldAlloc));
+            sd->alloc = alloc;
+            return;
+        }
+    }
+
     Scoped<ArrayData> newData(scope);
     if (newType < Heap::ArrayData::Sparse) {
-        Heap::SimpleArrayData *n = scope.engine->memoryManager->allocManaged<SimpleArrayData>(size);
+        Heap::SimpleArrayData *n = scope.engine->memoryManager->allocManaged<SimpleArrayData>(
+                    size, /*growable*/ newType == Heap::ArrayData::Simple);
         n->init();
         n->offset = 0;
         n->len = d ? d->d()->len : 0;
+        n->elementKind = d ? d->d()->elementKind : Heap::ArrayData::PackedInt32;
         newData = n;
     } else {
         Heap::SparseArrayData *n = scope.engine->memoryManager->allocManaged<SparseArrayData>(size);
@@ -239,6 +254,8 @@ void ArrayData::ensureAttributes(Object *o)
 void SimpleArrayData::markObjects(Heap::Base *d, ExecutionEngine *e)
 {
     Heap::SimpleArrayData *dd = static_cast<Heap::SimpleArrayData *>(d);
+    if (dd->isPacked())
+        return; // numbers only, nothing to mark
     uint end = dd->offset + dd->len;
     if (end > dd->alloc) {
         for (uint i = 0; i < end - dd->alloc; ++i)
@@ -262,7 +279,9 @@ bool SimpleArrayData::put(Object *o, uint index, const Value &value)
     Heap::SimpleArrayData *dd = o->d()->arrayData.cast<Heap::SimpleArrayData>();
     Q_ASSERT(index >= dd->len || !dd->attrs || !dd->attrs[index].isAccessor());
     // ### honour attributes
-    dd->data(index) = value;
+    if (index > dd->len)
+        dd->elementKind = Heap::ArrayData::Generic;
+    dd->setData(index, value);
     if (index >= dd->len) {
         if (dd->attrs)
             dd->attrs[index] = Attr_Data;
@@ -278,7 +297,7 @@ bool SimpleArrayData::del(Object *o, uint index)
         return true;
 
     if (!dd->attrs || dd->attrs[index].isConfigurable()) {
-        dd->data(index) = Primitive::emptyValue();
+        dd->setData(index, Primitive::emptyValue());
         if (dd->attrs)
             dd->attrs[index] = Attr_Data;
         return true;
@@ -311,7 +330,7 @@ void SimpleArrayData::push_front(Object *o, const Value *values, uint n)
     }
     dd->len += n;
     for (uint i = 0; i < n; ++i)
-        dd->data(i) = values[i].asReturnedValue();
+        dd->setData(i, values[i]);
 }
 
 ReturnedValue SimpleArrayData::pop_front(Object *o)
@@ -335,6 +354,8 @@ uint SimpleArrayData::truncate(Object *o, uint newLen)
 
     if (!dd->attrs) {
         dd->len = newLen;
+        if (!newLen)
+            dd->elementKind = Heap::ArrayData::PackedInt32;
         return newLen;
     }
 
@@ -359,9 +380,9 @@ bool SimpleArrayData::putArray(Object *o, uint index, const Value *values, uint
         dd = o->d()->arrayData.cast<Heap::SimpleArrayData>();
     }
     for (uint i = dd->len; i < index; ++i)
-        dd->data(i) = Primitive::emptyValue();
+        dd->setData(i, Primitive::emptyValue());
     for (uint i = 0; i < n; ++i)
-        dd->data(index + i) = values[i];
+        dd->setData(index + i, values[i]);
     dd->len = qMax(dd->len, index + n);
     return true;
 }
@@ -648,10 +669,10 @@ void ArrayData::insert(Object *o, uint index, const Value *v, bool isAccessor)
             if (index >= d->len) {
                 // mark possible hole in the array
                 for (uint i = d->len; i < index; ++i)
-                    d->data(i) = Primitive::emptyValue();
+                    d->setData(i, Primitive::emptyValue());
                 d->len = index + 1;
             }
-            d->arrayData[d->mappedIndex(index)] = *v;
+            d->setData(index, *v);
             return;
         }
     }
@@ -801,7 +822,7 @@ void ArrayData::sort(ExecutionEngine *engine, Object *thisObject, const Value &c
                     break;
 
                 PropertyAttributes a = sparse->attrs() ? sparse->attrs()[n->value] : Attr_Data;
-                d->data(i) = thisObject->getValue(sparse->arrayData()[n->value], a);
+                d->setData(i, thisObject->getValue(sparse->arrayData()[n->value], a));
                 d->attrs[i] = a.isAccessor() ? Attr_Data : a;
 
                 n = n->nextNode();
@@ -811,7 +832,7 @@ void ArrayData::sort(ExecutionEngine *engine, Object *thisObject, const Value &c
             while (n != sparse->sparse()->end()) {
                 if (n->value >= len)
                     break;
-                d->data(i) = sparse->arrayData()[n->value];
+                d->setData(i, sparse->arrayData()[n->value]);
                 n = n->nextNode();
                 ++i;
             }
@@ -842,8 +863,8 @@ void ArrayData::sort(ExecutionEngine *engine, Object *thisObject, const Value &c
                     if (!d->data(len).isEmpty())
                         break;
                 Q_ASSERT(!d->attrs || !d->attrs[len].isAccessor());
-                d->data(i) = d->data(len);
-                d->data(len) = Primitive::emptyValue();
+                d->setData(i, d->data(len));
+                d->setData(len, Primitive::emptyValue());
             }
         }
 
@@ -98,11 +98,23 @@ struct ArrayData : public Base {
         Custom = 3
     };
 
+    // What a Simple array holds in its first len elements. Packed kinds have no holes
+    // and only numbers, so the GC doesn't have to mark them and reads don't need to
+    // look at the prototype. The kind only ever becomes more generic.
+    enum ElementKind {
+        PackedInt32 = 0,
+        PackedDouble = 1,
+        Generic = 2
+    };
+
     uint alloc;
     Type type;
     PropertyAttributes *attrs;
     union {
-        uint len;
+        struct {
+            uint len;
+            ElementKind elementKind;
+        };
         ReturnedValue freeList;
     };
     union {
@@ -138,7 +150,17 @@ V4_ASSERT_IS_TRIVIAL(ArrayData)
 struct SimpleArrayData : public ArrayData {
     uint mappedIndex(uint index) const { return (index + offset) % alloc; }
     Value data(uint index) const { return arrayData[mappedIndex(index)]; }
-    Value &data(uint index) { return arrayData[mappedIndex(index)]; }
+    void setData(uint index, const Value &value) {
+        updateElementKind(value);
+        arrayData[mappedIndex(index)] = value;
+    }
+
+    bool isPacked() const { return type == Simple && elementKind != Generic; }
+    void updateElementKind(const Value &value) {
+        if (elementKind == Generic || value.isInteger())
+            return;
+        elementKind = value.isDouble() ? PackedDouble : Generic;
+    }
 
     Property *getProperty(uint index) {
         if (index >= len)
@@ -240,7 +262,7 @@ struct Q_QML_EXPORT SimpleArrayData : public ArrayData
 
     uint mappedIndex(uint index) const { return d()->mappedIndex(index); }
     Value data(uint index) const { return d()->data(index); }
-    Value &data(uint index) { return d()->data(index); }
+    void setData(uint index, const Value &value) { d()->setData(index, value); }
 
     uint &len() { return d()->len; }
     uint len() const { return d()->len; }
@@ -309,6 +331,8 @@ void ArrayData::setProperty(uint index, const Property *p)
     pd->value = p->value;
     if (attributes(index).isAccessor())
         pd->set = p->set;
+    if (!isSparse())
+        static_cast<SimpleArrayData *>(this)->updateElementKind(p->value);
 }
 
 inline Property *ArrayData::getProperty(uint index)
@@ -333,6 +357,9 @@ Value *ArrayData::getValueOrSetter(uint index, PropertyAttributes *attrs)
         return 0;
     }
 
+    // the caller can write anything through the returned pointer
+    if (!isSparse())
+        static_cast<SimpleArrayData *>(this)->elementKind = Generic;
     *attrs = attributes(index);
     return attrs->isAccessor() ? &p->set : &p->value;
 }
@@ -50,6 +50,8 @@
 
 #include <time.h>
 
+#include <algorithm>
+
 #include <private/qqmljsengine_p.h>
 
 #include <wtf/MathExtras.h>
@@ -307,14 +309,78 @@ static inline double DaylightSavingTA(double t)
     return (tmtm.tm_isdst > 0) ? msPerHour : 0;
 }
 
-static inline double LocalTime(double t)
+// Incremented when the time zone changes, to invalidate the caches of all engines
+static QBasicAtomicInt timezoneChanges = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+// Two points in time less than this apart are assumed to be in the same interval if they have
+// the same daylight saving offset. Time zones don't switch back and forth that quickly.
+static const double MaxDaylightSavingGap = 19 * msPerDay;
+
+double DaylightSavingCache::daylightSavingTA(double t)
+{
+    if (!qt_is_finite(t))
+        return DaylightSavingTA(t);
+
+    const int changes = timezoneChanges.load();
+    if (changes != timezoneGeneration || intervals.size() > 1024) {
+        intervals.clear();
+        timezoneGeneration = changes;
+    }
+
+    // find the interval starting at or before t
+    const auto it = std::upper_bound(intervals.cbegin(), intervals.cend(), t,
+                                     [](double t, const Interval &interval) { return t < interval.start; });
+    int i = int(it - intervals.cbegin()) - 1;
+    if (i >= 0 && t <= intervals.at(i).end)
+        return intervals.at(i).offset;
+
+    const double offset = DaylightSavingTA(t);
+    const bool joinsBefore = i >= 0 && intervals.at(i).offset == offset
+            && t - intervals.at(i).end <= MaxDaylightSavingGap;
+    const bool joinsAfter = i + 1 < intervals.size() && intervals.at(i + 1).offset == offset
+            && intervals.at(i + 1).start - t <= MaxDaylightSavingGap;
+    if (joinsBefore && joinsAfter) {
+        intervals[i].end = intervals.at(i + 1).end;
+        intervals.remove(i + 1);
+        return offset;
+    } else if (joinsBefore) {
+        intervals[i].end = t;
+    } else if (joinsAfter) {
+        intervals[++i].start = t;
+    } else {
+        const Interval interval = { t, t, offset };
+        intervals.insert(++i, interval);
+    }
+
+    // Look ahead and behind, so that the following dates of a sequence hit the cache
+    Interval &interval = intervals[i];
+    if (interval.end == t && (i + 1 == intervals.size()
+                              || intervals.at(i + 1).start - t > MaxDaylightSavingGap)) {
+        if (DaylightSavingTA(t + MaxDaylightSavingGap) == offset)
+            interval.end = t + MaxDaylightSavingGap;
+    }
+    if (interval.start == t && (i == 0 || t - intervals.at(i - 1).end > MaxDaylightSavingGap)) {
+        if (DaylightSavingTA(t - MaxDaylightSavingGap) == offset)
+            interval.start = t - MaxDaylightSavingGap;
+    }
+    return offset;
+}
+
+static inline double DaylightSavingTA(double t, ExecutionEngine *engine)
+{
+    if (!engine->daylightSavingCache)
+        engine->daylightSavingCache = new DaylightSavingCache;
+    return engine->daylightSavingCache->daylightSavingTA(t);
+}
+
+static inline double LocalTime(double t, ExecutionEngine *engine)
 {
-    return t + LocalTZA + DaylightSavingTA(t);
+    return t + LocalTZA + DaylightSavingTA(t, engine);
 }
 
-static inline double UTC(double t)
+static inline double UTC(double t, ExecutionEngine *engine)
 {
-    return t - LocalTZA - DaylightSavingTA(t - LocalTZA);
+    return t - LocalTZA - DaylightSavingTA(t - LocalTZA, engine);
 }
 
 static inline double currentTime()
@@ -561,12 +627,12 @@ static inline QDateTime ToDateTime(double t, Qt::TimeSpec spec)
     return QDateTime::fromMSecsSinceEpoch(t, spec);
 }
 
-static inline QString ToString(double t)
+static inline QString ToString(double t, ExecutionEngine *engine)
 {
     if (std::isnan(t))
         return QStringLiteral("Invalid Date");
     QString str = ToDateTime(t, Qt::LocalTime).toString() + QLatin1String(" GMT");
-    double tzoffset = LocalTZA + DaylightSavingTA(t);
+    double tzoffset = LocalTZA + DaylightSavingTA(t, engine);
     if (tzoffset) {
         int hours = static_cast<int>(::fabs(tzoffset) / 1000 / 60 / 60);
         int mins = int(::fabs(tzoffset) / 1000 / 60) % 60;
@@ -660,7 +726,7 @@ void Heap::DateObject::init(const QTime &time)
      */
     static const double d = MakeDay(0, 0, 0);
     double t = MakeTime(time.hour(), time.minute(), time.second(), time.msec());
-    date = TimeClip(UTC(MakeDate(d, t)));
+    date = TimeClip(UTC(MakeDate(d, t), internalClass->engine));
 }
 
 QDateTime DateObject::toQDateTime() const
@@ -707,7 +773,7 @@ void DateCtor::construct(const Managed *, Scope &scope, CallData *callData)
         if (year >= 0 && year <= 99)
             year += 1900;
         t = MakeDate(MakeDay(year, month, day), MakeTime(hours, mins, secs, ms));
-        t = TimeClip(UTC(t));
+        t = TimeClip(UTC(t, scope.engine));
     }
 
     scope.result = Encode(scope.engine->newDateObject(Primitive::fromDouble(t)));
@@ -716,7 +782,7 @@ void DateCtor::construct(const Managed *, Scope &scope, CallData *callData)
 void DateCtor::call(const Managed *m, Scope &scope, CallData *)
 {
     double t = currentTime();
-    scope.result = static_cast<const DateCtor *>(m)->engine()->newString(ToString(t));
+    scope.result = static_cast<const DateCtor *>(m)->engine()->newString(ToString(t, scope.engine));
 }
 
 void DatePrototype::init(ExecutionEngine *engine, Object *ctor)
@@ -829,7 +895,7 @@ void DatePrototype::method_now(const BuiltinFunction *, Scope &scope, CallData *
 void DatePrototype::method_toString(const BuiltinFunction *, Scope &scope, CallData *callData)
 {
     double t = getThisDate(scope, callData);
-    scope.result = scope.engine->newString(ToString(t));
+    scope.result = scope.engine->newString(ToString(t, scope.engine));
 }
 
 void DatePrototype::method_toDateString(const BuiltinFunction *, Scope &scope, CallData *callData)
@@ -878,7 +944,7 @@ void DatePrototype::method_getYear(const BuiltinFunction *, Scope &scope, CallDa
 {
     double t = getThisDate(scope, callData);
     if (!std::isnan(t))
-        t = YearFromTime(LocalTime(t)) - 1900;
+        t = YearFromTime(LocalTime(t, scope.engine)) - 1900;
     scope.result = Encode(t);
 }
 
@@ -886,7 +952,7 @@ void DatePrototype::method_getFullYear(const BuiltinFunction *, Scope &scope, Ca
 {
     double t = getThisDate(scope, callData);
     if (!std::isnan(t))
-        t = YearFromTime(LocalTime(t));
+        t = YearFromTime(LocalTime(t, scope.engine));
     scope.result = Encode(t);
 }
 
@@ -902,7 +968,7 @@ void DatePrototype::method_getMonth(const BuiltinFunction *, Scope &scope, CallD
 {
     double t = getThisDate(scope, callData);
     if (!std::isnan(t))
-        t = MonthFromTime(LocalTime(t));
+        t = MonthFromTime(LocalTime(t, scope.engine));
     scope.result = Encode(t);
 }
 
@@ -918,7 +984,7 @@ void DatePrototype::method_getDate(const BuiltinFunction *, Scope &scope, CallDa
 {
     double t = getThisDate(scope, callData);
     if (!std::isnan(t))
-        t = DateFromTime(LocalTime(t));
+        t = DateFromTime(LocalTime(t, scope.engine));
     scope.result = Encode(t);
 }
 
@@ -934,7 +1000,7 @@ void DatePrototype::method_getDay(const BuiltinFunction *, Scope &scope, CallDat
 {
     double t = getThisDate(scope, callData);
     if (!std::isnan(t))
-        t = WeekDay(LocalTime(t));
+        t = WeekDay(LocalTime(t, scope.engine));
     scope.result = Encode(t);
 }
 
@@ -950,7 +1016,7 @@ void DatePrototype::method_getHours(const BuiltinFunction *, Scope &scope, CallD
 {
     double t = getThisDate(scope, callData);
     if (!std::isnan(t))
-        t = HourFromTime(LocalTime(t));
+        t = HourFromTime(LocalTime(t, scope.engine));
     scope.result = Encode(t);
 }
 
@@ -966,7 +1032,7 @@ void DatePrototype::method_getMinutes(const BuiltinFunction *, Scope &scope, Cal
 {
     double t = getThisDate(scope, callData);
     if (!std::isnan(t))
-        t = MinFromTime(LocalTime(t));
+        t = MinFromTime(LocalTime(t, scope.engine));
     scope.result = Encode(t);
 }
 
@@ -982,7 +1048,7 @@ void DatePrototype::method_getSeconds(const BuiltinFunction *, Scope &scope, Cal
 {
     double t = getThisDate(scope, callData);
     if (!std::isnan(t))
-        t = SecFromTime(LocalTime(t));
+        t = SecFromTime(LocalTime(t, scope.engine));
     scope.result = Encode(t);
 }
 
@@ -998,7 +1064,7 @@ void DatePrototype::method_getMilliseconds(const BuiltinFunction *, Scope &scope
 {
     double t = getThisDate(scope, callData);
     if (!std::isnan(t))
-        t = msFromTime(LocalTime(t));
+        t = msFromTime(LocalTime(t, scope.engine));
     scope.result = Encode(t);
 }
 
@@ -1014,7 +1080,7 @@ void DatePrototype::method_getTimezoneOffset(const BuiltinFunction *, Scope &sco
 {
     double t = getThisDate(scope, callData);
     if (!std::isnan(t))
-        t = (t - LocalTime(t)) / msPerMinute;
+        t = (t - LocalTime(t, scope.engine)) / msPerMinute;
     scope.result = Encode(t);
 }
 
@@ -1035,9 +1101,9 @@ void DatePrototype::method_setMilliseconds(const BuiltinFunction *, Scope &scope
     if (!self)
         THROW_TYPE_ERROR();
 
-    double t = LocalTime(self->date());
+    double t = LocalTime(self->date(), scope.engine);
     double ms = callData->argc ? callData->args[0].toNumber() : qt_qnan();
-    self->setDate(TimeClip(UTC(MakeDate(Day(t), MakeTime(HourFromTime(t), MinFromTime(t), SecFromTime(t), ms)))));
+    self->setDate(TimeClip(UTC(MakeDate(Day(t), MakeTime(HourFromTime(t), MinFromTime(t), SecFromTime(t), ms)), scope.engine)));
     scope.result = Encode(self->date());
 }
 
@@ -1059,10 +1125,10 @@ void DatePrototype::method_setSeconds(const BuiltinFunction *, Scope &scope, Cal
     if (!self)
         THROW_TYPE_ERROR();
 
-    double t = LocalTime(self->date());
+    double t = LocalTime(self->date(), scope.engine);
     double sec = callData->argc ? callData->args[0].toNumber() : qt_qnan();
     double ms = (callData->argc < 2) ? msFromTime(t) : callData->args[1].toNumber();
-    t = TimeClip(UTC(MakeDate(Day(t), MakeTime(HourFromTime(t), MinFromTime(t), sec, ms))));
+    t = TimeClip(UTC(MakeDate(Day(t), MakeTime(HourFromTime(t), MinFromTime(t), sec, ms)), scope.engine));
     self->setDate(t);
     scope.result = Encode(self->date());
 }
@@ -1087,11 +1153,11 @@ void DatePrototype::method_setMinutes(const BuiltinFunction *, Scope &scope, Cal
     if (!self)
         THROW_TYPE_ERROR();
 
-    double t = LocalTime(self->date());
+    double t = LocalTime(self->date(), scope.engine);
     double min = callData->argc ? callData->args[0].toNumber() : qt_qnan();
     double sec = (callData->argc < 2) ? SecFromTime(t) : callData->args[1].toNumber();
     double ms = (callData->argc < 3) ? msFromTime(t) : callData->args[2].toNumber();
-    t = TimeClip(UTC(MakeDate(Day(t), MakeTime(HourFromTime(t), min, sec, ms))));
+    t = TimeClip(UTC(MakeDate(Day(t), MakeTime(HourFromTime(t), min, sec, ms)), scope.engine));
     self->setDate(t);
     scope.result = Encode(self->date());
 }
@@ -1117,12 +1183,12 @@ void DatePrototype::method_setHours(const BuiltinFunction *, Scope &scope, CallD
     if (!self)
         THROW_TYPE_ERROR();
 
-    double t = LocalTime(self->date());
+    double t = LocalTime(self->date(), scope.engine);
     double hour = callData->argc ? callData->args[0].toNumber() : qt_qnan();
     double min = (callData->argc < 2) ? MinFromTime(t) : callData->args[1].toNumber();
     double sec = (callData->argc < 3) ? SecFromTime(t) : callData->args[2].toNumber();
     double ms = (callData->argc < 4) ? msFromTime(t) : callData->args[3].toNumber();
-    t = TimeClip(UTC(MakeDate(Day(t), MakeTime(hour, min, sec, ms))));
+    t = TimeClip(UTC(MakeDate(Day(t), MakeTime(hour, min, sec, ms)), scope.engine));
     self->setDate(t);
     scope.result = Encode(self->date());
 }
@@ -1149,9 +1215,9 @@ void DatePrototype::method_setDate(const BuiltinFunction *, Scope &scope, CallDa
     if (!self)
         THROW_TYPE_ERROR();
 
-    double t = LocalTime(self->date());
+    double t = LocalTime(self->date(), scope.engine);
     double date = callData->argc ? callData->args[0].toNumber() : qt_qnan();
-    t = TimeClip(UTC(MakeDate(MakeDay(YearFromTime(t), MonthFromTime(t), date), TimeWithinDay(t))));
+    t = TimeClip(UTC(MakeDate(MakeDay(YearFromTime(t), MonthFromTime(t), date), TimeWithinDay(t)), scope.engine));
     self->setDate(t);
     scope.result = Encode(self->date());
 }
@@ -1175,10 +1241,10 @@ void DatePrototype::method_setMonth(const BuiltinFunction *, Scope &scope, CallD
     if (!self)
         THROW_TYPE_ERROR();
 
-    double t = LocalTime(self->date());
+    double t = LocalTime(self->date(), scope.engine);
     double month = callData->argc ? callData->args[0].toNumber() : qt_qnan();
     double date = (callData->argc < 2) ? DateFromTime(t) : callData->args[1].toNumber();
-    t = TimeClip(UTC(MakeDate(MakeDay(YearFromTime(t), month, date), TimeWithinDay(t))));
+    t = TimeClip(UTC(MakeDate(MakeDay(YearFromTime(t), month, date), TimeWithinDay(t)), scope.engine));
     self->setDate(t);
     scope.result = Encode(self->date());
 }
@@ -1207,7 +1273,7 @@ void DatePrototype::method_setYear(const BuiltinFunction *, Scope &scope, CallDa
     if (std::isnan(t))
         t = 0;
     else
-        t = LocalTime(t);
+        t = LocalTime(t, scope.engine);
     double year = callData->argc ? callData->args[0].toNumber() : qt_qnan();
     double r;
     if (std::isnan(year)) {
@@ -1216,7 +1282,7 @@ void DatePrototype::method_setYear(const BuiltinFunction *, Scope &scope, CallDa
         if ((Primitive::toInteger(year) >= 0) && (Primitive::toInteger(year) <= 99))
             year += 1900;
         r = MakeDay(year, MonthFromTime(t), DateFromTime(t));
-        r = UTC(MakeDate(r, TimeWithinDay(t)));
+        r = UTC(MakeDate(r, TimeWithinDay(t)), scope.engine);
         r = TimeClip(r);
     }
     self->setDate(r);
@@ -1244,13 +1310,13 @@ void DatePrototype::method_setFullYear(const BuiltinFunction *, Scope &scope, Ca
     if (!self)
         THROW_TYPE_ERROR();
 
-    double t = LocalTime(self->date());
+    double t = LocalTime(self->date(), scope.engine);
     if (std::isnan(t))
         t = 0;
     double year = callData->argc ? callData->args[0].toNumber() : qt_qnan();
     double month = (callData->argc < 2) ? MonthFromTime(t) : callData->args[1].toNumber();
     double date = (callData->argc < 3) ? DateFromTime(t) : callData->args[2].toNumber();
-    t = TimeClip(UTC(MakeDate(MakeDay(year, month, date), TimeWithinDay(t))));
+    t = TimeClip(UTC(MakeDate(MakeDay(year, month, date), TimeWithinDay(t)), scope.engine));
     self->setDate(t);
     scope.result = Encode(self->date());
 }
@@ -1341,4 +1407,5 @@ void DatePrototype::method_toJSON(const BuiltinFunction *, Scope &scope, CallDat
 void DatePrototype::timezoneUpdated()
 {
     LocalTZA = getLocalTZA();
+    timezoneChanges.ref();
 }
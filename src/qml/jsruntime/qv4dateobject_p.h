@@ -53,6 +53,7 @@
 #include "qv4object_p.h"
 #include "qv4functionobject_p.h"
 #include <QtCore/private/qnumeric_p.h>
+#include <QtCore/qvector.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -112,6 +113,23 @@ struct DateCtor: FunctionObject
     static void call(const Managed *that, Scope &scope, CallData *);
 };
 
+// Remembers intervals of time in which daylight saving time is either in effect or not, so
+// that most conversions between local time and UTC don't need to ask the C library. The
+// intervals are dropped when the time zone changes.
+struct DaylightSavingCache
+{
+    double daylightSavingTA(double t);
+
+private:
+    struct Interval {
+        double start;
+        double end;
+        double offset;
+    };
+    QVector<Interval> intervals; // sorted and disjoint
+    int timezoneGeneration = -1;
+};
+
 struct DatePrototype: DateObject
 {
     V4_PROTOTYPE(objectPrototype)
@@ -60,6 +60,7 @@
 #include <qv4jsonobject_p.h>
 #include <qv4stringobject_p.h>
 #include <qv4identifiertable_p.h>
+#include <qv4lookup_p.h>
 #include "qv4debugging_p.h"
 #include "qv4profiling_p.h"
 #include "qv4executableallocator_p.h"
@@ -89,6 +90,8 @@
 #include "qv4isel_moth_p.h"
 #endif
 
+#include "qv4tiering_p.h"
+
 #if USE(PTHREADS)
 #  include <pthread.h>
 #if !defined(Q_OS_INTEGRITY)
@@ -165,6 +168,8 @@ ExecutionEngine::ExecutionEngine(EvalISelFactory *factory)
         } else {
             factory = new JIT::ISelFactory<>;
             jitDisabled = false;
+            if (Tiering::isEnabled())
+                tiering = new Tiering(new Moth::ISelFactory);
         }
 #else // !V4_ENABLE_JIT
         factory = new Moth::ISelFactory;
@@ -485,6 +490,11 @@ ExecutionEngine::~ExecutionEngine()
     delete classPool;
     delete bumperPointerAllocator;
     delete regExpCache;
+    if (Lookup::showStatistics())
+        Lookup::dumpStatistics(lookupStubCache);
+    delete lookupStubCache;
+    delete daylightSavingCache;
+    delete tiering;
     delete regExpAllocator;
     delete executableAllocator;
     jsStack->deallocate();
@@ -604,6 +614,9 @@ Heap::ArrayObject *ExecutionEngine::newArrayObject(const Value *values, int leng
         d->type = Heap::ArrayData::Simple;
         d->offset = 0;
         d->len = length;
+        d->elementKind = Heap::ArrayData::PackedInt32;
+        for (int i = 0; i < length; ++i)
+            d->updateElementKind(values[i]);
         memcpy(&d->arrayData, values, length*sizeof(Value));
         a->d()->arrayData = d;
         a->setArrayLengthUnchecked(length);
@@ -925,15 +938,6 @@ void ExecutionEngine::requireArgumentsAccessors(int n)
     }
 }
 
-static void drainMarkStack(ExecutionEngine *engine, QV4::Value *markBase)
-{
-    while (engine->jsStackTop > markBase) {
-        Heap::Base *h = engine->popForGC();
-        Q_ASSERT (h->vtable()->markObjects);
-        h->vtable()->markObjects(h, engine);
-    }
-}
-
 void ExecutionEngine::markObjects()
 {
     Value *markBase = jsStackTop;
@@ -949,11 +953,11 @@ void ExecutionEngine::markObjects()
 
     classPool->markObjects(this);
 
-    drainMarkStack(this, markBase);
+    memoryManager->drainMarkStack(markBase);
 
     for (auto compilationUnit: compilationUnits) {
         compilationUnit->markObjects(this);
-        drainMarkStack(this, markBase);
+        memoryManager->drainMarkStack(markBase);
     }
 }
 
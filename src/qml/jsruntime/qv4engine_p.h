@@ -115,6 +115,11 @@ public:
         --jsStackTop;
         return jsStackTop->heapObject();
     }
+    // Set while the heap is marked by several threads. Objects to scan are then pushed onto
+    // the mark stack of the current thread instead of the JS stack.
+    bool isMarkingInParallel = false;
+    // Set while a heap snapshot is taken. References are then recorded instead of marked.
+    HeapSnapshot *heapSnapshot = nullptr;
 
     QML_NEARLY_ALWAYS_INLINE Value *jsAlloca(int nValues) {
         Value *ptr = jsStackTop;
@@ -326,6 +331,12 @@ public:
     quint32 m_engineId;
 
     RegExpCache *regExpCache;
+    // shared by lookups that saw too many different internal classes, created on demand
+    LookupStubCache *lookupStubCache = nullptr;
+    // used by Date for conversions to and from local time, created on demand
+    DaylightSavingCache *daylightSavingCache = nullptr;
+    // set when code compiled at run-time starts out in the interpreter, see qv4tiering_p.h
+    Tiering *tiering = nullptr;
 
     // Scarce resources are "exceptionally high cost" QVariant types where allowing the
     // normal JavaScript GC to clean them up is likely to lead to out-of-memory or other
@@ -518,15 +529,32 @@ inline ExecutionContext *ExecutionEngine::parentContext(ExecutionContext *contex
     return o ? context - o : 0;
 }
 
+namespace ParallelMarking {
+Q_QML_PRIVATE_EXPORT void push(Heap::Base *m);
+}
+
+namespace HeapSnapshotting {
+Q_QML_PRIVATE_EXPORT void addEdge(HeapSnapshot *snapshot, Heap::Base *to);
+}
+
 inline
 void Heap::Base::mark(QV4::ExecutionEngine *engine)
 {
     Q_ASSERT(inUse());
+    if (Q_UNLIKELY(engine->heapSnapshot)) {
+        HeapSnapshotting::addEdge(engine->heapSnapshot, this);
+        return;
+    }
     if (isMarked())
         return;
 #ifndef QT_NO_DEBUG
     engine->assertObjectBelongsToEngine(*this);
 #endif
+    if (Q_UNLIKELY(engine->isMarkingInParallel)) {
+        if (testAndSetMarkBit())
+            ParallelMarking::push(this);
+        return;
+    }
     setMarkBit();
     engine->pushForGC(this);
 }
@@ -39,11 +39,32 @@
 
 #include "qv4executableallocator_p.h"
 
+#include <QtCore/QDebug>
+
 #include <wtf/StdLibExtras.h>
 #include <wtf/PageAllocation.h>
 
+#if defined(Q_OS_LINUX)
+#include <wtf/PageAllocationAligned.h>
+#include <sys/mman.h>
+#endif
+
 using namespace QV4;
 
+Q_STATIC_ASSERT(ExecutableAllocator::SizeClassCount <= 64); // one bit per class in nonEmptyFreeLists
+
+// Huge pages need chunks aligned to the huge page size. WTF's aligned allocator maps memory that
+// can't be made executable on Darwin, and it drops MAP_JIT elsewhere, so it's only used on Linux.
+static bool useHugePages()
+{
+#if defined(Q_OS_LINUX) && defined(MADV_HUGEPAGE)
+    static const bool hugePages = !qEnvironmentVariableIsEmpty("QV4_EXECUTABLE_HUGE_PAGES");
+    return hugePages;
+#else
+    return false;
+#endif
+}
+
 void *ExecutableAllocator::Allocation::start() const
 {
     return reinterpret_cast<void*>(addr);
@@ -71,19 +92,20 @@ ExecutableAllocator::Allocation *ExecutableAllocator::Allocation::split(size_t d
     remainder->size = size - dividingSize;
     remainder->free = free;
     remainder->addr = addr + dividingSize;
+    remainder->chunk = chunk;
     size = dividingSize;
 
     return remainder;
 }
 
-bool ExecutableAllocator::Allocation::mergeNext(ExecutableAllocator *allocator)
+// Both merge functions expect this allocation to be free, but not in any of the free lists.
+void ExecutableAllocator::Allocation::mergeNext(ExecutableAllocator *allocator)
 {
     Q_ASSERT(free);
     if (!next || !next->free)
-        return false;
+        return;
 
-    allocator->freeAllocations.remove(size, this);
-    allocator->freeAllocations.remove(next->size, next);
+    allocator->removeFree(next);
 
     size += next->size;
     Allocation *newNext = next->next;
@@ -91,29 +113,24 @@ bool ExecutableAllocator::Allocation::mergeNext(ExecutableAllocator *allocator)
     next = newNext;
     if (next)
         next->prev = this;
-
-    allocator->freeAllocations.insert(size, this);
-    return true;
 }
 
-bool ExecutableAllocator::Allocation::mergePrevious(ExecutableAllocator *allocator)
+ExecutableAllocator::Allocation *ExecutableAllocator::Allocation::mergePrevious(ExecutableAllocator *allocator)
 {
     Q_ASSERT(free);
     if (!prev || !prev->free)
-        return false;
+        return this;
 
-    allocator->freeAllocations.remove(size, this);
-    allocator->freeAllocations.remove(prev->size, prev);
+    allocator->removeFree(prev);
 
-    prev->size += size;
+    Allocation *merged = prev;
+    merged->size += size;
     if (next)
-        next->prev = prev;
-    prev->next = next;
-
-    allocator->freeAllocations.insert(prev->size, prev);
+        next->prev = merged;
+    merged->next = next;
 
     delete this;
-    return true;
+    return merged;
 }
 
 ExecutableAllocator::ChunkOfPages::~ChunkOfPages()
@@ -125,8 +142,25 @@ ExecutableAllocator::ChunkOfPages::~ChunkOfPages()
             delete alloc;
         alloc = next;
     }
-    pages->deallocate();
-    delete pages;
+    if (pages) {
+        pages->deallocate();
+        delete pages;
+    }
+#if defined(Q_OS_LINUX)
+    if (alignedPages) {
+        alignedPages->deallocate();
+        delete alignedPages;
+    }
+#endif
+}
+
+void *ExecutableAllocator::ChunkOfPages::base() const
+{
+#if defined(Q_OS_LINUX)
+    if (alignedPages)
+        return alignedPages->base();
+#endif
+    return pages->base();
 }
 
 bool ExecutableAllocator::ChunkOfPages::contains(Allocation *alloc) const
@@ -141,12 +175,28 @@ bool ExecutableAllocator::ChunkOfPages::contains(Allocation *alloc) const
 }
 
 ExecutableAllocator::ExecutableAllocator()
-    : mutex(QMutex::NonRecursive)
+    : nonEmptyFreeLists(0)
+    , freeBlockCount(0)
+    , committedBytes(0)
+    , usedBytes(0)
+    , peakCommittedBytes(0)
+    , peakUsedBytes(0)
+    , mutex(QMutex::NonRecursive)
 {
+    memset(freeLists, 0, sizeof(freeLists));
 }
 
 ExecutableAllocator::~ExecutableAllocator()
 {
+    static const bool showStatistics = !qEnvironmentVariableIsEmpty("QV4_EXECUTABLE_ALLOCATOR_STATS");
+    if (showStatistics) {
+        const Statistics stats = statistics();
+        qDebug() << "ExecutableAllocator: peak committed" << stats.peakCommitted
+                 << "bytes, peak used" << stats.peakUsed << "bytes; at exit" << stats.committed
+                 << "committed," << stats.used << "used in" << stats.chunks << "chunk(s),"
+                 << stats.freeBlocks << "free block(s), fragmentation" << stats.fragmentation();
+    }
+
     for (ChunkOfPages *chunk : qAsConst(chunks)) {
         for (Allocation *allocation = chunk->firstAllocation; allocation; allocation = allocation->next)
             if (!allocation->free)
@@ -156,31 +206,104 @@ ExecutableAllocator::~ExecutableAllocator()
     qDeleteAll(chunks);
 }
 
-ExecutableAllocator::Allocation *ExecutableAllocator::allocate(size_t size)
+void ExecutableAllocator::insertFree(Allocation *allocation)
 {
-    QMutexLocker locker(&mutex);
-    Allocation *allocation = 0;
+    Q_ASSERT(allocation->free);
+    ++freeBlockCount;
+    if (allocation->size > MaxSmallSize) {
+        freeAllocations.insert(allocation->size, allocation);
+        return;
+    }
 
-    // Code is best aligned to 16-byte boundaries.
-    size = WTF::roundUpToMultipleOf(16, size);
+    const int sizeClass = ExecutableAllocator::sizeClass(allocation->size);
+    allocation->prevFree = nullptr;
+    allocation->nextFree = freeLists[sizeClass];
+    if (allocation->nextFree)
+        allocation->nextFree->prevFree = allocation;
+    freeLists[sizeClass] = allocation;
+    nonEmptyFreeLists |= quint64(1) << sizeClass;
+}
 
-    QMultiMap<size_t, Allocation*>::Iterator it = freeAllocations.lowerBound(size);
-    if (it != freeAllocations.end()) {
-        allocation = *it;
-        freeAllocations.erase(it);
+void ExecutableAllocator::removeFree(Allocation *allocation)
+{
+    --freeBlockCount;
+    if (allocation->size > MaxSmallSize) {
+        freeAllocations.remove(allocation->size, allocation);
+        return;
     }
 
-    if (!allocation) {
-        ChunkOfPages *chunk = new ChunkOfPages;
-        size_t allocSize = WTF::roundUpToMultipleOf(WTF::pageSize(), size);
+    const int sizeClass = ExecutableAllocator::sizeClass(allocation->size);
+    if (allocation->prevFree)
+        allocation->prevFree->nextFree = allocation->nextFree;
+    else
+        freeLists[sizeClass] = allocation->nextFree;
+    if (allocation->nextFree)
+        allocation->nextFree->prevFree = allocation->prevFree;
+    allocation->nextFree = allocation->prevFree = nullptr;
+    if (!freeLists[sizeClass])
+        nonEmptyFreeLists &= ~(quint64(1) << sizeClass);
+}
+
+// Returns the smallest free block that can hold size bytes, if any.
+ExecutableAllocator::Allocation *ExecutableAllocator::takeFree(size_t size)
+{
+    if (size <= MaxSmallSize) {
+        const quint64 candidates = nonEmptyFreeLists & (~quint64(0) << sizeClass(size));
+        if (candidates) {
+            Allocation *allocation = freeLists[qCountTrailingZeroBits(candidates)];
+            removeFree(allocation);
+            return allocation;
+        }
+    }
+
+    QMultiMap<size_t, Allocation*>::Iterator it = freeAllocations.lowerBound(size);
+    if (it == freeAllocations.end())
+        return nullptr;
+    Allocation *allocation = *it;
+    freeAllocations.erase(it);
+    --freeBlockCount;
+    return allocation;
+}
+
+ExecutableAllocator::Allocation *ExecutableAllocator::allocateChunk(size_t size)
+{
+    const size_t granularity = useHugePages() ? size_t(HugePageSize) : size_t(ChunkSize);
+    const size_t allocSize = WTF::roundUpToMultipleOf(granularity, size);
+
+    ChunkOfPages *chunk = new ChunkOfPages;
+#if defined(Q_OS_LINUX) && defined(MADV_HUGEPAGE)
+    if (useHugePages()) {
+        chunk->alignedPages = new WTF::PageAllocationAligned(
+                    WTF::PageAllocationAligned::allocate(allocSize, HugePageSize, OSAllocator::JSJITCodePages));
+        madvise(chunk->alignedPages->base(), allocSize, MADV_HUGEPAGE);
+    } else
+#endif
+    {
         chunk->pages = new WTF::PageAllocation(WTF::PageAllocation::allocate(allocSize, OSAllocator::JSJITCodePages));
-        chunks.insert(reinterpret_cast<quintptr>(chunk->pages->base()) - 1, chunk);
-        allocation = new Allocation;
-        allocation->addr = reinterpret_cast<quintptr>(chunk->pages->base());
-        allocation->size = allocSize;
-        allocation->free = true;
-        chunk->firstAllocation = allocation;
     }
+    chunks.insert(reinterpret_cast<quintptr>(chunk->base()) - 1, chunk);
+
+    committedBytes += allocSize;
+    peakCommittedBytes = qMax(peakCommittedBytes, committedBytes);
+
+    Allocation *allocation = new Allocation;
+    allocation->addr = reinterpret_cast<quintptr>(chunk->base());
+    allocation->size = allocSize;
+    allocation->free = true;
+    allocation->chunk = chunk;
+    chunk->firstAllocation = allocation;
+    return allocation;
+}
+
+ExecutableAllocator::Allocation *ExecutableAllocator::allocate(size_t size)
+{
+    QMutexLocker locker(&mutex);
+
+    size = WTF::roundUpToMultipleOf(Granularity, qMax(size, size_t(1)));
+
+    Allocation *allocation = takeFree(size);
+    if (!allocation)
+        allocation = allocateChunk(size);
 
     Q_ASSERT(allocation);
     Q_ASSERT(allocation->free);
@@ -190,10 +313,12 @@ ExecutableAllocator::Allocation *ExecutableAllocator::allocate(size_t size)
     if (allocation->size > size) {
         Allocation *remainder = allocation->split(size);
         remainder->free = true;
-        if (!remainder->mergeNext(this))
-            freeAllocations.insert(remainder->size, remainder);
+        remainder->mergeNext(this);
+        insertFree(remainder);
     }
 
+    usedBytes += allocation->size;
+    peakUsedBytes = qMax(peakUsedBytes, usedBytes);
     return allocation;
 }
 
@@ -202,40 +327,46 @@ void ExecutableAllocator::free(Allocation *allocation)
     QMutexLocker locker(&mutex);
 
     Q_ASSERT(allocation);
+    Q_ASSERT(!allocation->free);
 
-    allocation->free = true;
-
-    QMap<quintptr, ChunkOfPages*>::Iterator it = chunks.lowerBound(allocation->addr);
-    if (it != chunks.begin())
-        --it;
-    Q_ASSERT(it != chunks.end());
-    ChunkOfPages *chunk = *it;
+    ChunkOfPages *chunk = allocation->chunk;
     Q_ASSERT(chunk->contains(allocation));
 
-    bool merged = allocation->mergeNext(this);
-    merged |= allocation->mergePrevious(this);
-    if (!merged)
-        freeAllocations.insert(allocation->size, allocation);
-
-    allocation = 0;
+    usedBytes -= allocation->size;
+    allocation->free = true;
+    allocation->mergeNext(this);
+    allocation = allocation->mergePrevious(this);
 
     if (!chunk->firstAllocation->next) {
-        freeAllocations.remove(chunk->firstAllocation->size, chunk->firstAllocation);
-        chunks.erase(it);
+        Q_ASSERT(allocation == chunk->firstAllocation);
+        committedBytes -= allocation->size;
+        chunks.remove(reinterpret_cast<quintptr>(chunk->base()) - 1);
         delete chunk;
         return;
     }
+
+    insertFree(allocation);
 }
 
 ExecutableAllocator::ChunkOfPages *ExecutableAllocator::chunkForAllocation(Allocation *allocation) const
+{
+    return allocation->chunk;
+}
+
+ExecutableAllocator::Statistics ExecutableAllocator::statistics() const
 {
     QMutexLocker locker(&mutex);
 
-    QMap<quintptr, ChunkOfPages*>::ConstIterator it = chunks.lowerBound(allocation->addr);
-    if (it != chunks.begin())
-        --it;
-    if (it == chunks.end())
-        return 0;
-    return *it;
+    Statistics stats;
+    stats.committed = committedBytes;
+    stats.used = usedBytes;
+    stats.peakCommitted = peakCommittedBytes;
+    stats.peakUsed = peakUsedBytes;
+    stats.chunks = chunks.count();
+    stats.freeBlocks = freeBlockCount;
+    if (!freeAllocations.isEmpty())
+        stats.largestFreeBlock = (freeAllocations.end() - 1).key();
+    else if (nonEmptyFreeLists)
+        stats.largestFreeBlock = size_t(63 - qCountLeadingZeroBits(nonEmptyFreeLists) + 1) * Granularity;
+    return stats;
 }
-
@@ -61,18 +61,39 @@
 
 namespace WTF {
 class PageAllocation;
+class PageAllocationAligned;
 }
 
 QT_BEGIN_NAMESPACE
 
 namespace QV4 {
 
+// Hands out memory for generated code. Memory is mapped in chunks of ChunkSize bytes (or
+// larger, for big requests), so that the code of functions compiled close together in time ends
+// up on the same pages. Inside a chunk, allocations are carved out of and coalesced back into
+// free blocks. Free blocks of up to MaxSmallSize bytes are kept in one free list per size class
+// and found in constant time, larger ones in a map sorted by size.
+//
+// On Linux, with QV4_EXECUTABLE_HUGE_PAGES set, chunks are HugePageSize bytes, aligned
+// accordingly, and the kernel is asked to back them with transparent huge pages. That trades
+// memory for fewer instruction TLB misses in applications with a lot of generated code.
+//
+// QV4_EXECUTABLE_ALLOCATOR_STATS prints the statistics() when the allocator is destroyed.
 class Q_QML_AUTOTEST_EXPORT ExecutableAllocator
 {
 public:
     struct ChunkOfPages;
     struct Allocation;
 
+    enum {
+        // Code is best aligned to 16-byte boundaries.
+        Granularity = 16,
+        SizeClassCount = 64,
+        MaxSmallSize = Granularity * SizeClassCount,
+        ChunkSize = 64 * 1024,
+        HugePageSize = 2 * 1024 * 1024
+    };
+
     ExecutableAllocator();
     ~ExecutableAllocator();
 
@@ -87,6 +108,9 @@ public:
             , free(true)
             , next(0)
             , prev(0)
+            , chunk(0)
+            , nextFree(0)
+            , prevFree(0)
         {}
 
         void *start() const;
@@ -100,29 +124,56 @@ public:
         friend class ExecutableAllocator;
 
         Allocation *split(size_t dividingSize);
-        bool mergeNext(ExecutableAllocator *allocator);
-        bool mergePrevious(ExecutableAllocator *allocator);
+        void mergeNext(ExecutableAllocator *allocator);
+        Allocation *mergePrevious(ExecutableAllocator *allocator);
 
         quintptr addr;
         uint size : 31; // More than 2GB of function code? nah :)
         uint free : 1;
         Allocation *next;
         Allocation *prev;
+        ChunkOfPages *chunk;
+        // Links in the free list of the size class, for small free blocks.
+        Allocation *nextFree;
+        Allocation *prevFree;
+    };
+
+    struct Statistics
+    {
+        size_t committed = 0; // bytes mapped for code
+        size_t used = 0; // bytes handed out
+        size_t peakCommitted = 0;
+        size_t peakUsed = 0;
+        size_t largestFreeBlock = 0;
+        int chunks = 0;
+        int freeBlocks = 0;
+
+        // The share of the free memory that is not in the largest free block.
+        qreal fragmentation() const
+        {
+            const size_t freeBytes = committed - used;
+            return freeBytes ? 1 - qreal(largestFreeBlock) / freeBytes : 0;
+        }
     };
+    Statistics statistics() const;
 
     // for debugging / unit-testing
-    int freeAllocationCount() const { return freeAllocations.count(); }
+    int freeAllocationCount() const { return freeBlockCount; }
     int chunkCount() const { return chunks.count(); }
 
     struct ChunkOfPages
     {
         ChunkOfPages()
             : pages(0)
+            , alignedPages(0)
             , firstAllocation(0)
         {}
         ~ChunkOfPages();
 
+        void *base() const;
+
         WTF::PageAllocation *pages;
+        WTF::PageAllocationAligned *alignedPages; // only for huge pages
         Allocation *firstAllocation;
 
         bool contains(Allocation *alloc) const;
@@ -131,8 +182,22 @@ public:
     ChunkOfPages *chunkForAllocation(Allocation *allocation) const;
 
 private:
+    static int sizeClass(size_t size) { return int(size / Granularity) - 1; }
+
+    void insertFree(Allocation *allocation);
+    void removeFree(Allocation *allocation);
+    Allocation *takeFree(size_t size);
+    Allocation *allocateChunk(size_t size);
+
+    Allocation *freeLists[SizeClassCount];
+    quint64 nonEmptyFreeLists;
     QMultiMap<size_t, Allocation*> freeAllocations;
+    int freeBlockCount;
     QMap<quintptr, ChunkOfPages*> chunks;
+    size_t committedBytes;
+    size_t usedBytes;
+    size_t peakCommittedBytes;
+    size_t peakUsedBytes;
     mutable QMutex mutex;
 };
 
@@ -57,6 +57,9 @@ Function::Function(ExecutionEngine *engine, CompiledData::CompilationUnit *unit,
         , code(codePtr)
         , codeData(0)
         , hasQmlDependencies(function->hasQmlDependencies())
+        , tier(NotTiered)
+        , invocationCount(0)
+        , backEdgeCount(0)
 {
     internalClass = engine->internalClasses[EngineBase::Class_Empty];
     const CompiledData::LEUInt32 *formalsIndices = compiledFunction->formalsTable();
@@ -73,6 +73,19 @@ struct Q_QML_EXPORT Function {
     bool hasQmlDependencies;
     bool canUseSimpleCall;
 
+    // Functions of units that start out in the interpreter are counted, and move to the JIT
+    // once they get hot. See qv4tiering_p.h.
+    enum Tier {
+        NotTiered,
+        InterpreterTier,
+        JitTier
+    };
+    Tier tier;
+    uint invocationCount;
+    uint backEdgeCount;
+    // Operand types seen by the interpreter, indexed by IR statement id.
+    QVector<quint8> typeFeedback;
+
     Function(ExecutionEngine *engine, CompiledData::CompilationUnit *unit, const CompiledData::Function *function,
              ReturnedValue (*codePtr)(ExecutionEngine *, const uchar *));
     ~Function();
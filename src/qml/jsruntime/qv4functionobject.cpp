@@ -48,6 +48,7 @@
 #include "qv4arrayobject_p.h"
 #include "qv4scopedvalue_p.h"
 #include "qv4argumentsobject_p.h"
+#include "qv4tiering_p.h"
 
 #include <private/qqmljsengine_p.h>
 #include <private/qqmljslexer_p.h>
@@ -232,10 +233,21 @@ void FunctionCtor::construct(const Managed *that, Scope &scope, CallData *callDa
     cg.generateFromFunctionExpression(QString(), function, fe, &module);
 
     Compiler::JSUnitGenerator jsGenerator(&module);
-    QScopedPointer<EvalInstructionSelection> isel(scope.engine->iselFactory->create(QQmlEnginePrivate::get(scope.engine), scope.engine->executableAllocator, &module, &jsGenerator));
+    Tiering *tiering = scope.engine->tiering;
+    EvalISelFactory *iselFactory = tiering ? tiering->interpreterFactory() : scope.engine->iselFactory.data();
+    QScopedPointer<EvalInstructionSelection> isel(iselFactory->create(QQmlEnginePrivate::get(scope.engine), scope.engine->executableAllocator, &module, &jsGenerator));
+    isel->setCollectTypeFeedback(tiering != nullptr);
     QQmlRefPointer<CompiledData::CompilationUnit> compilationUnit = isel->compile();
     Function *vmf = compilationUnit->linkToEngine(scope.engine);
 
+    if (tiering) {
+        TieringSource *source = new TieringSource;
+        source->kind = TieringSource::FunctionExpression;
+        source->sourceCode = function;
+        source->strictMode = f->strictMode();
+        tiering->registerUnit(compilationUnit.data(), source);
+    }
+
     ExecutionContext *global = scope.engine->rootContext();
     scope.result = FunctionObject::createScriptFunction(global, vmf);
 }
@@ -181,6 +181,7 @@ namespace Heap {
 }
 
 class MemoryManager;
+class HeapSnapshot;
 struct String;
 struct Object;
 struct ObjectPrototype;
@@ -193,6 +194,9 @@ struct InternalClass;
 struct Property;
 struct Value;
 struct Lookup;
+struct LookupStubCache;
+struct DaylightSavingCache;
+struct TieringSource;
 struct ArrayData;
 struct VTable;
 
@@ -237,6 +241,7 @@ class WeakValue;
 
 struct IdentifierTable;
 class RegExpCache;
+class Tiering;
 class MultiplyWrappedQObjectMap;
 
 namespace Global {
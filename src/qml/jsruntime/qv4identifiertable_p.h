@@ -96,7 +96,13 @@ public:
     void mark(ExecutionEngine *e) {
         for (int i = 0; i < alloc; ++i) {
             Heap::String *entry = entries[i];
-            if (!entry || entry->isMarked())
+            if (!entry)
+                continue;
+            if (Q_UNLIKELY(e->heapSnapshot)) {
+                entry->mark(e);
+                continue;
+            }
+            if (entry->isMarked())
                 continue;
             entry->setMarkBit();
             Q_ASSERT(entry->vtable()->markObjects);
@@ -47,9 +47,12 @@
 #include <qv4variantobject_p.h>
 #include "qv4string_p.h"
 
+#include <qiodevice.h>
 #include <qstack.h>
 #include <qstringlist.h>
 
+#include <private/qsimd_p.h>
+
 #include <wtf/MathExtras.h>
 
 using namespace QV4;
@@ -120,15 +123,35 @@ enum {
     Quote = 0x22
 };
 
+static inline bool isSpace(ushort c)
+{
+    return c == Space || c == Tab || c == LineFeed || c == Return;
+}
+
 bool JsonParser::eatSpace()
 {
+    if (json < end && json->unicode() > Space)
+        return true;
+#ifdef __SSE2__
+    // indentation of pretty printed documents comes in long runs
+    const __m128i space = _mm_set1_epi16(Space);
+    const __m128i tab = _mm_set1_epi16(Tab);
+    const __m128i lineFeed = _mm_set1_epi16(LineFeed);
+    const __m128i ret = _mm_set1_epi16(Return);
+    while (end - json >= 8) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(json));
+        const __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(chars, space), _mm_cmpeq_epi16(chars, tab)),
+                                        _mm_or_si128(_mm_cmpeq_epi16(chars, lineFeed), _mm_cmpeq_epi16(chars, ret)));
+        const uint mask = ~uint(_mm_movemask_epi8(ws)) & 0xffff;
+        if (mask) {
+            json += qCountTrailingZeroBits(mask) / 2;
+            return true;
+        }
+        json += 8;
+    }
+#endif
     while (json < end) {
-        if (*json > Space)
-            break;
-        if (*json != Space &&
-            *json != Tab &&
-            *json != LineFeed &&
-            *json != Return)
+        if (!isSpace(json->unicode()))
             break;
         ++json;
     }
@@ -213,9 +236,15 @@ ReturnedValue JsonParser::parseObject()
 
     ScopedObject o(scope, engine->newObject());
 
+    if (shapes.size() <= nestingLevel)
+        shapes.resize(nestingLevel + 1);
+    ObjectShape shape = { o->internalClass(), shapes.at(nestingLevel), 0 };
+    if (shape.predicted)
+        o->setInternalClass(shape.predicted);
+
     QChar token = nextToken();
     while (token == Quote) {
-        if (!parseMember(o))
+        if (!parseMember(o, &shape))
             return Encode::undefined();
         token = nextToken();
         if (token != ValueSeparator)
@@ -233,19 +262,51 @@ ReturnedValue JsonParser::parseObject()
         return Encode::undefined();
     }
 
+    if (shape.predicted && shape.matched < shape.predicted->size)
+        dropPrediction(o, &shape); // fewer members than predicted
+    shapes[nestingLevel] = o->internalClass();
+
     END;
 
     --nestingLevel;
     return o.asReturnedValue();
 }
 
+// Continues with the class of the members that matched the prediction.
+void JsonParser::dropPrediction(Object *o, ObjectShape *shape)
+{
+    InternalClass *ic = shape->initialClass;
+    for (uint i = 0; i < shape->matched; ++i)
+        ic = ic->addMember(shape->predicted->nameMap.at(i), Attr_Data);
+    o->setInternalClass(ic);
+    shape->predicted = 0;
+}
+
 /*
     member = string name-separator value
 */
-bool JsonParser::parseMember(Object *o)
+bool JsonParser::parseMember(Object *o, ObjectShape *shape)
 {
     BEGIN << "parseMember";
     Scope scope(engine);
+    ScopedValue val(scope);
+
+    if (shape->predicted) {
+        if (shape->matched < shape->predicted->size
+                && matchKey(shape->predicted->nameMap.at(shape->matched)->string)) {
+            if (nextToken() != NameSeparator) {
+                lastError = QJsonParseError::MissingNameSeparator;
+                return false;
+            }
+            if (!parseValue(val))
+                return false;
+            *o->propertyData(shape->matched++) = val;
+            END;
+            return true;
+        }
+
+        dropPrediction(o, shape);
+    }
 
     QString key;
     if (!parseString(&key))
@@ -255,7 +316,6 @@ bool JsonParser::parseMember(Object *o)
         lastError = QJsonParseError::MissingNameSeparator;
         return false;
     }
-    ScopedValue val(scope);
     if (!parseValue(val))
         return false;
 
@@ -271,6 +331,25 @@ bool JsonParser::parseMember(Object *o)
     return true;
 }
 
+/*
+    Compares the string at the current position with key and skips it if it is equal. This only
+    matches strings without escape sequences, which can't be confused with the closing quote.
+*/
+bool JsonParser::matchKey(const QString &key)
+{
+    const int length = key.length();
+    if (end - json <= length || json[length] != Quote)
+        return false;
+    const QChar *k = key.constData();
+    for (int i = 0; i < length; ++i) {
+        const ushort c = k[i].unicode();
+        if (json[i].unicode() != c || c == Quote || c == '\\' || c <= 0x1f)
+            return false;
+    }
+    json += length + 1;
+    return true;
+}
+
 /*
     array = begin-array [ value *( value-separator value ) ] end-array
 */
@@ -444,11 +523,17 @@ bool JsonParser::parseNumber(Value *val)
         ++json;
 
     // int = zero / ( digit1-9 *DIGIT )
+    const QChar *digits = json;
+    int n = 0;
     if (json < end && *json == '0') {
         ++json;
     } else {
-        while (json < end && *json >= '0' && *json <= '9')
+        while (json < end && *json >= '0' && *json <= '9') {
+            n = n * 10 + (json->unicode() - '0');
             ++json;
+            if (json - digits > 8)
+                isInt = false; // might overflow, leave it to QString
+        }
     }
 
     // frac = decimal-point 1*DIGIT
@@ -469,19 +554,15 @@ bool JsonParser::parseNumber(Value *val)
             ++json;
     }
 
+    if (isInt && json > digits && n < (1<<25)) {
+        *val = Primitive::fromInt32(*start == '-' ? -n : n);
+        END;
+        return true;
+    }
+
     QString number(start, json - start);
     DEBUG << "numberstring" << number;
 
-    if (isInt) {
-        bool ok;
-        int n = number.toInt(&ok);
-        if (ok && n < (1<<25) && n > -(1<<25)) {
-            *val = Primitive::fromInt32(n);
-            END;
-            return true;
-        }
-    }
-
     bool ok;
     double d;
     d = number.toDouble(&ok);
@@ -577,11 +658,49 @@ static inline bool scanEscapeSequence(const QChar *&json, const QChar *end, uint
 }
 
 
+// Returns the first quote, backslash or control character from json on, or end.
+static inline const QChar *scanUnescaped(const QChar *json, const QChar *end)
+{
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi16(Quote);
+    const __m128i backslash = _mm_set1_epi16('\\');
+    const __m128i lastControl = _mm_set1_epi16(0x1f);
+    const __m128i zero = _mm_setzero_si128();
+    while (end - json >= 8) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(json));
+        const __m128i special = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi16(chars, quote), _mm_cmpeq_epi16(chars, backslash)),
+                    _mm_cmpeq_epi16(_mm_subs_epu16(chars, lastControl), zero));
+        const uint mask = _mm_movemask_epi8(special);
+        if (mask)
+            return json + qCountTrailingZeroBits(mask) / 2;
+        json += 8;
+    }
+#endif
+    while (json < end) {
+        const ushort c = json->unicode();
+        if (c == Quote || c == '\\' || c <= 0x1f)
+            break;
+        ++json;
+    }
+    return json;
+}
+
 bool JsonParser::parseString(QString *string)
 {
     BEGIN << "parse string stringPos=" << json;
 
     while (json < end) {
+        const QChar *run = json;
+        json = scanUnescaped(json, end);
+        if (json != run) {
+            if (string->isEmpty() && json < end && *json == '"')
+                *string = QString(run, json - run);
+            else
+                string->append(run, json - run);
+            continue;
+        }
+
         if (*json == '"')
             break;
         else if (*json == '\\') {
@@ -596,12 +715,9 @@ bool JsonParser::parseString(QString *string)
                 *string += QChar(ch);
             }
         } else {
-            if (json->unicode() <= 0x1f) {
-                lastError = QJsonParseError::IllegalEscapeSequence;
-                return false;
-            }
-            *string += *json;
-            ++json;
+            // control characters need to be escaped
+            lastError = QJsonParseError::IllegalEscapeSequence;
+            return false;
         }
     }
     ++json;
@@ -616,77 +732,199 @@ bool JsonParser::parseString(QString *string)
 }
 
 
-struct Stringify
+namespace {
+
+static char *writeUnicodeEscape(char *d, ushort c)
 {
-    ExecutionEngine *v4;
-    FunctionObject *replacerFunction;
-    QV4::String *propertyList;
-    int propertyListSize;
-    QString gap;
-    QString indent;
-    QStack<Object *> stack;
+    static const char hexDigits[] = "0123456789abcdef";
+    *d++ = '\\';
+    *d++ = 'u';
+    *d++ = hexDigits[c >> 12];
+    *d++ = hexDigits[(c >> 8) & 0xf];
+    *d++ = hexDigits[(c >> 4) & 0xf];
+    *d++ = hexDigits[c & 0xf];
+    return d;
+}
 
-    bool stackContains(Object *o) {
-        for (int i = 0; i < stack.size(); ++i)
-            if (stack.at(i)->d() == o->d())
-                return true;
-        return false;
+// The stringifier writes its output piece by piece, so that no intermediate strings for the
+// nested objects and arrays are needed.
+struct Utf16Output
+{
+    QString buffer;
+
+    void append(char c) { buffer += QLatin1Char(c); }
+    void append(QLatin1String s) { buffer += s; }
+    void append(const QChar *s, int length) { buffer.append(s, length); }
+    void escape(ushort c)
+    {
+        char escaped[6];
+        writeUnicodeEscape(escaped, c);
+        buffer += QLatin1String(escaped, 6);
+    }
+};
+
+struct Utf8Output
+{
+    enum { FlushSize = 64 * 1024, ChunkSize = 4096 };
+
+    QByteArray *buffer;
+    QIODevice *device;
+    bool failed;
+
+    Utf8Output(QByteArray *buffer, QIODevice *device)
+        : buffer(buffer), device(device), failed(false)
+    {
+        if (device)
+            buffer->reserve(FlushSize + 6 * ChunkSize);
     }
 
-    Stringify(ExecutionEngine *e) : v4(e), replacerFunction(0), propertyList(0), propertyListSize(0) {}
+    void flush()
+    {
+        if (!device || buffer->isEmpty())
+            return;
+        if (device->write(*buffer) != buffer->size())
+            failed = true;
+        buffer->truncate(0);
+    }
 
-    QString Str(const QString &key, const Value &v);
-    QString JA(ArrayObject *a);
-    QString JO(Object *o);
+    void flushIfFull()
+    {
+        if (device && buffer->size() >= FlushSize)
+            flush();
+    }
 
-    QString makeMember(const QString &key, const Value &v);
+    void append(char c) { buffer->append(c); }
+    void append(QLatin1String s) { buffer->append(s.data(), s.size()); flushIfFull(); }
+    void append(const QChar *s, int length);
+    void escape(ushort c)
+    {
+        char escaped[6];
+        writeUnicodeEscape(escaped, c);
+        append(QLatin1String(escaped, 6));
+    }
 };
 
-static QString quote(const QString &str)
+void Utf8Output::append(const QChar *s, int length)
 {
-    QString product;
-    const int length = str.length();
-    product.reserve(length + 2);
-    product += QLatin1Char('"');
-    for (int i = 0; i < length; ++i) {
-        QChar c = str.at(i);
-        switch (c.unicode()) {
+    const QChar *end = s + length;
+    while (s < end) {
+        // encode in chunks, so that long strings don't need a huge buffer
+        const QChar *chunkEnd = end - s > ChunkSize ? s + ChunkSize : end;
+        if (chunkEnd < end && chunkEnd[-1].isHighSurrogate())
+            ++chunkEnd;
+
+        // at most three bytes per QChar, or six for an escaped lone surrogate
+        const int oldSize = buffer->size();
+        buffer->resize(oldSize + 6 * int(chunkEnd - s));
+        char *d = buffer->data() + oldSize;
+        while (s < chunkEnd) {
+            uint u = (s++)->unicode();
+            if (u < 0x80) {
+                *d++ = char(u);
+            } else if (u < 0x800) {
+                *d++ = char(0xc0 | (u >> 6));
+                *d++ = char(0x80 | (u & 0x3f));
+            } else if (!QChar::isSurrogate(u)) {
+                *d++ = char(0xe0 | (u >> 12));
+                *d++ = char(0x80 | ((u >> 6) & 0x3f));
+                *d++ = char(0x80 | (u & 0x3f));
+            } else if (QChar::isHighSurrogate(u) && s < chunkEnd && s->isLowSurrogate()) {
+                u = QChar::surrogateToUcs4(ushort(u), (s++)->unicode());
+                *d++ = char(0xf0 | (u >> 18));
+                *d++ = char(0x80 | ((u >> 12) & 0x3f));
+                *d++ = char(0x80 | ((u >> 6) & 0x3f));
+                *d++ = char(0x80 | (u & 0x3f));
+            } else {
+                // UTF-8 can't encode lone surrogates, escape them so they don't get lost
+                d = writeUnicodeEscape(d, ushort(u));
+            }
+        }
+        buffer->resize(d - buffer->data());
+        flushIfFull();
+    }
+}
+
+template <typename Output>
+static void quote(Output *out, const QString &str)
+{
+    out->append('"');
+    const QChar *s = str.constData();
+    const QChar *end = s + str.length();
+    while (s < end) {
+        const QChar *run = s;
+        while (s < end && s->unicode() > 0x1f && *s != QLatin1Char('"') && *s != QLatin1Char('\\'))
+            ++s;
+        if (s != run)
+            out->append(run, s - run);
+        if (s == end)
+            break;
+
+        switch (s->unicode()) {
         case '"':
-            product += QLatin1String("\\\"");
+            out->append(QLatin1String("\\\""));
             break;
         case '\\':
-            product += QLatin1String("\\\\");
+            out->append(QLatin1String("\\\\"));
             break;
         case '\b':
-            product += QLatin1String("\\b");
+            out->append(QLatin1String("\\b"));
             break;
         case '\f':
-            product += QLatin1String("\\f");
+            out->append(QLatin1String("\\f"));
             break;
         case '\n':
-            product += QLatin1String("\\n");
+            out->append(QLatin1String("\\n"));
             break;
         case '\r':
-            product += QLatin1String("\\r");
+            out->append(QLatin1String("\\r"));
             break;
         case '\t':
-            product += QLatin1String("\\t");
+            out->append(QLatin1String("\\t"));
             break;
         default:
-            if (c.unicode() <= 0x1f) {
-                product += QLatin1String("\\u00");
-                product += (c.unicode() > 0xf ? QLatin1Char('1') : QLatin1Char('0')) +
-                        QLatin1Char("0123456789abcdef"[c.unicode() & 0xf]);
-            } else {
-                product += c;
-            }
+            out->escape(s->unicode());
         }
+        ++s;
     }
-    product += QLatin1Char('"');
-    return product;
+    out->append('"');
 }
 
-QString Stringify::Str(const QString &key, const Value &v)
+template <typename Output>
+struct Stringify
+{
+    ExecutionEngine *v4;
+    Output *out;
+    FunctionObject *replacerFunction;
+    QV4::String *propertyList;
+    int propertyListSize;
+    QString gap;
+    QString indent;
+    QStack<Object *> stack;
+
+    bool stackContains(Object *o) {
+        for (int i = 0; i < stack.size(); ++i)
+            if (stack.at(i)->d() == o->d())
+                return true;
+        return false;
+    }
+
+    Stringify(ExecutionEngine *e, Output *out)
+        : v4(e), out(out), replacerFunction(0), propertyList(0), propertyListSize(0) {}
+
+    ReturnedValue resolve(const QString &key, const Value &v);
+    bool Str(const QString &key, const Value &v);
+    void write(const Value &v);
+    void JA(ArrayObject *a);
+    void JO(Object *o);
+
+    void writeSeparator(bool *empty);
+    void writeMember(const QString &key, const Value &v, bool *empty);
+    void writeText(const QString &text) { out->append(text.constData(), text.length()); }
+};
+
+// Applies toJSON and the replacer, and unwraps Number, String and Boolean objects
+template <typename Output>
+ReturnedValue Stringify<Output>::resolve(const QString &key, const Value &v)
 {
     Scope scope(v4);
     scope.result = v;
@@ -723,81 +961,114 @@ QString Stringify::Str(const QString &key, const Value &v)
             scope.result = Encode(b->value());
     }
 
-    if (scope.result.isNull())
-        return QStringLiteral("null");
-    if (scope.result.isBoolean())
-        return scope.result.booleanValue() ? QStringLiteral("true") : QStringLiteral("false");
-    if (String *s = scope.result.stringValue())
-        return quote(s->toQString());
+    return scope.result.asReturnedValue();
+}
 
-    if (scope.result.isNumber()) {
-        double d = scope.result.toNumber();
-        return std::isfinite(d) ? scope.result.toQString() : QStringLiteral("null");
-    }
+// Returns whether v produces any output, undefined and functions don't
+static bool isSerializable(const Value &v)
+{
+    if (v.isNull() || v.isBoolean() || v.isString() || v.isNumber())
+        return true;
+    if (const QV4::VariantObject *variant = v.as<QV4::VariantObject>())
+        return !variant->d()->data().toString().isEmpty();
+    return v.isObject() && !v.as<FunctionObject>();
+}
 
-    if (const QV4::VariantObject *v = scope.result.as<QV4::VariantObject>()) {
-        return v->d()->data().toString();
-    }
+template <typename Output>
+bool Stringify<Output>::Str(const QString &key, const Value &v)
+{
+    Scope scope(v4);
+    ScopedValue value(scope, resolve(key, v));
+    if (!isSerializable(value))
+        return false;
+    write(value);
+    return true;
+}
 
-    o = scope.result.asReturnedValue();
-    if (o) {
-        if (!o->as<FunctionObject>()) {
-            if (o->as<ArrayObject>()) {
-                return JA(static_cast<ArrayObject *>(o.getPointer()));
-            } else {
-                return JO(o);
-            }
-        }
+template <typename Output>
+void Stringify<Output>::write(const Value &v)
+{
+    if (v.isNull()) {
+        out->append(QLatin1String("null"));
+    } else if (v.isBoolean()) {
+        out->append(v.booleanValue() ? QLatin1String("true") : QLatin1String("false"));
+    } else if (String *s = v.stringValue()) {
+        quote(out, s->toQString());
+    } else if (v.isInteger()) {
+        char number[16];
+        out->append(QLatin1String(number, qsnprintf(number, sizeof(number), "%d", v.integerValue())));
+    } else if (v.isNumber()) {
+        if (std::isfinite(v.doubleValue()))
+            writeText(v.toQString());
+        else
+            out->append(QLatin1String("null"));
+    } else if (const QV4::VariantObject *variant = v.as<QV4::VariantObject>()) {
+        writeText(variant->d()->data().toString());
+    } else if (Object *o = v.objectValue()) {
+        if (ArrayObject *a = o->as<ArrayObject>())
+            JA(a);
+        else
+            JO(o);
     }
-
-    return QString();
 }
 
-QString Stringify::makeMember(const QString &key, const Value &v)
+template <typename Output>
+void Stringify<Output>::writeSeparator(bool *empty)
 {
-    QString strP = Str(key, v);
-    if (!strP.isEmpty()) {
-        QString member = quote(key) + QLatin1Char(':');
-        if (!gap.isEmpty())
-            member += QLatin1Char(' ');
-        member += strP;
-        return member;
+    if (!*empty)
+        out->append(',');
+    if (!gap.isEmpty()) {
+        out->append('\n');
+        writeText(indent);
     }
-    return QString();
+    *empty = false;
 }
 
-QString Stringify::JO(Object *o)
+template <typename Output>
+void Stringify<Output>::writeMember(const QString &key, const Value &v, bool *empty)
+{
+    Scope scope(v4);
+    ScopedValue value(scope, resolve(key, v));
+    if (!isSerializable(value))
+        return;
+    writeSeparator(empty);
+    quote(out, key);
+    out->append(':');
+    if (!gap.isEmpty())
+        out->append(' ');
+    write(value);
+}
+
+template <typename Output>
+void Stringify<Output>::JO(Object *o)
 {
     if (stackContains(o)) {
         v4->throwTypeError();
-        return QString();
+        return;
     }
 
     Scope scope(v4);
 
-    QString result;
     stack.push(o);
     QString stepback = indent;
     indent += gap;
 
-    QStringList partial;
+    out->append('{');
+    bool empty = true;
     if (!propertyListSize) {
         ObjectIterator it(scope, o, ObjectIterator::EnumerableOnly);
         ScopedValue name(scope);
 
         ScopedValue val(scope);
-        while (1) {
+        while (!v4->hasException) {
             name = it.nextPropertyNameAsString(val);
             if (name->isNull())
                 break;
-            QString key = name->toQString();
-            QString member = makeMember(key, val);
-            if (!member.isEmpty())
-                partial += member;
+            writeMember(name->toQString(), val, &empty);
         }
     } else {
         ScopedValue v(scope);
-        for (int i = 0; i < propertyListSize; ++i) {
+        for (int i = 0; i < propertyListSize && !v4->hasException; ++i) {
             bool exists;
             String *s = propertyList + i;
             if (!s)
@@ -805,70 +1076,56 @@ QString Stringify::JO(Object *o)
             v = o->get(s, &exists);
             if (!exists)
                 continue;
-            QString member = makeMember(s->toQString(), v);
-            if (!member.isEmpty())
-                partial += member;
+            writeMember(s->toQString(), v, &empty);
         }
     }
 
-    if (partial.isEmpty()) {
-        result = QStringLiteral("{}");
-    } else if (gap.isEmpty()) {
-        result = QLatin1Char('{') + partial.join(QLatin1Char(',')) + QLatin1Char('}');
-    } else {
-        QString separator = QLatin1String(",\n") + indent;
-        result = QLatin1String("{\n") + indent + partial.join(separator) + QLatin1Char('\n')
-                 + stepback + QLatin1Char('}');
+    if (!empty && !gap.isEmpty()) {
+        out->append('\n');
+        writeText(stepback);
     }
+    out->append('}');
 
     indent = stepback;
     stack.pop();
-    return result;
 }
 
-QString Stringify::JA(ArrayObject *a)
+template <typename Output>
+void Stringify<Output>::JA(ArrayObject *a)
 {
     if (stackContains(a)) {
         v4->throwTypeError();
-        return QString();
+        return;
     }
 
     Scope scope(a->engine());
 
-    QString result;
     stack.push(a);
     QString stepback = indent;
     indent += gap;
 
-    QStringList partial;
+    out->append('[');
+    bool empty = true;
     uint len = a->getLength();
     ScopedValue v(scope);
-    for (uint i = 0; i < len; ++i) {
+    for (uint i = 0; i < len && !v4->hasException; ++i) {
+        writeSeparator(&empty);
         bool exists;
         v = a->getIndexed(i, &exists);
-        if (!exists) {
-            partial += QStringLiteral("null");
-            continue;
-        }
-        QString strP = Str(QString::number(i), v);
-        if (!strP.isEmpty())
-            partial += strP;
-        else
-            partial += QStringLiteral("null");
+        if (!exists || !Str(QString::number(i), v))
+            out->append(QLatin1String("null"));
     }
 
-    if (partial.isEmpty()) {
-        result = QStringLiteral("[]");
-    } else if (gap.isEmpty()) {
-        result = QLatin1Char('[') + partial.join(QLatin1Char(',')) + QLatin1Char(']');
-    } else {
-        QString separator = QLatin1String(",\n") + indent;
-        result = QLatin1String("[\n") + indent + partial.join(separator) + QLatin1Char('\n') + stepback + QLatin1Char(']');
+    if (!empty && !gap.isEmpty()) {
+        out->append('\n');
+        writeText(stepback);
     }
+    out->append(']');
 
     indent = stepback;
     stack.pop();
-    return result;
+}
+
 }
 
 
@@ -902,7 +1159,8 @@ void JsonObject::method_parse(const BuiltinFunction *, Scope &scope, CallData *c
 
 void JsonObject::method_stringify(const BuiltinFunction *, Scope &scope, CallData *callData)
 {
-    Stringify stringify(scope.engine);
+    Utf16Output out;
+    Stringify<Utf16Output> stringify(scope.engine, &out);
 
     ScopedObject o(scope, callData->argument(1));
     if (o) {
@@ -943,10 +1201,31 @@ void JsonObject::method_stringify(const BuiltinFunction *, Scope &scope, CallDat
 
 
     ScopedValue arg0(scope, callData->argument(0));
-    QString result = stringify.Str(QString(), arg0);
-    if (result.isEmpty() || scope.engine->hasException)
+    if (!stringify.Str(QString(), arg0) || scope.engine->hasException)
         RETURN_UNDEFINED();
-    scope.result = scope.engine->newString(result);
+    scope.result = scope.engine->newString(out.buffer);
+}
+
+/*
+    Writes value as UTF-8 encoded JSON, like JSON.stringify(value, null, gap) does. Without a
+    device, the output is appended to buffer. With one, it is written to the device in pieces
+    and buffer is used as temporary storage.
+*/
+bool JsonObject::writeJson(ExecutionEngine *engine, const Value &value, const QString &gap,
+                           QByteArray *buffer, QIODevice *device)
+{
+    Scope scope(engine);
+    Utf8Output out(buffer, device);
+    Stringify<Utf8Output> stringify(engine, &out);
+    stringify.gap = gap.left(10);
+
+    bool ok = stringify.Str(QString(), value);
+    if (engine->hasException) {
+        engine->catchException();
+        ok = false;
+    }
+    out.flush();
+    return ok && !out.failed;
 }
 
 
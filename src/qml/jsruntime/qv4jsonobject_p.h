@@ -56,9 +56,12 @@
 #include <qjsonvalue.h>
 #include <qjsondocument.h>
 #include <qhash.h>
+#include <qvector.h>
 
 QT_BEGIN_NAMESPACE
 
+class QIODevice;
+
 namespace QV4 {
 
 namespace Heap {
@@ -95,6 +98,9 @@ public:
     static ReturnedValue fromJsonObject(ExecutionEngine *engine, const QJsonObject &object);
     static ReturnedValue fromJsonArray(ExecutionEngine *engine, const QJsonArray &array);
 
+    static bool writeJson(ExecutionEngine *engine, const Value &value, const QString &gap,
+                          QByteArray *buffer, QIODevice *device = 0);
+
     static inline QJsonValue toJsonValue(const QV4::Value &value)
     { V4ObjectSet visitedObjects; return toJsonValue(value, visitedObjects); }
     static inline QJsonObject toJsonObject(const QV4::Object *o)
@@ -120,9 +126,20 @@ private:
     inline bool eatSpace();
     inline QChar nextToken();
 
+    // JSON documents are often lists of records with the same keys. Objects start out with
+    // the class of the last object parsed on the same nesting level, and keep it as long as
+    // their keys match its members.
+    struct ObjectShape {
+        InternalClass *initialClass;
+        InternalClass *predicted;
+        uint matched;
+    };
+
     ReturnedValue parseObject();
     ReturnedValue parseArray();
-    bool parseMember(Object *o);
+    bool parseMember(Object *o, ObjectShape *shape);
+    void dropPrediction(Object *o, ObjectShape *shape);
+    bool matchKey(const QString &key);
     bool parseString(QString *string);
     bool parseValue(Value *val);
     bool parseNumber(Value *val);
@@ -134,6 +151,7 @@ private:
 
     int nestingLevel;
     QJsonParseError::ParseError lastError;
+    QVector<InternalClass *> shapes;
 };
 
 }
@@ -40,7 +40,10 @@
 #include "qv4functionobject_p.h"
 #include "qv4scopedvalue_p.h"
 #include "qv4string_p.h"
+#include "qv4qobjectwrapper_p.h"
 #include <private/qv4identifiertable_p.h>
+#include <private/qqmldata_p.h>
+#include <private/qqmlpropertycache_p.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -117,6 +120,97 @@ ReturnedValue Lookup::lookup(const Object *thisObject, PropertyAttributes *attrs
     return Primitive::emptyValue().asReturnedValue();
 }
 
+static ReturnedValue becomePolymorphic(Lookup *l, ExecutionEngine *engine, const Value &object)
+{
+    PolymorphicLookupCache *cache = new PolymorphicLookupCache;
+    cache->count = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    l->polymorphicCache = cache;
+    l->getter = Lookup::getterPolymorphic;
+    return Lookup::getterPolymorphic(l, engine, object);
+}
+
+static inline const Value *findProperty(const LookupCacheEntry &e, Heap::Object *o)
+{
+    if (o->internalClass != e.classList[0])
+        return 0;
+    // the internal class determines the prototype, but not the prototype's properties
+    for (uint i = 1; i <= e.level; ++i) {
+        o = o->prototype();
+        if (o->internalClass != e.classList[i])
+            return 0;
+    }
+    return o->propertyData(e.index);
+}
+
+// Looks up the property the slow way, and remembers in entry where it was found.
+static bool probe(Lookup *l, const Object *o, LookupCacheEntry *entry, ReturnedValue *result)
+{
+    Lookup p;
+    p.nameIndex = l->nameIndex;
+    PropertyAttributes attrs;
+    ReturnedValue v = p.lookup(o, &attrs);
+    if (v == Primitive::emptyValue().asReturnedValue()) {
+        *result = Encode::undefined();
+        return false;
+    }
+    *result = v;
+    if (p.level > 2)
+        return false;
+    for (int i = 0; i <= p.level; ++i)
+        entry->classList[i] = p.classList[i];
+    entry->level = p.level;
+    entry->index = p.index;
+    entry->attrs = attrs;
+    return true;
+}
+
+static inline bool hasDefaultGet(const Object *o)
+{
+    return o->vtable()->get == Object::static_vtbl.get;
+}
+
+void Lookup::releasePropertyCache()
+{
+    if (getter != getterQObject && setter != setterQObject)
+        return;
+    qobjectLookup.propertyCache->release();
+    qobjectLookup.propertyCache = 0;
+    qobjectLookup.propertyData = 0;
+}
+
+void Lookup::releaseCaches()
+{
+    releasePropertyCache();
+    if (getter == getterPolymorphic || getter == getterMegamorphic) {
+        delete polymorphicCache;
+        polymorphicCache = 0;
+    }
+}
+
+bool Lookup::showStatistics()
+{
+    static const bool show = qEnvironmentVariableIsSet("QV4_LOOKUP_STATS");
+    return show;
+}
+
+void Lookup::dumpStatistics(const QString &fileName, const QString &name) const
+{
+    if (getter != getterPolymorphic && getter != getterMegamorphic)
+        return;
+    const PolymorphicLookupCache *cache = polymorphicCache;
+    qDebug("%s: lookup of %s: %s, %u hits, %u misses", qPrintable(fileName), qPrintable(name),
+           getter == getterMegamorphic ? "megamorphic" : qPrintable(QString::fromLatin1("%1 internal classes").arg(cache->count)),
+           cache->hits, cache->misses);
+}
+
+void Lookup::dumpStatistics(const LookupStubCache *cache)
+{
+    if (cache)
+        qDebug("Megamorphic lookup stub cache: %llu hits, %llu misses", cache->hits, cache->misses);
+}
+
 ReturnedValue Lookup::indexedGetterGeneric(Lookup *l, const Value &object, const Value &index)
 {
     uint idx;
@@ -183,9 +277,12 @@ ReturnedValue Lookup::indexedGetterObjectInt(Lookup *l, const Value &object, con
                 Heap::Object *o = static_cast<Heap::Object *>(b);
                 if (o->arrayData && o->arrayData->type == Heap::ArrayData::Simple) {
                     Heap::SimpleArrayData *s = o->arrayData.cast<Heap::SimpleArrayData>();
-                    if (idx < s->len)
-                        if (!s->data(idx).isEmpty())
-                            return s->data(idx).asReturnedValue();
+                    if (idx < s->len) {
+                        // packed arrays have no holes, so there's no need to look at the prototype
+                        Value v = s->data(idx);
+                        if (s->elementKind != Heap::ArrayData::Generic || !v.isEmpty())
+                            return v.asReturnedValue();
+                    }
                 }
             }
         }
@@ -219,7 +316,7 @@ void Lookup::indexedSetterFallback(Lookup *l, const Value &object, const Value &
         if (o->d()->arrayData && o->d()->arrayData->type == Heap::ArrayData::Simple) {
             Heap::SimpleArrayData *s = o->d()->arrayData.cast<Heap::SimpleArrayData>();
             if (idx < s->len) {
-                s->data(idx) = value;
+                s->setData(idx, value);
                 return;
             }
         }
@@ -241,7 +338,7 @@ void Lookup::indexedSetterObjectInt(Lookup *l, const Value &object, const Value
                 if (o->arrayData && o->arrayData->type == Heap::ArrayData::Simple) {
                     Heap::SimpleArrayData *s = o->arrayData.cast<Heap::SimpleArrayData>();
                     if (idx < s->len) {
-                        s->data(idx) = v;
+                        s->setData(idx, v);
                         return;
                     }
                 }
@@ -317,6 +414,8 @@ ReturnedValue Lookup::getterTwoClasses(Lookup *l, ExecutionEngine *engine, const
     if (l1.getter == Lookup::getter0MemberData || l1.getter == Lookup::getter0Inline || l1.getter == Lookup::getter1) {
         if (const Object *o = object.as<Object>()) {
             ReturnedValue v = o->getLookup(l);
+            if (l->getter == Lookup::getterQObject)
+                return v;
             Lookup l2 = *l;
 
             if (l2.index != UINT_MAX) {
@@ -359,8 +458,7 @@ ReturnedValue Lookup::getterTwoClasses(Lookup *l, ExecutionEngine *engine, const
         }
     }
 
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getterFallback(Lookup *l, ExecutionEngine *engine, const Value &object)
@@ -373,6 +471,68 @@ ReturnedValue Lookup::getterFallback(Lookup *l, ExecutionEngine *engine, const V
     return o->get(name);
 }
 
+ReturnedValue Lookup::getterPolymorphic(Lookup *l, ExecutionEngine *engine, const Value &object)
+{
+    PolymorphicLookupCache *cache = l->polymorphicCache;
+    const Object *o = object.as<Object>();
+    if (o) {
+        for (uint i = 0; i < cache->count; ++i) {
+            const LookupCacheEntry &e = cache->entries[i];
+            if (const Value *v = findProperty(e, o->d())) {
+                ++cache->hits;
+                return !e.attrs.isAccessor() ? v->asReturnedValue() : Object::getValue(object, *v, e.attrs);
+            }
+        }
+        if (hasDefaultGet(o) && cache->count == PolymorphicLookupCache::Size) {
+            // too many internal classes, continue with the engine wide stub cache
+            l->getter = getterMegamorphic;
+            return getterMegamorphic(l, engine, object);
+        }
+    }
+
+    ++cache->misses;
+    if (!o || !hasDefaultGet(o))
+        return getterFallback(l, engine, object);
+    ReturnedValue result;
+    if (probe(l, o, &cache->entries[cache->count], &result))
+        ++cache->count;
+    return result;
+}
+
+static inline uint stubCacheIndex(InternalClass *c, Identifier *name)
+{
+    return ((quintptr(c) >> 4) ^ (quintptr(name) >> 3)) & (LookupStubCache::Size - 1);
+}
+
+ReturnedValue Lookup::getterMegamorphic(Lookup *l, ExecutionEngine *engine, const Value &object)
+{
+    PolymorphicLookupCache *statistics = l->polymorphicCache;
+    const Object *o = object.as<Object>();
+    if (!o || !hasDefaultGet(o)) {
+        ++statistics->misses;
+        return getterFallback(l, engine, object);
+    }
+
+    LookupStubCache *cache = engine->lookupStubCache;
+    if (!cache)
+        cache = engine->lookupStubCache = new LookupStubCache();
+    Identifier *name = engine->identifierTable->identifier(engine->current->compilationUnit->runtimeStrings[l->nameIndex]);
+    LookupStubCache::Entry &e = cache->entries[stubCacheIndex(o->internalClass(), name)];
+    if (e.name == name) {
+        if (const Value *v = findProperty(e, o->d())) {
+            ++statistics->hits;
+            ++cache->hits;
+            return !e.attrs.isAccessor() ? v->asReturnedValue() : Object::getValue(object, *v, e.attrs);
+        }
+    }
+
+    ++statistics->misses;
+    ++cache->misses;
+    ReturnedValue result;
+    e.name = probe(l, o, &e, &result) ? name : 0;
+    return result;
+}
+
 ReturnedValue Lookup::getter0MemberData(Lookup *l, ExecutionEngine *engine, const Value &object)
 {
     // we can safely cast to a QV4::Object here. If object is actually a string,
@@ -424,8 +584,7 @@ ReturnedValue Lookup::getter2(Lookup *l, ExecutionEngine *engine, const Value &o
             }
         }
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getter0Inlinegetter0Inline(Lookup *l, ExecutionEngine *engine, const Value &object)
@@ -439,8 +598,7 @@ ReturnedValue Lookup::getter0Inlinegetter0Inline(Lookup *l, ExecutionEngine *eng
         if (l->classList[2] == o->internalClass)
             return o->inlinePropertyData(l->index2)->asReturnedValue();
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getter0Inlinegetter0MemberData(Lookup *l, ExecutionEngine *engine, const Value &object)
@@ -454,8 +612,7 @@ ReturnedValue Lookup::getter0Inlinegetter0MemberData(Lookup *l, ExecutionEngine
         if (l->classList[2] == o->internalClass)
             return o->memberData->data[l->index2].asReturnedValue();
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getter0MemberDatagetter0MemberData(Lookup *l, ExecutionEngine *engine, const Value &object)
@@ -469,8 +626,7 @@ ReturnedValue Lookup::getter0MemberDatagetter0MemberData(Lookup *l, ExecutionEng
         if (l->classList[2] == o->internalClass)
             return o->memberData->data[l->index2].asReturnedValue();
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getter0Inlinegetter1(Lookup *l, ExecutionEngine *engine, const Value &object)
@@ -484,8 +640,7 @@ ReturnedValue Lookup::getter0Inlinegetter1(Lookup *l, ExecutionEngine *engine, c
         if (l->classList[2] == o->internalClass && l->classList[3] == o->prototype()->internalClass)
             return o->prototype()->propertyData(l->index2)->asReturnedValue();
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getter0MemberDatagetter1(Lookup *l, ExecutionEngine *engine, const Value &object)
@@ -499,8 +654,7 @@ ReturnedValue Lookup::getter0MemberDatagetter1(Lookup *l, ExecutionEngine *engin
         if (l->classList[2] == o->internalClass && l->classList[3] == o->prototype()->internalClass)
             return o->prototype()->propertyData(l->index2)->asReturnedValue();
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getter1getter1(Lookup *l, ExecutionEngine *engine, const Value &object)
@@ -515,10 +669,8 @@ ReturnedValue Lookup::getter1getter1(Lookup *l, ExecutionEngine *engine, const V
         if (l->classList[2] == o->internalClass &&
             l->classList[3] == o->prototype()->internalClass)
             return o->prototype()->propertyData(l->index2)->asReturnedValue();
-        return getterFallback(l, engine, object);
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 
@@ -540,8 +692,7 @@ ReturnedValue Lookup::getterAccessor0(Lookup *l, ExecutionEngine *engine, const
             return scope.result.asReturnedValue();
         }
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getterAccessor1(Lookup *l, ExecutionEngine *engine, const Value &object)
@@ -563,8 +714,7 @@ ReturnedValue Lookup::getterAccessor1(Lookup *l, ExecutionEngine *engine, const
             return scope.result.asReturnedValue();
         }
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getterAccessor2(Lookup *l, ExecutionEngine *engine, const Value &object)
@@ -591,8 +741,7 @@ ReturnedValue Lookup::getterAccessor2(Lookup *l, ExecutionEngine *engine, const
             }
         }
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return becomePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::primitiveGetter0Inline(Lookup *l, ExecutionEngine *engine, const Value &object)
@@ -688,6 +837,20 @@ ReturnedValue Lookup::arrayLengthGetter(Lookup *l, ExecutionEngine *engine, cons
     return getterGeneric(l, engine, object);
 }
 
+ReturnedValue Lookup::getterQObject(Lookup *l, ExecutionEngine *engine, const Value &object)
+{
+    if (const QObjectWrapper *wrapper = object.as<QObjectWrapper>()) {
+        QObject *o = wrapper->object();
+        QQmlData *ddata = QQmlData::wasDeleted(o) ? 0 : QQmlData::get(o);
+        if (ddata && ddata->propertyCache == l->qobjectLookup.propertyCache)
+            return QObjectWrapper::getProperty(engine, o, l->qobjectLookup.propertyData);
+    }
+
+    l->releasePropertyCache();
+    l->getter = getterGeneric;
+    return getterGeneric(l, engine, object);
+}
+
 
 ReturnedValue Lookup::globalGetterGeneric(Lookup *l, ExecutionEngine *engine)
 {
@@ -853,6 +1016,8 @@ void Lookup::setterTwoClasses(Lookup *l, ExecutionEngine *engine, Value &object,
 
     if (Object *o = object.as<Object>()) {
         o->setLookup(l, value);
+        if (l->setter == Lookup::setterQObject)
+            return;
 
         if (l->setter == Lookup::setter0 || l->setter == Lookup::setter0Inline) {
             l->setter = setter0setter0;
@@ -971,4 +1136,21 @@ void Lookup::setter0setter0(Lookup *l, ExecutionEngine *engine, Value &object, c
 
 }
 
+void Lookup::setterQObject(Lookup *l, ExecutionEngine *engine, Value &object, const Value &value)
+{
+    if (const QObjectWrapper *wrapper = object.as<QObjectWrapper>()) {
+        QObject *o = wrapper->object();
+        QQmlData *ddata = QQmlData::wasDeleted(o) ? 0 : QQmlData::get(o);
+        if (ddata && ddata->propertyCache == l->qobjectLookup.propertyCache) {
+            if (!engine->hasException)
+                QObjectWrapper::setProperty(engine, o, l->qobjectLookup.propertyData, value);
+            return;
+        }
+    }
+
+    l->releasePropertyCache();
+    l->setter = setterGeneric;
+    setterGeneric(l, engine, object, value);
+}
+
 QT_END_NAMESPACE
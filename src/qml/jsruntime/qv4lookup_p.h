@@ -62,9 +62,40 @@
 
 QT_BEGIN_NAMESPACE
 
+class QQmlPropertyCache;
+class QQmlPropertyData;
+
 namespace QV4 {
 
-struct Lookup {
+// Where a property was found, relative to the object it was looked up on.
+struct LookupCacheEntry {
+    InternalClass *classList[3];
+    uint level;
+    uint index;
+    PropertyAttributes attrs;
+};
+
+// Replaces the internal classes of a lookup site that has seen more than two of them.
+struct PolymorphicLookupCache {
+    enum { Size = 8 };
+    uint count;
+    uint hits;
+    uint misses;
+    LookupCacheEntry entries[Size];
+};
+
+// Shared by all megamorphic lookup sites of an engine, keyed on internal class and name.
+struct LookupStubCache {
+    enum { Size = 1024 };
+    struct Entry : LookupCacheEntry {
+        Identifier *name;
+    };
+    Entry entries[Size];
+    quint64 hits;
+    quint64 misses;
+};
+
+struct Q_QML_PRIVATE_EXPORT Lookup {
     enum { Size = 4 };
     union {
         ReturnedValue (*indexedGetter)(Lookup *l, const Value &object, const Value &index);
@@ -82,6 +113,12 @@ struct Lookup {
             void *dummy2;
             Heap::Object *proto;
         };
+        // used by getterQObject and setterQObject, holds a reference to the property cache
+        struct {
+            QQmlPropertyCache *propertyCache;
+            QQmlPropertyData *propertyData;
+        } qobjectLookup;
+        PolymorphicLookupCache *polymorphicCache;
     };
     union {
         int level;
@@ -102,6 +139,8 @@ struct Lookup {
     static ReturnedValue getterGeneric(Lookup *l, ExecutionEngine *engine, const Value &object);
     static ReturnedValue getterTwoClasses(Lookup *l, ExecutionEngine *engine, const Value &object);
     static ReturnedValue getterFallback(Lookup *l, ExecutionEngine *engine, const Value &object);
+    static ReturnedValue getterPolymorphic(Lookup *l, ExecutionEngine *engine, const Value &object);
+    static ReturnedValue getterMegamorphic(Lookup *l, ExecutionEngine *engine, const Value &object);
 
     static ReturnedValue getter0MemberData(Lookup *l, ExecutionEngine *engine, const Value &object);
     static ReturnedValue getter0Inline(Lookup *l, ExecutionEngine *engine, const Value &object);
@@ -124,6 +163,7 @@ struct Lookup {
     static ReturnedValue primitiveGetterAccessor1(Lookup *l, ExecutionEngine *engine, const Value &object);
     static ReturnedValue stringLengthGetter(Lookup *l, ExecutionEngine *engine, const Value &object);
     static ReturnedValue arrayLengthGetter(Lookup *l, ExecutionEngine *engine, const Value &object);
+    static ReturnedValue getterQObject(Lookup *l, ExecutionEngine *engine, const Value &object);
 
     static ReturnedValue globalGetterGeneric(Lookup *l, ExecutionEngine *engine);
     static ReturnedValue globalGetter0Inline(Lookup *l, ExecutionEngine *engine);
@@ -143,9 +183,16 @@ struct Lookup {
     static void setterInsert1(Lookup *l, ExecutionEngine *engine, Value &object, const Value &value);
     static void setterInsert2(Lookup *l, ExecutionEngine *engine, Value &object, const Value &value);
     static void setter0setter0(Lookup *l, ExecutionEngine *engine, Value &object, const Value &value);
+    static void setterQObject(Lookup *l, ExecutionEngine *engine, Value &object, const Value &value);
 
     ReturnedValue lookup(const Value &thisObject, Object *obj, PropertyAttributes *attrs);
     ReturnedValue lookup(const Object *obj, PropertyAttributes *attrs);
+    void releasePropertyCache();
+    void releaseCaches();
+
+    static bool showStatistics();
+    void dumpStatistics(const QString &fileName, const QString &name) const;
+    static void dumpStatistics(const LookupStubCache *cache);
 
 };
 
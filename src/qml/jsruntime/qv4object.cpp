@@ -320,11 +320,8 @@ Value *Object::getValueOrSetter(uint index, PropertyAttributes *attrs)
 {
     Heap::Object *o = d();
     while (o) {
-        Property *p = o->arrayData ? o->arrayData->getProperty(index) : 0;
-        if (p) {
-            *attrs = o->arrayData->attributes(index);
-            return attrs->isAccessor() ? &p->set : &p->value;
-        }
+        if (Value *v = o->arrayData ? o->arrayData->getValueOrSetter(index, attrs) : 0)
+            return v;
         if (o->vtable()->type == Type_StringObject) {
             if (index < static_cast<const Heap::StringObject *>(o)->length()) {
                 // this is an evil hack, but it works, as the method is only ever called from putIndexed,
@@ -474,6 +471,13 @@ bool Object::deleteIndexedProperty(Managed *m, uint index)
 ReturnedValue Object::getLookup(const Managed *m, Lookup *l)
 {
     const Object *o = static_cast<const Object *>(m);
+    if (o->vtable()->get != static_vtbl.get) {
+        // objects with their own get() can't be cached on their internal class
+        Scope scope(o->engine());
+        ScopedString name(scope, scope.engine->current->compilationUnit->runtimeStrings[l->nameIndex]);
+        l->index = UINT_MAX;
+        return o->get(name);
+    }
     PropertyAttributes attrs;
     ReturnedValue v = l->lookup(o, &attrs);
     if (v != Primitive::emptyValue().asReturnedValue()) {
@@ -516,6 +520,10 @@ void Object::setLookup(Managed *m, Lookup *l, const Value &value)
     Scope scope(static_cast<Object *>(m)->engine());
     ScopedObject o(scope, static_cast<Object *>(m));
     ScopedString name(scope, scope.engine->current->compilationUnit->runtimeStrings[l->nameIndex]);
+    if (o->vtable()->put != static_vtbl.put) {
+        o->put(name, value);
+        return;
+    }
 
     InternalClass *c = o->internalClass();
     uint idx = c->find(name);
@@ -596,7 +604,7 @@ void Object::advanceIterator(Managed *m, ObjectIterator *it, Value *name, uint *
         // dense arrays
         while (it->arrayIndex < o->d()->arrayData->len) {
             Heap::SimpleArrayData *sa = o->d()->arrayData.cast<Heap::SimpleArrayData>();
-            Value &val = sa->data(it->arrayIndex);
+            Value val = sa->data(it->arrayIndex);
             PropertyAttributes a = o->arrayData()->attributes(it->arrayIndex);
             ++it->arrayIndex;
             if (!val.isEmpty()
@@ -1137,6 +1145,7 @@ void Object::copyArrayData(Object *other)
             Heap::ArrayData *dd = d()->arrayData;
             dd->len = other->d()->arrayData->len;
             dd->offset = other->d()->arrayData->offset;
+            dd->elementKind = other->d()->arrayData->elementKind;
         }
         memcpy(d()->arrayData->arrayData, other->d()->arrayData->arrayData, other->d()->arrayData->alloc*sizeof(Value));
     }
@@ -0,0 +1,164 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qv4perfmap_p.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMutex>
+#include <QtCore/qatomic.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+QT_BEGIN_NAMESPACE
+
+using namespace QV4;
+
+#if defined(Q_OS_LINUX)
+static QBasicAtomicInt enabledByApi = Q_BASIC_ATOMIC_INITIALIZER(0);
+static QBasicMutex perfMapMutex;
+static FILE *perfMap = 0;
+static bool perfMapOpened = false;
+
+static void closePerfMap()
+{
+    QMutexLocker locker(&perfMapMutex);
+    if (perfMap) {
+        fclose(perfMap);
+        perfMap = 0;
+    }
+}
+
+static void writeEntry(const void *code, size_t size, const QByteArray &name)
+{
+    QMutexLocker locker(&perfMapMutex);
+    if (!perfMapOpened) {
+        perfMapOpened = true;
+
+        const QByteArray fileName = "/tmp/perf-" + QByteArray::number(QCoreApplication::applicationPid()) + ".map";
+        perfMap = fopen(fileName.constData(), "w");
+        if (!perfMap) {
+            qWarning("QV4: Can't write %s, call stacks will not contain JavaScript function names", fileName.constData());
+            return;
+        }
+
+        // make sure we clean up nicely
+        std::atexit(closePerfMap);
+    }
+
+    if (!perfMap)
+        return;
+
+    fprintf(perfMap, "%llx %llx %.*s\n",
+            (unsigned long long)quintptr(code),
+            (unsigned long long)size,
+            name.length(),
+            name.constData());
+    fflush(perfMap);
+}
+#endif
+
+bool PerfMap::isEnabled()
+{
+#if defined(Q_OS_LINUX)
+    static const bool enabledByEnvironment = !qEnvironmentVariableIsEmpty("QV4_PROFILE_WRITE_PERF_MAP");
+    return enabledByEnvironment || enabledByApi.load();
+#else
+    return false;
+#endif
+}
+
+void PerfMap::setEnabled(bool enabled)
+{
+#if defined(Q_OS_LINUX)
+    enabledByApi.store(enabled ? 1 : 0);
+#else
+    Q_UNUSED(enabled);
+#endif
+}
+
+void PerfMap::recordFunction(const void *code, size_t size, const QString &name,
+                             const QString &fileName, int line)
+{
+#if defined(Q_OS_LINUX)
+    if (!isEnabled())
+        return;
+
+    QByteArray entry = name.isEmpty() ? QByteArrayLiteral("<anonymous>") : name.toUtf8();
+    if (!fileName.isEmpty())
+        entry += " (" + fileName.toUtf8() + ':' + QByteArray::number(line) + ')';
+    writeEntry(code, size, entry);
+#else
+    Q_UNUSED(code);
+    Q_UNUSED(size);
+    Q_UNUSED(name);
+    Q_UNUSED(fileName);
+    Q_UNUSED(line);
+#endif
+}
+
+void PerfMap::recordRegExp(const void *code, size_t size, const QString &pattern,
+                           bool global, bool ignoreCase, bool multiline)
+{
+#if defined(Q_OS_LINUX)
+    if (!isEnabled())
+        return;
+
+    QByteArray entry = "RegExp /" + pattern.toUtf8() + '/';
+    if (global)
+        entry += 'g';
+    if (ignoreCase)
+        entry += 'i';
+    if (multiline)
+        entry += 'm';
+    // A pattern can contain line breaks, which would end the entry early.
+    entry.replace('\n', "\\n");
+    entry.replace('\r', "\\r");
+    writeEntry(code, size, entry);
+#else
+    Q_UNUSED(code);
+    Q_UNUSED(size);
+    Q_UNUSED(pattern);
+    Q_UNUSED(global);
+    Q_UNUSED(ignoreCase);
+    Q_UNUSED(multiline);
+#endif
+}
+
+QT_END_NAMESPACE
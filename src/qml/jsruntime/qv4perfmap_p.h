@@ -0,0 +1,86 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QV4PERFMAP_P_H
+#define QV4PERFMAP_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qv4global_p.h"
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+
+namespace QV4 {
+
+// Tells Linux perf about generated code, so that samples in JIT'd JavaScript functions and
+// regular expressions resolve to names instead of bare addresses.
+//
+// Entries go to /tmp/perf-<pid>.map, one line per code blob with its address, its size and a
+// name of the form "function (file:line)", see
+// https://github.com/torvalds/linux/blob/master/tools/perf/Documentation/jit-interface.txt
+// for the format. Writing is enabled by QV4_PROFILE_WRITE_PERF_MAP or by calling setEnabled()
+// before the code of interest is compiled. The map is per process, and so is the switch.
+// On other platforms, nothing is written.
+class Q_QML_PRIVATE_EXPORT PerfMap
+{
+public:
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    static void recordFunction(const void *code, size_t size, const QString &name,
+                               const QString &fileName, int line);
+    static void recordRegExp(const void *code, size_t size, const QString &pattern,
+                             bool global, bool ignoreCase, bool multiline);
+};
+
+} // namespace QV4
+
+QT_END_NAMESPACE
+
+#endif // QV4PERFMAP_P_H
@@ -48,7 +48,14 @@ namespace Profiling {
 
 FunctionLocation FunctionCall::resolveLocation() const
 {
-    return FunctionLocation(m_function->name()->toQString(),
+    // Functions that move from the interpreter to the JIT show up once per tier.
+    QString name = m_function->name()->toQString();
+    if (m_tier == Function::InterpreterTier)
+        name += QLatin1String(" (interpreted)");
+    else if (m_tier == Function::JitTier)
+        name += QLatin1String(" (JIT)");
+
+    return FunctionLocation(name,
                             m_function->compilationUnit->fileName(),
                             m_function->compiledFunction->location.line,
                             m_function->compiledFunction->location.column);
@@ -59,16 +66,20 @@ FunctionCallProperties FunctionCall::properties() const
     FunctionCallProperties props = {
         m_start,
         m_end,
-        reinterpret_cast<quintptr>(m_function)
+        // Functions are allocated with at least pointer alignment, which leaves the lowest bit
+        // to tell the tiers apart.
+        reinterpret_cast<quintptr>(m_function) | (m_tier == Function::JitTier ? 1 : 0)
     };
     return props;
 }
 
-Profiler::Profiler(QV4::ExecutionEngine *engine) : featuresEnabled(0), m_engine(engine)
+Profiler::Profiler(QV4::ExecutionEngine *engine) :
+    featuresEnabled(0), m_engine(engine), m_trackingAllocations(false)
 {
     static const int metatypes[] = {
         qRegisterMetaType<QVector<QV4::Profiling::FunctionCallProperties> >(),
         qRegisterMetaType<QVector<QV4::Profiling::MemoryAllocationProperties> >(),
+        qRegisterMetaType<QVector<QV4::Profiling::AllocationStatisticsProperties> >(),
         qRegisterMetaType<FunctionLocationHash>()
     };
     Q_UNUSED(metatypes);
@@ -80,6 +91,10 @@ void Profiler::stopProfiling()
     featuresEnabled = 0;
     reportData(true);
     m_sentLocations.clear();
+    if (m_trackingAllocations) {
+        m_engine->memoryManager->setAllocationTracking(false);
+        m_trackingAllocations = false;
+    }
 }
 
 bool operator<(const FunctionCall &call1, const FunctionCall &call2)
@@ -99,7 +114,7 @@ void Profiler::reportData(bool trackLocations)
     for (const FunctionCall &call : qAsConst(m_data)) {
         properties.append(call.properties());
         Function *function = call.function();
-        SentMarker &marker = m_sentLocations[reinterpret_cast<quintptr>(function)];
+        SentMarker &marker = m_sentLocations[properties.constLast().id];
         if (!trackLocations || !marker.isValid()) {
             FunctionLocation &location = locations[properties.constLast().id];
             if (!location.isValid())
@@ -109,11 +124,42 @@ void Profiler::reportData(bool trackLocations)
         }
     }
 
-    emit dataReady(locations, properties, m_memory_data);
+    emit dataReady(locations, properties, m_memory_data, collectAllocationStatistics());
     m_data.clear();
     m_memory_data.clear();
 }
 
+QVector<AllocationStatisticsProperties> Profiler::collectAllocationStatistics()
+{
+    QVector<AllocationStatisticsProperties> result;
+    if (!m_trackingAllocations)
+        return result;
+
+    MemoryManager *mm = m_engine->memoryManager;
+    const AllocationStatistics *stats = mm->allocationStatistics();
+    const qint64 timestamp = m_timer.nsecsElapsed();
+    result.reserve(stats->types.size() + stats->sites.size());
+    for (auto it = stats->types.cbegin(), end = stats->types.cend(); it != end; ++it) {
+        AllocationStatisticsProperties type = {
+            timestamp, TypeStatistics, QString::fromLatin1(it.key()->className), QString(), -1,
+            it->allocations, it->bytes, it->survivors, it->survivedBytes
+        };
+        result.append(type);
+    }
+    for (auto it = stats->sites.cbegin(), end = stats->sites.cend(); it != end; ++it) {
+        Function *function = it.key().first;
+        AllocationStatisticsProperties site = {
+            timestamp, SiteStatistics,
+            function ? function->name()->toQString() : QString(),
+            function ? function->sourceFile() : QString(), it.key().second,
+            it->allocations, it->bytes, 0, 0
+        };
+        result.append(site);
+    }
+    mm->resetAllocationStatistics();
+    return result;
+}
+
 void Profiler::startProfiling(quint64 features)
 {
     if (featuresEnabled == 0) {
@@ -133,6 +179,13 @@ void Profiler::startProfiling(quint64 features)
             m_memory_data.append(large);
         }
 
+        // If someone else is tracking, leave their statistics alone.
+        if ((features & (1 << FeatureAllocationStatistics))
+                && !m_engine->memoryManager->isTrackingAllocations()) {
+            m_engine->memoryManager->setAllocationTracking(true);
+            m_trackingAllocations = true;
+        }
+
         featuresEnabled = features;
     }
 }
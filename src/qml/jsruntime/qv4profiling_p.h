@@ -99,7 +99,8 @@ namespace Profiling {
 
 enum Features {
     FeatureFunctionCall,
-    FeatureMemoryAllocation
+    FeatureMemoryAllocation,
+    FeatureAllocationStatistics
 };
 
 enum MemoryType {
@@ -108,6 +109,11 @@ enum MemoryType {
     SmallItem
 };
 
+enum AllocationStatisticsType {
+    TypeStatistics,
+    SiteStatistics
+};
+
 struct FunctionCallProperties {
     qint64 start;
     qint64 end;
@@ -139,18 +145,33 @@ struct MemoryAllocationProperties {
     MemoryType type;
 };
 
+// Allocations since the last report, per type or per allocation site. The survivors are the
+// objects of the type alive after the last collection.
+struct AllocationStatisticsProperties {
+    qint64 timestamp;
+    AllocationStatisticsType type;
+    QString name;
+    QString file;
+    int line;
+    quint64 allocations;
+    quint64 bytes;
+    quint64 survivors;
+    quint64 survivedBytes;
+};
+
 class FunctionCall {
 public:
 
-    FunctionCall() : m_function(0), m_start(0), m_end(0)
+    FunctionCall() : m_function(0), m_start(0), m_end(0), m_tier(Function::NotTiered)
     { Q_ASSERT_X(false, Q_FUNC_INFO, "Cannot construct a function call without function"); }
 
-    FunctionCall(Function *function, qint64 start, qint64 end) :
-        m_function(function), m_start(start), m_end(end)
+    FunctionCall(Function *function, qint64 start, qint64 end, Function::Tier tier) :
+        m_function(function), m_start(start), m_end(end), m_tier(tier)
     { m_function->compilationUnit->addref(); }
 
     FunctionCall(const FunctionCall &other) :
-        m_function(other.m_function), m_start(other.m_start), m_end(other.m_end)
+        m_function(other.m_function), m_start(other.m_start), m_end(other.m_end),
+        m_tier(other.m_tier)
     { m_function->compilationUnit->addref(); }
 
     ~FunctionCall()
@@ -163,6 +184,7 @@ public:
             m_function = other.m_function;
             m_start = other.m_start;
             m_end = other.m_end;
+            m_tier = other.m_tier;
         }
         return *this;
     }
@@ -181,6 +203,7 @@ private:
     Function *m_function;
     qint64 m_start;
     qint64 m_end;
+    Function::Tier m_tier; // the tier the call ran in
 };
 
 class Q_QML_EXPORT Profiler : public QObject {
@@ -252,14 +275,18 @@ public:
 signals:
     void dataReady(const QV4::Profiling::FunctionLocationHash &,
                    const QVector<QV4::Profiling::FunctionCallProperties> &,
-                   const QVector<QV4::Profiling::MemoryAllocationProperties> &);
+                   const QVector<QV4::Profiling::MemoryAllocationProperties> &,
+                   const QVector<QV4::Profiling::AllocationStatisticsProperties> &);
 
 private:
+    QVector<AllocationStatisticsProperties> collectAllocationStatistics();
+
     QV4::ExecutionEngine *m_engine;
     QElapsedTimer m_timer;
     QVector<FunctionCall> m_data;
     QVector<MemoryAllocationProperties> m_memory_data;
     QHash<quintptr, SentMarker> m_sentLocations;
+    bool m_trackingAllocations;
 
     friend class FunctionCallProfiler;
 };
@@ -271,12 +298,14 @@ public:
     // It's enough to ref() the function in the destructor as it will probably not disappear while
     // it's executing ...
     FunctionCallProfiler(Profiler *profiler, Function *function) :
-        profiler(profiler), function(function), startTime(profiler->m_timer.nsecsElapsed())
+        profiler(profiler), function(function), startTime(profiler->m_timer.nsecsElapsed()),
+        tier(function->tier)
     {}
 
     ~FunctionCallProfiler()
     {
-        profiler->m_data.append(FunctionCall(function, startTime, profiler->m_timer.nsecsElapsed()));
+        profiler->m_data.append(FunctionCall(function, startTime, profiler->m_timer.nsecsElapsed(),
+                                             tier));
     }
 
     static ReturnedValue profileCall(Profiler *profiler, ExecutionEngine *engine, Function *function)
@@ -288,6 +317,7 @@ public:
     Profiler *profiler;
     Function *function;
     qint64 startTime;
+    Function::Tier tier;
 };
 
 
@@ -296,6 +326,7 @@ public:
 
 Q_DECLARE_TYPEINFO(QV4::Profiling::MemoryAllocationProperties, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QV4::Profiling::FunctionCallProperties, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QV4::Profiling::AllocationStatisticsProperties, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QV4::Profiling::FunctionCall, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QV4::Profiling::FunctionLocation, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QV4::Profiling::Profiler::SentMarker, Q_MOVABLE_TYPE);
@@ -304,6 +335,7 @@ QT_END_NAMESPACE
 Q_DECLARE_METATYPE(QV4::Profiling::FunctionLocationHash)
 Q_DECLARE_METATYPE(QVector<QV4::Profiling::FunctionCallProperties>)
 Q_DECLARE_METATYPE(QVector<QV4::Profiling::MemoryAllocationProperties>)
+Q_DECLARE_METATYPE(QVector<QV4::Profiling::AllocationStatisticsProperties>)
 
 #endif // QT_NO_QML_DEBUGGER
 
@@ -65,6 +65,7 @@
 #include <private/qv4mm_p.h>
 #include <private/qqmlscriptstring_p.h>
 #include <private/qv4compileddata_p.h>
+#include <private/qv4lookup_p.h>
 
 #include <QtQml/qjsvalue.h>
 #include <QtCore/qjsonarray.h>
@@ -661,6 +662,60 @@ PropertyAttributes QObjectWrapper::query(const Managed *m, String *name)
         return QV4::Object::query(m, name);
 }
 
+// Returns the property a lookup can be cached on, together with the object's property cache.
+static QQmlPropertyData *cacheableProperty(ExecutionEngine *engine, QObject *object, String *name, QQmlPropertyCache **cache)
+{
+    if (QQmlData::wasDeleted(object) || name->equals(engine->id_destroy()) || name->equals(engine->id_toString()))
+        return 0;
+    QQmlData *ddata = QQmlData::get(object, false);
+    // Overridden properties resolve differently depending on the calling context.
+    if (!ddata || !ddata->propertyCache || ddata->propertyCache->hasPropertyOverrides())
+        return 0;
+    *cache = ddata->propertyCache;
+    return ddata->propertyCache->property(name, object, 0);
+}
+
+ReturnedValue QObjectWrapper::getLookup(const Managed *m, Lookup *l)
+{
+    const QObjectWrapper *that = static_cast<const QObjectWrapper*>(m);
+    ExecutionEngine *v4 = that->engine();
+    Scope scope(v4);
+    ScopedString name(scope, v4->current->compilationUnit->runtimeStrings[l->nameIndex]);
+
+    QQmlPropertyCache *cache = 0;
+    if (QQmlPropertyData *property = cacheableProperty(v4, that->d()->object(), name, &cache)) {
+        cache->addref();
+        l->qobjectLookup.propertyCache = cache;
+        l->qobjectLookup.propertyData = property;
+        l->getter = Lookup::getterQObject;
+        return getProperty(v4, that->d()->object(), property);
+    }
+
+    l->index = UINT_MAX;
+    return that->get(name);
+}
+
+void QObjectWrapper::setLookup(Managed *m, Lookup *l, const Value &value)
+{
+    QObjectWrapper *that = static_cast<QObjectWrapper*>(m);
+    ExecutionEngine *v4 = that->engine();
+    Scope scope(v4);
+    ScopedString name(scope, v4->current->compilationUnit->runtimeStrings[l->nameIndex]);
+
+    QQmlPropertyCache *cache = 0;
+    QQmlPropertyData *property = cacheableProperty(v4, that->d()->object(), name, &cache);
+    if (!property || v4->hasException) {
+        put(m, name, value);
+        return;
+    }
+
+    cache->addref();
+    l->qobjectLookup.propertyCache = cache;
+    l->qobjectLookup.propertyData = property;
+    l->setter = Lookup::setterQObject;
+    setProperty(v4, that->d()->object(), property, value);
+}
+
 void QObjectWrapper::advanceIterator(Managed *m, ObjectIterator *it, Value *name, uint *index, Property *p, PropertyAttributes *attributes)
 {
     // Used to block access to QObject::destroyed() and QObject::deleteLater() from QML
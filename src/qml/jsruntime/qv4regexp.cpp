@@ -40,16 +40,148 @@
 #include "qv4regexp_p.h"
 #include "qv4engine_p.h"
 #include "qv4scopedvalue_p.h"
+#include "qv4perfmap_p.h"
 #include <private/qv4mm_p.h>
 
+#include <QtCore/QDebug>
+
 using namespace QV4;
 
+static int cacheLimit(const char *variable, int defaultValue)
+{
+    bool ok = false;
+    const int value = qEnvironmentVariableIntValue(variable, &ok);
+    return (ok && value >= 0) ? value : defaultValue;
+}
+
+RegExpCache::RegExpCache()
+    : maxEntries(cacheLimit("QV4_REGEXP_CACHE_SIZE", DefaultMaxEntries))
+    , maxJitCodeSize(size_t(cacheLimit("QV4_REGEXP_CACHE_JIT_SIZE", DefaultMaxJitCodeSize)))
+{
+}
+
 RegExpCache::~RegExpCache()
 {
-    for (RegExpCache::Iterator it = begin(), e = end(); it != e; ++it) {
-        if (RegExp *re = it.value().as<RegExp>())
-            re->d()->cache = 0;
+    static const bool showStatistics = !qEnvironmentVariableIsEmpty("QV4_REGEXP_CACHE_STATS");
+    if (showStatistics) {
+        const Statistics stats = statistics();
+        qDebug() << "RegExpCache:" << stats.hits << "hit(s)," << stats.misses << "miss(es),"
+                 << stats.evictions << "eviction(s);" << stats.entries << "pattern(s) with"
+                 << stats.jitCodeSize << "bytes of JIT code left";
+    }
+
+    for (Heap::RegExp *re = m_oldest; re; re = re->cacheNext)
+        re->cache = 0;
+}
+
+size_t RegExpCache::jitCodeSize(Heap::RegExp *regExp)
+{
+#if ENABLE(YARR_JIT)
+    if (regExp->jitCode && regExp->jitCode->has16BitCode())
+        return regExp->jitCode->get16BitCodeSize();
+#else
+    Q_UNUSED(regExp);
+#endif
+    return 0;
+}
+
+void RegExpCache::link(Heap::RegExp *regExp)
+{
+    regExp->cachePrevious = m_newest;
+    regExp->cacheNext = 0;
+    if (m_newest)
+        m_newest->cacheNext = regExp;
+    else
+        m_oldest = regExp;
+    m_newest = regExp;
+}
+
+void RegExpCache::unlink(Heap::RegExp *regExp)
+{
+    if (regExp->cachePrevious)
+        regExp->cachePrevious->cacheNext = regExp->cacheNext;
+    else
+        m_oldest = regExp->cacheNext;
+    if (regExp->cacheNext)
+        regExp->cacheNext->cachePrevious = regExp->cachePrevious;
+    else
+        m_newest = regExp->cachePrevious;
+    regExp->cachePrevious = regExp->cacheNext = 0;
+}
+
+Heap::RegExp *RegExpCache::lookup(const RegExpCacheKey &key)
+{
+    QHash<RegExpCacheKey, WeakValue>::ConstIterator it = m_entries.constFind(key);
+    if (it != m_entries.constEnd()) {
+        if (RegExp *result = it->as<RegExp>()) {
+            ++m_hits;
+            result->d()->recentlyUsed = true;
+            return result->d();
+        }
     }
+    ++m_misses;
+    return 0;
+}
+
+void RegExpCache::insert(ExecutionEngine *engine, Heap::RegExp *regExp)
+{
+    Q_ASSERT(!regExp->cache);
+    m_entries[RegExpCacheKey(regExp)].set(engine, regExp);
+    m_jitCodeSize += jitCodeSize(regExp);
+    evictIfNeeded();
+
+    regExp->cache = this;
+    link(regExp);
+}
+
+void RegExpCache::remove(Heap::RegExp *regExp)
+{
+    Q_ASSERT(regExp->cache == this);
+    unlink(regExp);
+    m_jitCodeSize -= jitCodeSize(regExp);
+    regExp->cache = 0;
+
+    // The entry may already belong to a newer RegExp with the same key.
+    QHash<RegExpCacheKey, WeakValue>::Iterator it = m_entries.find(RegExpCacheKey(regExp));
+    if (it != m_entries.end()) {
+        RegExp *current = it->as<RegExp>();
+        if (!current || current->d() == regExp)
+            m_entries.erase(it);
+    }
+}
+
+// Runs before the newest entry is linked, so that it cannot be evicted right away.
+void RegExpCache::evictIfNeeded()
+{
+    // Every pattern gets at most one second chance per round.
+    int budget = 2 * m_entries.size();
+    while ((m_entries.size() > maxEntries || m_jitCodeSize > maxJitCodeSize) && m_oldest && budget-- > 0) {
+        Heap::RegExp *candidate = m_oldest;
+        if (candidate->recentlyUsed) {
+            candidate->recentlyUsed = false;
+            unlink(candidate);
+            link(candidate);
+            continue;
+        }
+
+        remove(candidate);
+#if ENABLE(YARR_JIT)
+        if (candidate->jitCode)
+            candidate->jitCode->clear();
+#endif
+        ++m_evictions;
+    }
+}
+
+RegExpCache::Statistics RegExpCache::statistics() const
+{
+    Statistics stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.evictions = m_evictions;
+    stats.entries = m_entries.size();
+    stats.jitCodeSize = m_jitCodeSize;
+    return stats;
 }
 
 DEFINE_MANAGED_VTABLE(RegExp);
@@ -61,6 +193,8 @@ uint RegExp::match(const QString &string, int start, uint *matchOffsets)
 
     WTF::String s(string);
 
+    d()->recentlyUsed = true;
+
 #if ENABLE(YARR_JIT)
     if (!jitCode()->isFallBack() && jitCode()->has16BitCode())
         return uint(jitCode()->execute(s.characters16(), start, s.length(), (int*)matchOffsets).start);
@@ -77,19 +211,24 @@ Heap::RegExp *RegExp::create(ExecutionEngine* engine, const QString& pattern, bo
     if (!cache)
         cache = engine->regExpCache = new RegExpCache;
 
-    QV4::WeakValue &cachedValue = (*cache)[key];
-    if (QV4::RegExp *result = cachedValue.as<RegExp>())
-        return result->d();
+    if (Heap::RegExp *cached = cache->lookup(key))
+        return cached;
 
     Scope scope(engine);
     Scoped<RegExp> result(scope, engine->memoryManager->alloc<RegExp>(engine, pattern, ignoreCase, multiline, global));
 
-    result->d()->cache = cache;
-    cachedValue.set(engine, result);
+    cache->insert(engine, result->d());
 
     return result->d();
 }
 
+Heap::RegExp *RegExp::reviveIfEvicted(ExecutionEngine *engine, Heap::RegExp *regExp)
+{
+    if (regExp->cache)
+        return regExp;
+    return create(engine, *regExp->pattern, regExp->ignoreCase, regExp->multiLine, regExp->global);
+}
+
 void Heap::RegExp::init(ExecutionEngine* engine, const QString &pattern, bool ignoreCase, bool multiline, bool global)
 {
     Base::init();
@@ -97,6 +236,10 @@ void Heap::RegExp::init(ExecutionEngine* engine, const QString &pattern, bool ig
     this->ignoreCase = ignoreCase;
     this->multiLine = multiline;
     this->global = global;
+    cache = 0;
+    cachePrevious = 0;
+    cacheNext = 0;
+    recentlyUsed = false;
 
     const char* error = 0;
     JSC::Yarr::YarrPattern yarrPattern(WTF::String(pattern), ignoreCase, multiline, &error);
@@ -110,16 +253,18 @@ void Heap::RegExp::init(ExecutionEngine* engine, const QString &pattern, bool ig
     if (!yarrPattern.m_containsBackreferences && engine->iselFactory->jitCompileRegexps()) {
         JSC::JSGlobalData dummy(engine->regExpAllocator);
         JSC::Yarr::jitCompile(yarrPattern, JSC::Yarr::Char16, &dummy, *jitCode);
+        if (PerfMap::isEnabled() && !jitCode->isFallBack() && jitCode->has16BitCode()) {
+            PerfMap::recordRegExp(jitCode->get16BitCodeAddr(), jitCode->get16BitCodeSize(), pattern,
+                                  global, ignoreCase, multiline);
+        }
     }
 #endif
 }
 
 void Heap::RegExp::destroy()
 {
-    if (cache) {
-        RegExpCacheKey key(this);
-        cache->remove(key);
-    }
+    if (cache)
+        cache->remove(this);
 #if ENABLE(YARR_JIT)
     delete jitCode;
 #endif
@@ -65,6 +65,7 @@
 
 #include "qv4managed_p.h"
 #include "qv4engine_p.h"
+#include "qv4regexpcache_p.h"
 
 QT_BEGIN_NAMESPACE
 
@@ -85,10 +86,14 @@ struct RegExp : Base {
     JSC::Yarr::YarrCodeBlock *jitCode;
 #endif
     RegExpCache *cache;
+    // Links in the eviction order of the cache, see RegExpCache.
+    RegExp *cachePrevious;
+    RegExp *cacheNext;
     int subPatternCount;
     bool ignoreCase;
     bool multiLine;
     bool global;
+    bool recentlyUsed;
 
     int captureCount() const { return subPatternCount + 1; }
 };
@@ -115,6 +120,8 @@ struct RegExp : public Managed
     bool global() const { return d()->global; }
 
     static Heap::RegExp *create(ExecutionEngine* engine, const QString& pattern, bool ignoreCase = false, bool multiline = false, bool global = false);
+    // Returns regExp, or a freshly compiled copy of it if it was evicted from the cache.
+    static Heap::RegExp *reviveIfEvicted(ExecutionEngine *engine, Heap::RegExp *regExp);
 
     bool isValid() const { return d()->byteCode; }
 
@@ -127,27 +134,6 @@ struct RegExp : public Managed
     friend class RegExpCache;
 };
 
-struct RegExpCacheKey
-{
-    RegExpCacheKey(const QString &pattern, bool ignoreCase, bool multiLine, bool global)
-        : pattern(pattern)
-        , ignoreCase(ignoreCase)
-        , multiLine(multiLine)
-        , global(global)
-    { }
-    explicit inline RegExpCacheKey(const RegExp::Data *re);
-
-    bool operator==(const RegExpCacheKey &other) const
-    { return pattern == other.pattern && ignoreCase == other.ignoreCase && multiLine == other.multiLine && global == other.global; }
-    bool operator!=(const RegExpCacheKey &other) const
-    { return !operator==(other); }
-
-    QString pattern;
-    uint ignoreCase : 1;
-    uint multiLine : 1;
-    uint global : 1;
-};
-
 inline RegExpCacheKey::RegExpCacheKey(const RegExp::Data *re)
     : pattern(*re->pattern)
     , ignoreCase(re->ignoreCase)
@@ -155,15 +141,6 @@ inline RegExpCacheKey::RegExpCacheKey(const RegExp::Data *re)
     , global(re->global)
 {}
 
-inline uint qHash(const RegExpCacheKey& key, uint seed = 0) Q_DECL_NOTHROW
-{ return qHash(key.pattern, seed); }
-
-class RegExpCache : public QHash<RegExpCacheKey, WeakValue>
-{
-public:
-    ~RegExpCache();
-};
-
 
 
 }
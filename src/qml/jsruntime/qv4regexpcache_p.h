@@ -0,0 +1,154 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QV4REGEXPCACHE_P_H
+#define QV4REGEXPCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qv4global_p.h"
+#include "qv4persistent_p.h"
+
+#include <QtCore/qhash.h>
+#include <QtCore/qstring.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QV4 {
+
+namespace Heap {
+struct RegExp;
+}
+
+struct RegExpCacheKey
+{
+    RegExpCacheKey(const QString &pattern, bool ignoreCase, bool multiLine, bool global)
+        : pattern(pattern)
+        , ignoreCase(ignoreCase)
+        , multiLine(multiLine)
+        , global(global)
+    { }
+    explicit inline RegExpCacheKey(const Heap::RegExp *re); // defined in qv4regexp_p.h
+
+    bool operator==(const RegExpCacheKey &other) const
+    { return pattern == other.pattern && ignoreCase == other.ignoreCase && multiLine == other.multiLine && global == other.global; }
+    bool operator!=(const RegExpCacheKey &other) const
+    { return !operator==(other); }
+
+    QString pattern;
+    uint ignoreCase : 1;
+    uint multiLine : 1;
+    uint global : 1;
+};
+
+inline uint qHash(const RegExpCacheKey& key, uint seed = 0) Q_DECL_NOTHROW
+{ return qHash(key.pattern, seed); }
+
+// Compiled regular expressions, shared by all users of the same pattern and flags. Entries are
+// weak, so patterns that are not used anymore go away with the next garbage collection. To keep
+// applications that build many patterns at run-time from holding on to their JIT code until
+// then, the cache is bounded as well: once it holds more than maxEntries patterns, or their JIT
+// code takes more than maxJitCodeSize bytes, the least recently used patterns are evicted. An
+// evicted pattern leaves the cache and releases its JIT code. Its bytecode stays until the
+// pattern is garbage collected, as users may still hold on to it; the limits only bound the JIT
+// code. Regular expression literals and RegExp.prototype.exec() pick up an evicted pattern
+// through RegExp::reviveIfEvicted(), which compiles it again.
+//
+// Recency is approximated with a second chance: lookups and matches flag a pattern as recently
+// used, and eviction passes over a flagged pattern once, clearing the flag.
+//
+// QV4_REGEXP_CACHE_SIZE and QV4_REGEXP_CACHE_JIT_SIZE override the limits, and
+// QV4_REGEXP_CACHE_STATS prints the statistics() when the engine is destroyed.
+class Q_QML_PRIVATE_EXPORT RegExpCache
+{
+public:
+    enum {
+        DefaultMaxEntries = 512,
+        DefaultMaxJitCodeSize = 4 * 1024 * 1024
+    };
+
+    struct Statistics
+    {
+        uint hits = 0;
+        uint misses = 0;
+        uint evictions = 0;
+        int entries = 0;
+        size_t jitCodeSize = 0;
+    };
+
+    RegExpCache();
+    ~RegExpCache();
+
+    Heap::RegExp *lookup(const RegExpCacheKey &key);
+    void insert(ExecutionEngine *engine, Heap::RegExp *regExp);
+    void remove(Heap::RegExp *regExp);
+
+    Statistics statistics() const;
+
+    const int maxEntries;
+    const size_t maxJitCodeSize;
+
+private:
+    static size_t jitCodeSize(Heap::RegExp *regExp);
+    void link(Heap::RegExp *regExp);
+    void unlink(Heap::RegExp *regExp);
+    void evictIfNeeded();
+
+    QHash<RegExpCacheKey, WeakValue> m_entries;
+    Heap::RegExp *m_oldest = nullptr;
+    Heap::RegExp *m_newest = nullptr;
+    size_t m_jitCodeSize = 0;
+    uint m_hits = 0;
+    uint m_misses = 0;
+    uint m_evictions = 0;
+};
+
+} // namespace QV4
+
+QT_END_NAMESPACE
+
+#endif // QV4REGEXPCACHE_P_H
@@ -364,6 +364,7 @@ void RegExpPrototype::method_exec(const BuiltinFunction *, Scope &scope, CallDat
         RETURN_RESULT(Encode::null());
     }
 
+    r->d()->value = RegExp::reviveIfEvicted(scope.engine, r->value());
     Q_ALLOCA_VAR(uint, matchOffsets, r->value()->captureCount() * 2 * sizeof(uint));
     const int result = Scoped<RegExp>(scope, r->value())->match(s, offset, matchOffsets);
 
@@ -665,9 +665,12 @@ ReturnedValue Runtime::method_getElement(ExecutionEngine *engine, const Value &o
                 Heap::Object *o = static_cast<Heap::Object *>(b);
                 if (o->arrayData && o->arrayData->type == Heap::ArrayData::Simple) {
                     Heap::SimpleArrayData *s = o->arrayData.cast<Heap::SimpleArrayData>();
-                    if (idx < s->len)
-                        if (!s->data(idx).isEmpty())
-                            return s->data(idx).asReturnedValue();
+                    if (idx < s->len) {
+                        // packed arrays have no holes, so there's no need to look at the prototype
+                        Value v = s->data(idx);
+                        if (s->elementKind != Heap::ArrayData::Generic || !v.isEmpty())
+                            return v.asReturnedValue();
+                    }
                 }
             }
         }
@@ -689,7 +692,7 @@ static Q_NEVER_INLINE void setElementFallback(ExecutionEngine *engine, const Val
         if (o->d()->arrayData && o->d()->arrayData->type == Heap::ArrayData::Simple) {
             Heap::SimpleArrayData *s = o->d()->arrayData.cast<Heap::SimpleArrayData>();
             if (idx < s->len) {
-                s->data(idx) = value;
+                s->setData(idx, value);
                 return;
             }
         }
@@ -711,7 +714,7 @@ void Runtime::method_setElement(ExecutionEngine *engine, const Value &object, co
                 if (o->arrayData && o->arrayData->type == Heap::ArrayData::Simple) {
                     Heap::SimpleArrayData *s = o->arrayData.cast<Heap::SimpleArrayData>();
                     if (idx < s->len) {
-                        s->data(idx) = value;
+                        s->setData(idx, value);
                         return;
                     }
                 }
@@ -1481,7 +1484,7 @@ ReturnedValue Runtime::method_regexpLiteral(ExecutionEngine *engine, int id)
 {
     Heap::RegExpObject *ro = engine->newRegExpObject(
             static_cast<CompiledData::CompilationUnit*>(engine->current->compilationUnit)
-                    ->runtimeRegularExpressions[id].as<RegExp>());
+                    ->regularExpressionAt(id));
     return ro->asReturnedValue();
 }
 
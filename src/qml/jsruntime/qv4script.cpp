@@ -45,6 +45,7 @@
 #include "qv4debugging_p.h"
 #include "qv4profiling_p.h"
 #include "qv4scopedvalue_p.h"
+#include "qv4tiering_p.h"
 
 #include <private/qqmljsengine_p.h>
 #include <private/qqmljslexer_p.h>
@@ -132,11 +133,25 @@ void Script::parse()
             return;
 
         QV4::Compiler::JSUnitGenerator jsGenerator(&module);
-        QScopedPointer<EvalInstructionSelection> isel(v4->iselFactory->create(QQmlEnginePrivate::get(v4), v4->executableAllocator, &module, &jsGenerator));
+        EvalISelFactory *iselFactory = v4->tiering ? v4->tiering->interpreterFactory() : v4->iselFactory.data();
+        QScopedPointer<EvalInstructionSelection> isel(iselFactory->create(QQmlEnginePrivate::get(v4), v4->executableAllocator, &module, &jsGenerator));
         if (inheritContext)
             isel->setUseFastLookups(false);
+        isel->setCollectTypeFeedback(v4->tiering != nullptr);
         compilationUnit = isel->compile();
         vmFunction = compilationUnit->linkToEngine(v4);
+
+        if (v4->tiering) {
+            TieringSource *source = new TieringSource;
+            source->sourceCode = sourceCode;
+            source->fileName = sourceFile;
+            source->line = line;
+            source->strictMode = strictMode;
+            source->parseAsBinding = parseAsBinding;
+            source->useFastLookups = !inheritContext;
+            source->inheritedLocals = inheritedLocals;
+            v4->tiering->registerUnit(compilationUnit.data(), source);
+        }
     }
 
     if (!vmFunction) {
@@ -240,7 +255,7 @@ QQmlRefPointer<QV4::CompiledData::CompilationUnit> Script::precompile(IR::Module
     }
 
     QScopedPointer<EvalInstructionSelection> isel(engine->iselFactory->create(QQmlEnginePrivate::get(engine), engine->executableAllocator, module, unitGenerator));
-    isel->setUseFastLookups(false);
+    isel->setUseGlobalLookups(false);
     return isel->compile(/*generate unit data*/false);
 }
 
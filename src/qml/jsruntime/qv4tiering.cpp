@@ -0,0 +1,225 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qv4tiering_p.h"
+#include "qv4engine_p.h"
+#include "qv4function_p.h"
+#include "qv4context_p.h"
+#include "qv4string_p.h"
+#include <private/qqmljsengine_p.h>
+#include <private/qqmljslexer_p.h>
+#include <private/qqmljsparser_p.h>
+#include <private/qqmljsast_p.h>
+#include <private/qqmlengine_p.h>
+#include <qv4jsir_p.h>
+#include <qv4codegen_p.h>
+#include <qv4isel_p.h>
+
+#include <QtCore/QDebug>
+
+QT_BEGIN_NAMESPACE
+
+using namespace QV4;
+
+static uint threshold(const char *variable, uint defaultValue)
+{
+    bool ok = false;
+    const int value = qEnvironmentVariableIntValue(variable, &ok);
+    return (ok && value > 0) ? uint(value) : defaultValue;
+}
+
+static bool showStatistics()
+{
+    static const bool show = qEnvironmentVariableIsSet("QV4_JIT_TIERING_STATS");
+    return show;
+}
+
+// Installed as the code of a promoted function. The call context was set up for the
+// interpreted unit, so point it at the tables of the unit the JIT compiled before entering
+// the compiled code.
+static ReturnedValue callPromotedFunction(ExecutionEngine *engine, const uchar *codeData)
+{
+    const Function *compiled = reinterpret_cast<const Function *>(codeData);
+    Heap::ExecutionContext *ctx = engine->current;
+    ctx->compilationUnit = compiled->compilationUnit;
+    ctx->lookups = compiled->compilationUnit->runtimeLookups;
+    ctx->constantTable = compiled->compilationUnit->constants;
+    return compiled->code(engine, compiled->codeData);
+}
+
+static QQmlRefPointer<CompiledData::CompilationUnit> compileWithJit(ExecutionEngine *engine, CompiledData::CompilationUnit *interpretedUnit, const TieringSource &source)
+{
+    using namespace QQmlJS;
+
+    QQmlRefPointer<CompiledData::CompilationUnit> unit;
+
+    IR::Module module(/*debugMode*/false);
+    QQmlJS::Engine ee;
+    Lexer lexer(&ee);
+    lexer.setCode(source.sourceCode, source.line, source.parseAsBinding);
+    Parser parser(&ee);
+
+    RuntimeCodegen cg(engine, source.strictMode);
+    if (source.kind == TieringSource::FunctionExpression) {
+        if (!parser.parseExpression())
+            return unit;
+        AST::FunctionExpression *fe = AST::cast<AST::FunctionExpression *>(parser.rootNode());
+        if (!fe)
+            return unit;
+        cg.generateFromFunctionExpression(source.fileName, source.sourceCode, fe, &module);
+    } else {
+        if (!parser.parseProgram())
+            return unit;
+        AST::Program *program = AST::cast<AST::Program *>(parser.rootNode());
+        if (!program)
+            return unit;
+        cg.generateFromProgram(source.fileName, source.sourceCode, program, &module,
+                               QQmlJS::Codegen::EvalCode, source.inheritedLocals);
+    }
+
+    // The source compiled fine the first time round, so this is not expected to happen. Don't
+    // let the error escape into the code that happened to trigger the promotion.
+    if (engine->hasException) {
+        engine->catchException();
+        return unit;
+    }
+
+    // Whatever the interpreter has seen so far. Functions of the unit that are not hot yet
+    // may not have much to tell.
+    QVector<QVector<quint8> > typeFeedback;
+    typeFeedback.reserve(interpretedUnit->runtimeFunctions.size());
+    for (const Function *function : qAsConst(interpretedUnit->runtimeFunctions))
+        typeFeedback.append(function->typeFeedback);
+
+    Compiler::JSUnitGenerator jsGenerator(&module);
+    QScopedPointer<EvalInstructionSelection> isel(engine->iselFactory->create(QQmlEnginePrivate::get(engine), engine->executableAllocator, &module, &jsGenerator));
+    isel->setUseFastLookups(source.useFastLookups);
+    isel->setTypeFeedback(&typeFeedback);
+    unit = isel->compile();
+    unit->linkToEngine(engine);
+    return unit;
+}
+
+Tiering::Tiering(EvalISelFactory *interpreterFactory)
+    : callThreshold(threshold("QV4_JIT_CALL_THRESHOLD", DefaultCallThreshold))
+    , backEdgeThreshold(threshold("QV4_JIT_LOOP_THRESHOLD", DefaultBackEdgeThreshold))
+    , m_interpreterFactory(interpreterFactory)
+{
+}
+
+Tiering::~Tiering()
+{
+    if (showStatistics())
+        qDebug() << "Tiering: promoted" << promotedFunctions << "function(s) from"
+                 << compiledUnits << "unit(s) to the JIT";
+}
+
+bool Tiering::isEnabled()
+{
+    static const bool enabled = !qEnvironmentVariableIsEmpty("QV4_JIT_TIERING");
+    return enabled;
+}
+
+void Tiering::registerUnit(CompiledData::CompilationUnit *unit, TieringSource *source)
+{
+    Q_ASSERT(!unit->tieringSource);
+    unit->tieringSource.reset(source);
+    for (Function *function : qAsConst(unit->runtimeFunctions))
+        function->tier = Function::InterpreterTier;
+}
+
+void Tiering::tierUp(ExecutionEngine *engine, Function *function)
+{
+    // A recursive call may have promoted the function already.
+    if (function->tier != Function::InterpreterTier)
+        return;
+
+    CompiledData::CompilationUnit *unit = function->compilationUnit;
+    TieringSource *source = unit->tieringSource.data();
+    Q_ASSERT(source);
+
+    // Breakpoints and stepping are implemented in the interpreter.
+    if (engine->debugger()) {
+        function->tier = Function::NotTiered;
+        return;
+    }
+
+    if (!source->compiledUnit && !source->compileFailed) {
+        source->compiledUnit = compileWithJit(engine, unit, *source);
+        source->compileFailed = !source->compiledUnit;
+        if (!source->compileFailed)
+            ++compiledUnits;
+    }
+
+    // Both compilations see the same source, so the functions line up by index. Check anyway
+    // before handing out code that expects a different layout.
+    const int index = unit->runtimeFunctions.indexOf(function);
+    Function *compiled = nullptr;
+    if (source->compiledUnit && source->compiledUnit->runtimeFunctions.size() == unit->runtimeFunctions.size()) {
+        compiled = source->compiledUnit->runtimeFunctions.at(index);
+        const CompiledData::Function *expected = function->compiledFunction;
+        const CompiledData::Function *actual = compiled->compiledFunction;
+        if (actual->location.line != expected->location.line
+                || actual->location.column != expected->location.column
+                || actual->nFormals != expected->nFormals
+                || actual->nLocals != expected->nLocals
+                || actual->nInnerFunctions != expected->nInnerFunctions) {
+            compiled = nullptr;
+        }
+    }
+
+    if (!compiled) {
+        function->tier = Function::NotTiered;
+        return;
+    }
+
+    function->code = &callPromotedFunction;
+    function->codeData = reinterpret_cast<const uchar *>(compiled);
+    function->tier = Function::JitTier;
+    ++promotedFunctions;
+
+    if (showStatistics()) {
+        qDebug() << "Tiering: promoted" << function->name()->toQString() << "at"
+                 << function->sourceFile() << function->compiledFunction->location.line
+                 << "after" << function->invocationCount << "call(s) and"
+                 << function->backEdgeCount << "loop iteration(s)";
+    }
+}
+
+QT_END_NAMESPACE
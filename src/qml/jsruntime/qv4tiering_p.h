@@ -0,0 +1,176 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QV4TIERING_P_H
+#define QV4TIERING_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qv4global_p.h"
+#include "qv4function_p.h"
+#include <private/qv4compileddata_p.h>
+#include <QString>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+
+class QQmlEnginePrivate;
+
+namespace QV4 {
+
+class EvalISelFactory;
+
+// What is needed to compile a unit that started out in the interpreter once more, this time
+// with the JIT. Attached to the interpreted unit.
+struct TieringSource
+{
+    enum Kind {
+        Program,
+        FunctionExpression
+    };
+
+    Kind kind = Program;
+    QString sourceCode;
+    QString fileName;
+    int line = 1;
+    bool strictMode = false;
+    bool parseAsBinding = false;
+    bool useFastLookups = true;
+    QStringList inheritedLocals;
+
+    // The unit compiled by the JIT, created when the first function of the unit gets hot.
+    QQmlRefPointer<CompiledData::CompilationUnit> compiledUnit;
+    bool compileFailed = false;
+};
+
+// Tiered execution of code that is compiled at run-time.
+//
+// When QV4_JIT_TIERING is set, code compiled at run-time by QJSEngine::evaluate(), eval(),
+// the Function constructor and Qt.include() starts out in the interpreter instead of being
+// handed to the JIT right away. The interpreter counts the calls and the backward jumps of
+// every such function. When one of the counts reaches its threshold, tierUp() compiles the
+// function's unit with the JIT and redirects the function to the compiled code, which is
+// used from the next call on. QML documents and JavaScript imports are compiled ahead of
+// time and are not affected.
+//
+// The thresholds are read from QV4_JIT_CALL_THRESHOLD and QV4_JIT_LOOP_THRESHOLD.
+// QV4_JIT_TIERING_STATS prints every promotion.
+class Q_QML_PRIVATE_EXPORT Tiering
+{
+    Q_DISABLE_COPY(Tiering)
+public:
+    enum {
+        DefaultCallThreshold = 50,
+        DefaultBackEdgeThreshold = 2000
+    };
+
+    explicit Tiering(EvalISelFactory *interpreterFactory);
+    ~Tiering();
+
+    static bool isEnabled();
+
+    EvalISelFactory *interpreterFactory() const { return m_interpreterFactory.data(); }
+
+    void registerUnit(CompiledData::CompilationUnit *unit, TieringSource *source);
+
+    bool countCall(Function *function)
+    { return ++function->invocationCount == callThreshold; }
+    bool countBackEdge(Function *function)
+    { return ++function->backEdgeCount == backEdgeThreshold; }
+
+    // Type feedback: the interpreter records the kinds of values it sees as operands of
+    // additions, divisions and relational comparisons. The JIT uses that to emit inline fast
+    // paths for the kinds that actually occurred, guarded by type checks that fall back to the
+    // generic run-time call.
+    enum ObservedType {
+        ObservedInteger = 0x1,
+        ObservedDouble  = 0x2,
+        ObservedString  = 0x4,
+        ObservedObject  = 0x8,
+        ObservedOther   = 0x10,
+
+        ObservedNumber = ObservedInteger | ObservedDouble
+    };
+
+    static quint8 observedType(const Value &v)
+    {
+        if (v.isInteger())
+            return ObservedInteger;
+        if (v.isDouble())
+            return ObservedDouble;
+        if (v.isString())
+            return ObservedString;
+        if (v.isObject())
+            return ObservedObject;
+        return ObservedOther;
+    }
+
+    static void recordTypes(Function *function, uint statement, const Value &lhs, const Value &rhs)
+    {
+        if (Q_UNLIKELY(statement >= uint(function->typeFeedback.size())))
+            function->typeFeedback.resize(statement + 1);
+        function->typeFeedback[statement] |= observedType(lhs) | observedType(rhs);
+    }
+
+    void tierUp(ExecutionEngine *engine, Function *function);
+
+    const uint callThreshold;
+    const uint backEdgeThreshold;
+
+    uint promotedFunctions = 0;
+    uint compiledUnits = 0;
+
+private:
+    QScopedPointer<EvalISelFactory> m_interpreterFactory;
+};
+
+} // namespace QV4
+
+QT_END_NAMESPACE
+
+#endif // QV4TIERING_P_H
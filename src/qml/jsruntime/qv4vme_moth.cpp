@@ -53,6 +53,7 @@
 #include <private/qv4regexp_p.h>
 #include <private/qv4regexpobject_p.h>
 #include <private/qv4string_p.h>
+#include <private/qv4tiering_p.h>
 #include <iostream>
 
 #include "qv4alloca_p.h"
@@ -358,6 +359,12 @@ Param traceParam(const Param &param)
     if (engine->hasException) \
         goto catchException
 
+#define COUNT_BACK_EDGE(offset) \
+    if (Q_UNLIKELY(tieringFunction) && offset < 0 && engine->tiering->countBackEdge(tieringFunction)) { \
+        engine->tiering->tierUp(engine, tieringFunction); \
+        tieringFunction = 0; \
+    }
+
 QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code)
 {
 #ifdef DO_TRACE_INSTR
@@ -382,6 +389,19 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code)
     QV4::Scope scope(engine);
     engine->current->lineNumber = -1;
 
+    // Functions that start out in the interpreter count their calls and loop iterations. A
+    // promotion to the JIT takes effect with the next call.
+    QV4::Function *tieringFunction = 0;
+    if (engine->current->type >= QV4::Heap::ExecutionContext::Type_SimpleCallContext) {
+        QV4::Function *function = static_cast<QV4::Heap::CallContext *>(engine->current)->v4Function;
+        if (function && function->tier == QV4::Function::InterpreterTier && function->codeData == code) {
+            if (engine->tiering->countCall(function))
+                engine->tiering->tierUp(engine, function);
+            else
+                tieringFunction = function;
+        }
+    }
+
 #ifdef DO_TRACE_INSTR
     qDebug("Starting VME with context=%p and code=%p", context, code);
 #endif // DO_TRACE_INSTR
@@ -447,7 +467,7 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code)
 //        TRACE(value, "%s", instr.value.toString(context)->toQString().toUtf8().constData());
         Heap::RegExpObject *ro = engine->newRegExpObject(
                 static_cast<CompiledData::CompilationUnit*>(engine->current->compilationUnit)
-                        ->runtimeRegularExpressions[instr.regExpId].as<RegExp>());
+                        ->regularExpressionAt(instr.regExpId));
         VALUE(instr.result) = ro;
     MOTH_END_INSTR(LoadRegExp)
 
@@ -782,21 +802,26 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code)
     MOTH_END_INSTR(ConstructGlobalLookup)
 
     MOTH_BEGIN_INSTR(Jump)
+        COUNT_BACK_EDGE(instr.offset);
         code = ((const uchar *)&instr.offset) + instr.offset;
     MOTH_END_INSTR(Jump)
 
     MOTH_BEGIN_INSTR(JumpEq)
         bool cond = VALUEPTR(instr.condition)->toBoolean();
         TRACE(condition, "%s", cond ? "TRUE" : "FALSE");
-        if (cond)
+        if (cond) {
+            COUNT_BACK_EDGE(instr.offset);
             code = ((const uchar *)&instr.offset) + instr.offset;
+        }
     MOTH_END_INSTR(JumpEq)
 
     MOTH_BEGIN_INSTR(JumpNe)
         bool cond = VALUEPTR(instr.condition)->toBoolean();
         TRACE(condition, "%s", cond ? "TRUE" : "FALSE");
-        if (!cond)
+        if (!cond) {
+            COUNT_BACK_EDGE(instr.offset);
             code = ((const uchar *)&instr.offset) + instr.offset;
+        }
     MOTH_END_INSTR(JumpNe)
 
     MOTH_BEGIN_INSTR(UNot)
@@ -897,6 +922,11 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code)
         STOREVALUE(instr.result, op(engine, VALUE(instr.lhs), VALUE(instr.rhs)));
     MOTH_END_INSTR(BinopContext)
 
+    MOTH_BEGIN_INSTR(RecordTypes)
+        if (tieringFunction)
+            QV4::Tiering::recordTypes(tieringFunction, instr.statement, VALUE(instr.lhs), VALUE(instr.rhs));
+    MOTH_END_INSTR(RecordTypes)
+
     MOTH_BEGIN_INSTR(Ret)
 //        TRACE(Ret, "returning value %s", result.toString(context)->toQString().toUtf8().constData());
         return VALUE(instr.result).asReturnedValue();
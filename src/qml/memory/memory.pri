@@ -4,10 +4,12 @@ INCLUDEPATH += $$OUT_PWD
 !qmldevtools_build {
 SOURCES += \
     $$PWD/qv4mm.cpp \
+    $$PWD/qv4heapsnapshot.cpp
 
 HEADERS += \
     $$PWD/qv4mm_p.h \
-    $$PWD/qv4mmdefs_p.h
+    $$PWD/qv4mmdefs_p.h \
+    $$PWD/qv4heapsnapshot_p.h
 }
 
 HEADERS += \
@@ -0,0 +1,346 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qv4heapsnapshot_p.h"
+#include "qv4mm_p.h"
+#include "qv4engine_p.h"
+#include "qv4functionobject_p.h"
+#include "qv4qobjectwrapper_p.h"
+#include "qv4string_p.h"
+
+#include <QIODevice>
+
+QT_BEGIN_NAMESPACE
+
+namespace QV4 {
+
+enum {
+    NodeFieldCount = 6,
+    // Long strings only get their start as name, like in V8's snapshots
+    MaxStringNameLength = 1024
+};
+
+HeapSnapshot::HeapSnapshot(MemoryManager *mm)
+    : mm(mm)
+{
+    for (const auto &h : mm->hugeItemAllocator.chunks)
+        hugeItemSizes.insert(h.chunk, h.size);
+
+    static const char *rootNames[NumRootTypes] = {
+        "(Engine roots)",
+        "(JS stack)",
+        "(Persistent values)",
+        "(QObject wrappers)"
+    };
+    addSyntheticNode(QString(), 1);
+    firstRootNode = uint(nodes.size());
+    for (int i = 0; i < NumRootTypes; ++i) {
+        const uint root = addSyntheticNode(QString::fromLatin1(rootNames[i]), 3 + 2*i);
+        edges.push_back(Edge{ElementEdge, uint(i), root});
+    }
+    nodes[0].edgeCount = NumRootTypes;
+    contextEdgeName = string(QStringLiteral("context"));
+}
+
+HeapSnapshot::~HeapSnapshot()
+{
+    for (uint *table : qAsConst(nodeIndexTables))
+        delete [] table;
+}
+
+void HeapSnapshot::beginRoots(RootType type)
+{
+    // Edges have to be recorded in the order of their nodes.
+    Q_ASSERT(firstRootNode + type >= currentNode);
+    currentNode = firstRootNode + type;
+}
+
+void HeapSnapshot::addEdge(Heap::Base *to)
+{
+    const uint index = addNode(to);
+    Node &from = nodes[currentNode];
+    if (to->vtable()->isExecutionContext)
+        edges.push_back(Edge{ContextEdge, contextEdgeName, index});
+    else
+        edges.push_back(Edge{ElementEdge, from.edgeCount, index});
+    ++from.edgeCount;
+}
+
+void HeapSnapshot::traverse()
+{
+    ExecutionEngine *engine = mm->engine;
+    // Newly reached objects get appended, so this is a breadth first search.
+    for (uint i = firstRootNode + NumRootTypes; i < nodes.size(); ++i) {
+        currentNode = i;
+        Heap::Base *h = nodes[i].object;
+        Q_ASSERT(h->vtable()->markObjects);
+        h->vtable()->markObjects(h, engine);
+    }
+}
+
+uint *HeapSnapshot::nodeIndexes(Chunk *c)
+{
+    uint *&table = nodeIndexTables[c];
+    if (!table)
+        table = new uint[Chunk::NumSlots]();
+    lastChunk = c;
+    lastTable = table;
+    return table;
+}
+
+uint HeapSnapshot::addNode(Heap::Base *object)
+{
+    HeapItem *item = reinterpret_cast<HeapItem *>(object);
+    Chunk *c = item->chunk();
+    uint *table = c == lastChunk ? lastTable : nodeIndexes(c);
+    uint &index = table[item - c->realBase()];
+    if (index)
+        return index - 1;
+
+    Node node;
+    node.object = object;
+    // stable across snapshots, as objects don't move
+    node.id = (quintptr(object) >> 4) + 1;
+    node.edgeCount = 0;
+    describe(node);
+    nodes.push_back(node);
+    index = uint(nodes.size());
+    return index - 1;
+}
+
+uint HeapSnapshot::addSyntheticNode(const QString &name, quint64 id)
+{
+    Node node;
+    node.object = nullptr;
+    node.id = id;
+    node.selfSize = 0;
+    node.type = SyntheticNode;
+    node.name = string(name);
+    node.edgeCount = 0;
+    nodes.push_back(node);
+    return uint(nodes.size() - 1);
+}
+
+void HeapSnapshot::describe(Node &node)
+{
+    Heap::Base *h = node.object;
+    const VTable *vtable = h->vtable();
+    HeapItem *item = reinterpret_cast<HeapItem *>(h);
+    Chunk *c = item->chunk();
+
+    node.selfSize = 0;
+    if (item == c->first())
+        node.selfSize = hugeItemSizes.value(c);
+    if (!node.selfSize)
+        node.selfSize = item->size();
+
+    if (vtable->isString) {
+        Heap::String *s = static_cast<Heap::String *>(h);
+        node.selfSize += s->retainedTextSize();
+        if (s->largestSubLength) {
+            node.type = ConcatenatedStringNode;
+            node.name = string(QStringLiteral("(concatenated string)"));
+        } else {
+            node.type = StringNode;
+            node.name = string(s->toQString().left(MaxStringNameLength));
+        }
+        return;
+    }
+
+    node.type = vtable->isObject ? ObjectNode : HiddenNode;
+    QString name = QString::fromLatin1(vtable->className);
+    if (vtable->isFunctionObject) {
+        node.type = ClosureNode;
+        Heap::FunctionObject *f = static_cast<Heap::FunctionObject *>(h);
+        if (f->function)
+            name = f->function->name()->toQString();
+    } else if (vtable->type == Managed::Type_ArrayObject) {
+        node.type = ArrayNode;
+    } else if (vtable->type == Managed::Type_RegExpObject) {
+        node.type = RegExpNode;
+    } else if (vtable == QObjectWrapper::staticVTable()) {
+        // Name it after the QObject, that's what one looks for when chasing leaks
+        if (QObject *object = static_cast<Heap::QObjectWrapper *>(h)->object()) {
+            name = QString::fromUtf8(object->metaObject()->className());
+            if (!object->objectName().isEmpty())
+                name += QLatin1String(" (") + object->objectName() + QLatin1Char(')');
+        }
+    }
+    node.name = string(name);
+}
+
+uint HeapSnapshot::string(const QString &s)
+{
+    auto it = stringIndexes.constFind(s);
+    if (it != stringIndexes.constEnd())
+        return *it;
+    const uint index = uint(strings.size());
+    strings.append(s);
+    stringIndexes.insert(s, index);
+    return index;
+}
+
+namespace {
+
+// Writes the snapshot in big blocks. The snapshots of large heaps are hundreds of megabytes.
+class SnapshotWriter
+{
+public:
+    enum { BufferSize = 256*1024 };
+
+    SnapshotWriter(QIODevice *device) : device(device) { buffer.reserve(BufferSize + 64); }
+    ~SnapshotWriter() { flush(); }
+
+    SnapshotWriter &operator<<(const char *s)
+    {
+        buffer.append(s);
+        return checkFlush();
+    }
+
+    SnapshotWriter &operator<<(quint64 n)
+    {
+        char digits[20];
+        char *end = digits + sizeof(digits);
+        char *p = end;
+        do {
+            *--p = char('0' + n % 10);
+            n /= 10;
+        } while (n);
+        buffer.append(p, int(end - p));
+        return checkFlush();
+    }
+
+    void writeString(const QString &s)
+    {
+        static const char hexDigits[] = "0123456789abcdef";
+        const QByteArray utf8 = s.toUtf8();
+        buffer.append('"');
+        for (char ch : utf8) {
+            const uchar c = uchar(ch);
+            if (c == '"' || c == '\\') {
+                buffer.append('\\');
+                buffer.append(ch);
+            } else if (c < 0x20) {
+                const char escaped[] = { '\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0xf] };
+                buffer.append(escaped, int(sizeof(escaped)));
+            } else {
+                buffer.append(ch);
+            }
+        }
+        buffer.append('"');
+        checkFlush();
+    }
+
+    bool flush()
+    {
+        if (ok && !buffer.isEmpty())
+            ok = device->write(buffer) == buffer.size();
+        buffer.resize(0);
+        return ok;
+    }
+
+private:
+    SnapshotWriter &checkFlush()
+    {
+        if (buffer.size() >= BufferSize)
+            flush();
+        return *this;
+    }
+
+    QIODevice *device;
+    QByteArray buffer;
+    bool ok = true;
+};
+
+} // anonymous namespace
+
+bool HeapSnapshot::write(QIODevice *device) const
+{
+    SnapshotWriter out(device);
+    out << "{\"snapshot\":{\"meta\":{"
+           "\"node_fields\":[\"type\",\"name\",\"id\",\"self_size\",\"edge_count\",\"trace_node_id\"],"
+           "\"node_types\":[[\"hidden\",\"array\",\"string\",\"object\",\"code\",\"closure\","
+           "\"regexp\",\"number\",\"native\",\"synthetic\",\"concatenated string\","
+           "\"sliced string\"],\"string\",\"number\",\"number\",\"number\",\"number\"],"
+           "\"edge_fields\":[\"type\",\"name_or_index\",\"to_node\"],"
+           "\"edge_types\":[[\"context\",\"element\",\"property\",\"internal\",\"hidden\","
+           "\"shortcut\",\"weak\"],\"string_or_number\",\"node\"],"
+           "\"trace_function_info_fields\":[],\"trace_node_fields\":[],"
+           "\"sample_fields\":[],\"location_fields\":[]},"
+        << "\"node_count\":" << quint64(nodes.size())
+        << ",\"edge_count\":" << quint64(edges.size())
+        << ",\"trace_function_count\":0},\n\"nodes\":[";
+
+    bool first = true;
+    for (const Node &node : nodes) {
+        out << (first ? "" : ",\n") << quint64(node.type) << "," << quint64(node.name) << ","
+            << node.id << "," << node.selfSize << "," << quint64(node.edgeCount) << ",0";
+        first = false;
+    }
+
+    out << "],\n\"edges\":[";
+    first = true;
+    for (const Edge &edge : edges) {
+        out << (first ? "" : ",\n") << quint64(edge.type) << "," << quint64(edge.nameOrIndex)
+            << "," << quint64(edge.to) * NodeFieldCount;
+        first = false;
+    }
+
+    out << "],\n\"trace_function_infos\":[],\"trace_tree\":[],\"samples\":[],\"locations\":[],"
+           "\n\"strings\":[";
+    first = true;
+    for (const QString &s : strings) {
+        out << (first ? "" : ",\n");
+        out.writeString(s);
+        first = false;
+    }
+    out << "]}\n";
+    return out.flush();
+}
+
+namespace HeapSnapshotting {
+void addEdge(HeapSnapshot *snapshot, Heap::Base *to)
+{
+    snapshot->addEdge(to);
+}
+}
+
+} // namespace QV4
+
+QT_END_NAMESPACE
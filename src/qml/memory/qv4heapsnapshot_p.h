@@ -0,0 +1,165 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QV4HEAPSNAPSHOT_P_H
+#define QV4HEAPSNAPSHOT_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <private/qv4global_p.h>
+#include <private/qv4mmdefs_p.h>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+class QIODevice;
+
+namespace QV4 {
+
+class MemoryManager;
+
+// Records the object graph in the format of Chrome's .heapsnapshot files.
+//
+// While a snapshot is taken, Heap::Base::mark() reports every reference to the snapshot
+// instead of marking the object. The snapshot scans each object it reaches once by calling
+// its markObjects(). It doesn't touch the mark bits, so it can be taken at any time outside
+// of a collection.
+class HeapSnapshot
+{
+    Q_DISABLE_COPY(HeapSnapshot)
+public:
+    enum RootType {
+        EngineRoots,
+        JSStackRoots,
+        PersistentRoots,
+        QObjectRoots,
+        NumRootTypes
+    };
+
+    HeapSnapshot(MemoryManager *mm);
+    ~HeapSnapshot();
+
+    void beginRoots(RootType type);
+    void addEdge(Heap::Base *to);
+    void traverse();
+    bool write(QIODevice *device) const;
+
+private:
+    // Node and edge types as listed in the meta data of the snapshot
+    enum NodeType {
+        HiddenNode,
+        ArrayNode,
+        StringNode,
+        ObjectNode,
+        CodeNode,
+        ClosureNode,
+        RegExpNode,
+        NumberNode,
+        NativeNode,
+        SyntheticNode,
+        ConcatenatedStringNode
+    };
+
+    enum EdgeType {
+        ContextEdge,
+        ElementEdge,
+        PropertyEdge,
+        InternalEdge
+    };
+
+    struct Node {
+        Heap::Base *object;
+        quint64 id;
+        quint64 selfSize;
+        uint type;
+        uint name;
+        uint edgeCount;
+    };
+
+    struct Edge {
+        uint type;
+        uint nameOrIndex;
+        uint to;
+    };
+
+    uint addNode(Heap::Base *object);
+    uint addSyntheticNode(const QString &name, quint64 id);
+    void describe(Node &node);
+    uint string(const QString &s);
+    uint *nodeIndexes(Chunk *c);
+
+    MemoryManager *mm;
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    uint currentNode = 0;
+    uint firstRootNode = 0;
+    uint contextEdgeName = 0;
+
+    // maps every slot of a chunk to the index of its node plus one
+    QHash<Chunk *, uint *> nodeIndexTables;
+    Chunk *lastChunk = nullptr;
+    uint *lastTable = nullptr;
+    QHash<Chunk *, size_t> hugeItemSizes;
+
+    QHash<QString, uint> stringIndexes;
+    QVector<QString> strings;
+};
+
+namespace HeapSnapshotting {
+Q_QML_PRIVATE_EXPORT void addEdge(HeapSnapshot *snapshot, Heap::Base *to);
+}
+
+} // namespace QV4
+
+QT_END_NAMESPACE
+
+#endif // QV4HEAPSNAPSHOT_P_H
@@ -42,9 +42,19 @@
 #include "qv4objectproto_p.h"
 #include "qv4mm_p.h"
 #include "qv4qobjectwrapper_p.h"
+#include "qv4argumentsobject_p.h"
+#include "qv4dataview_p.h"
+#include "qv4errorobject_p.h"
+#include "qv4objectiterator_p.h"
+#include "qv4regexpobject_p.h"
+#include "qv4stringobject_p.h"
+#include "qv4typedarray_p.h"
+#include "qv4function_p.h"
+#include "qv4heapsnapshot_p.h"
 #include <QtCore/qalgorithms.h>
 #include <QtCore/private/qnumeric_p.h>
 #include <qqmlengine.h>
+#include <private/qjsengine_p.h>
 #include "PageReservation.h"
 #include "PageAllocation.h"
 #include "PageAllocationAligned.h"
@@ -52,13 +62,22 @@
 
 #include <QElapsedTimer>
 #include <QMap>
+#include <QMetaMethod>
+#include <QMutex>
+#include <QRunnable>
 #include <QScopedValueRollback>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 #include <iostream>
 #include <cstdlib>
 #include <algorithm>
 #include "qv4alloca_p.h"
 #include "qv4profiling_p.h"
+#if QT_CONFIG(animation)
+#include <private/qabstractanimationjob_p.h>
+#endif
 
 #define MM_DEBUG 0
 
@@ -85,7 +104,12 @@
 #include <pthread_np.h>
 #endif
 
+#if OS(LINUX)
+#include <private/qcore_unix_p.h>
+#endif
+
 #define MIN_UNMANAGED_HEAPSIZE_GC_LIMIT std::size_t(128 * 1024)
+#define DEFAULT_RETAINED_MEMORY_LIMIT std::size_t(2 * 1024 * 1024)
 
 using namespace WTF;
 
@@ -95,9 +119,25 @@ namespace QV4 {
 
 enum {
     MinSlotsGCLimit = QV4::Chunk::AvailableSlots*16,
-    GCOverallocation = 200 /* Max overallocation by the GC in % */
+    GCOverallocation = 200, /* Max overallocation by the GC in % */
+    RetainedChunksRatio = 4, /* Keep at most 1/n of the chunks in use as free chunks */
+    FragmentationLimit = 200, /* Allocated memory in % of the used memory, above which the heap gets defragmented */
+    SparseChunkOccupancy = 25, /* Max used slots in % of a chunk that gets drained when defragmenting */
+    OldGenerationGrowth = 200, /* Growth of the old generation in % that triggers a full GC */
+    MinHeapGrowth = 110, /* Lowest allowed heap growth factor in % */
+    OverLimitGrowth = 10, /* Allocations in % of the heap that trigger a GC once over the max heap size */
+    CheapGCPause = 1000000, /* A full GC taking less nanoseconds than this is run by collectIfCheap() */
+    DefaultGCNsecsPerSlot = 5, /* Cost estimate of a full GC before the first one was measured */
+    GrowableItemReservation = 16 /* Address space reserved for a growable huge item, in multiples of its size */
 };
 
+#if QT_POINTER_SIZE == 8
+// Address space is plentiful, so huge items that are going to grow get room to grow in place.
+static const size_t MaxGrowableItemReservation = size_t(4) << 30;
+#else
+static const size_t MaxGrowableItemReservation = 0;
+#endif
+
 struct MemorySegment {
     enum {
         NumChunks = 8*sizeof(quint64),
@@ -123,6 +163,16 @@ struct MemorySegment {
         qSwap(allocatedMap, other.allocatedMap);
         qSwap(availableBytes, other.availableBytes);
         qSwap(nChunks, other.nChunks);
+        qSwap(dedicated, other.dedicated);
+    }
+    MemorySegment &operator=(MemorySegment &&other) {
+        qSwap(pageReservation, other.pageReservation);
+        qSwap(base, other.base);
+        qSwap(allocatedMap, other.allocatedMap);
+        qSwap(availableBytes, other.availableBytes);
+        qSwap(nChunks, other.nChunks);
+        qSwap(dedicated, other.dedicated);
+        return *this;
     }
 
     ~MemorySegment() {
@@ -149,14 +199,21 @@ struct MemorySegment {
     }
 
     Chunk *allocate(size_t size);
+    Chunk *allocateDedicated(size_t size);
     void free(Chunk *chunk, size_t size) {
         DEBUG << "freeing chunk" << chunk;
-        size_t index = static_cast<size_t>(chunk - base);
-        size_t end = qMin(static_cast<size_t>(NumChunks), index + (size - 1)/Chunk::ChunkSize + 1);
-        while (index < end) {
-            Q_ASSERT(testBit(index));
-            clearBit(index);
-            ++index;
+        if (dedicated) {
+            Q_ASSERT(chunk == base);
+            allocatedMap = 0;
+            dedicated = false;
+        } else {
+            size_t index = static_cast<size_t>(chunk - base);
+            size_t end = qMin(static_cast<size_t>(NumChunks), index + (size - 1)/Chunk::ChunkSize + 1);
+            while (index < end) {
+                Q_ASSERT(testBit(index));
+                clearBit(index);
+                ++index;
+            }
         }
 
         size_t pageSize = WTF::pageSize();
@@ -180,13 +237,26 @@ struct MemorySegment {
     quint64 allocatedMap = 0;
     size_t availableBytes = 0;
     uint nChunks = 0;
+    // the whole reservation belongs to one huge item
+    bool dedicated = false;
 };
 
+// Commits the start of the segment for one huge item, which can later grow into the rest.
+Chunk *MemorySegment::allocateDedicated(size_t size)
+{
+    Q_ASSERT(!allocatedMap && availableBytes >= size);
+    pageReservation.commit(base, size);
+    allocatedMap = ~static_cast<quint64>(0);
+    dedicated = true;
+    return base;
+}
+
 Chunk *MemorySegment::allocate(size_t size)
 {
     if (!allocatedMap && size >= SegmentSize) {
         // chunk allocated for one huge allocation
-        Q_ASSERT(availableBytes >= size);
+        if (availableBytes < size)
+            return 0;
         pageReservation.commit(base, size);
         allocatedMap = ~static_cast<quintptr>(0);
         return base;
@@ -227,14 +297,37 @@ struct ChunkAllocator {
     }
 
     Chunk *allocate(size_t size = 0);
+    Chunk *allocateGrowable(size_t size, size_t reserve);
+    bool grow(Chunk *chunk, size_t oldSize, size_t newSize);
     void free(Chunk *chunk, size_t size = 0);
+    void releaseFreeChunks(size_t maxChunks);
+
+    size_t retainedMemory() const {
+        return freeChunks.size()*Chunk::ChunkSize;
+    }
 
     std::vector<MemorySegment> memorySegments;
+    // Chunks that got freed, but are still committed. They are reused before committing
+    // new memory, which avoids the page faults for memory that gets freed and reallocated
+    // all the time.
+    std::vector<Chunk *> freeChunks;
+    size_t maxFreeChunks = 0;
+
+private:
+    void decommit(Chunk *chunk, size_t size);
 };
 
 Chunk *ChunkAllocator::allocate(size_t size)
 {
     size = requiredChunkSize(size);
+    if (size == Chunk::ChunkSize && !freeChunks.empty()) {
+        Chunk *c = freeChunks.back();
+        freeChunks.pop_back();
+        // Only the bitmaps need to be cleared. All users of a chunk initialize the memory
+        // they allocate from it.
+        memset(c, 0, Chunk::HeaderSize);
+        return c;
+    }
     for (auto &m : memorySegments) {
         if (~m.allocatedMap) {
             Chunk *c = m.allocate(size);
@@ -250,9 +343,43 @@ Chunk *ChunkAllocator::allocate(size_t size)
     return c;
 }
 
+Chunk *ChunkAllocator::allocateGrowable(size_t size, size_t reserve)
+{
+    size = requiredChunkSize(size);
+    memorySegments.push_back(MemorySegment(qMax(size, reserve)));
+    return memorySegments.back().allocateDedicated(size);
+}
+
+// Grows a chunk allocated by allocateGrowable() in place, if its reservation is large enough.
+bool ChunkAllocator::grow(Chunk *chunk, size_t oldSize, size_t newSize)
+{
+    oldSize = requiredChunkSize(oldSize);
+    newSize = requiredChunkSize(newSize);
+    for (auto &m : memorySegments) {
+        if (!m.contains(chunk))
+            continue;
+        if (!m.dedicated || newSize > m.availableBytes)
+            return false;
+        if (newSize > oldSize)
+            m.pageReservation.commit(reinterpret_cast<char *>(chunk) + oldSize, newSize - oldSize);
+        return true;
+    }
+    Q_UNREACHABLE();
+    return false;
+}
+
 void ChunkAllocator::free(Chunk *chunk, size_t size)
 {
     size = requiredChunkSize(size);
+    if (size == Chunk::ChunkSize && freeChunks.size() < maxFreeChunks) {
+        freeChunks.push_back(chunk);
+        return;
+    }
+    decommit(chunk, size);
+}
+
+void ChunkAllocator::decommit(Chunk *chunk, size_t size)
+{
     for (auto &m : memorySegments) {
         if (m.contains(chunk)) {
             m.free(chunk, size);
@@ -262,6 +389,179 @@ void ChunkAllocator::free(Chunk *chunk, size_t size)
     Q_ASSERT(false);
 }
 
+/*
+ * Gives the free chunks beyond maxChunks back to the OS, and unmaps the memory segments that
+ * became completely empty.
+ *
+ * For some hysteresis, we go down to half of maxChunks, so that a heap oscillating around the
+ * limit doesn't decommit and commit the same memory over and over again.
+ */
+void ChunkAllocator::releaseFreeChunks(size_t maxChunks)
+{
+    if (freeChunks.size() <= maxChunks)
+        return;
+
+    // release the chunks at the highest addresses, so that whole segments are more likely
+    // to become empty
+    std::sort(freeChunks.begin(), freeChunks.end());
+    const size_t keep = maxChunks/2;
+    for (size_t i = keep; i < freeChunks.size(); ++i)
+        decommit(freeChunks.at(i), Chunk::ChunkSize);
+    freeChunks.resize(keep);
+
+    auto isEmpty = [] (const MemorySegment &m) { return !m.allocatedMap; };
+    memorySegments.erase(std::remove_if(memorySegments.begin(), memorySegments.end(), isEmpty),
+                         memorySegments.end());
+}
+
+static size_t residentMemory()
+{
+#if OS(LINUX)
+    int fd = qt_safe_open("/proc/self/statm", O_RDONLY);
+    if (fd == -1)
+        return 0;
+    char buffer[128];
+    const qint64 n = qt_safe_read(fd, buffer, sizeof(buffer) - 1);
+    qt_safe_close(fd);
+    if (n <= 0)
+        return 0;
+    buffer[n] = 0;
+    // the second field is the number of resident pages
+    char *end = nullptr;
+    strtoull(buffer, &end, 10);
+    return static_cast<size_t>(strtoull(end, nullptr, 10)) * WTF::pageSize();
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Write barrier for the generational mode.
+ *
+ * Instead of instrumenting every store into the heap (from C++, the interpreter and JIT
+ * generated code), we let the kernel track which pages get written to. On Linux, writing "4"
+ * to /proc/self/clear_refs clears the soft-dirty bit of all pages of the process, and bit 55
+ * of a page's entry in /proc/self/pagemap gets set again as soon as the page is written to.
+ * The dirty pages of the old generation form the remembered set of a minor collection.
+ *
+ * The soft-dirty bits are process wide. Resetting them also resets them for everyone else
+ * in the process who relies on them, for example checkpointing tools like CRIU doing
+ * incremental dumps. Therefore the bits are only ever touched if the QV4_MM_SOFT_DIRTY_PAGES
+ * environment variable is set. Without it, the generational and the incremental modes are
+ * not available.
+ *
+ * Every reset bumps a global epoch, so that a memory manager can detect that another engine
+ * cleared the bits behind its back, in which case it has to fall back to a full collection.
+ * Resets by anyone outside of this file go unnoticed, which is another reason to only use
+ * the bits when explicitly asked to.
+ */
+namespace SoftDirtyPages {
+
+static QBasicMutex mutex;
+static uint epoch = 0;
+
+#if OS(LINUX)
+enum {
+    SoftDirtyBit = 55
+};
+
+static int clearRefsFd = -1;
+static int pagemapFd = -1;
+
+static bool readEntries(quintptr start, size_t nPages, quint64 *entries)
+{
+    const size_t bytes = nPages*sizeof(quint64);
+    const off_t offset = static_cast<off_t>(start/WTF::pageSize()*sizeof(quint64));
+    ssize_t r;
+    EINTR_LOOP(r, ::pread(pagemapFd, entries, bytes, offset));
+    return r == static_cast<ssize_t>(bytes);
+}
+
+static inline bool isDirty(quint64 entry)
+{
+    return (entry >> SoftDirtyBit) & 1;
+}
+
+static void clearLocked()
+{
+    const char clearSoftDirty = '4';
+    ssize_t r;
+    EINTR_LOOP(r, ::write(clearRefsFd, &clearSoftDirty, 1));
+    Q_UNUSED(r);
+    ++epoch;
+}
+
+static bool probe()
+{
+    clearRefsFd = qt_safe_open("/proc/self/clear_refs", O_WRONLY);
+    pagemapFd = qt_safe_open("/proc/self/pagemap", O_RDONLY);
+    bool ok = clearRefsFd != -1 && pagemapFd != -1;
+    if (ok) {
+        // The files exist even if the kernel is built without CONFIG_MEM_SOFT_DIRTY, so
+        // verify that a write to a clean page actually gets tracked.
+        PageAllocation page = PageAllocation::allocate(WTF::pageSize(), OSAllocator::JSGCHeapPages);
+        volatile char *p = static_cast<char *>(page.base());
+        const quintptr address = reinterpret_cast<quintptr>(page.base());
+        quint64 entry = 0;
+        *p = 1;
+        clearLocked();
+        ok = readEntries(address, 1, &entry) && !isDirty(entry);
+        *p = 2;
+        ok = ok && readEntries(address, 1, &entry) && isDirty(entry);
+        page.deallocate();
+    }
+    if (!ok) {
+        if (clearRefsFd != -1)
+            qt_safe_close(clearRefsFd);
+        if (pagemapFd != -1)
+            qt_safe_close(pagemapFd);
+        clearRefsFd = pagemapFd = -1;
+    }
+    return ok;
+}
+
+static bool isSupported()
+{
+    QMutexLocker locker(&mutex);
+    static const bool supported = probe();
+    return supported;
+}
+
+// Caches the pagemap entries of an aligned window of the address space, so that we can
+// look up the chunks of a memory segment with a single read.
+struct Map {
+    enum {
+        WindowSize = 64*Chunk::ChunkSize
+    };
+
+    bool isDirty(quintptr address)
+    {
+        const quintptr start = address & ~static_cast<quintptr>(WindowSize - 1);
+        if (start != windowStart) {
+            windowStart = start;
+            valid = readEntries(start, entries.size(), entries.data());
+        }
+        error |= !valid;
+        return !valid || SoftDirtyPages::isDirty(entries.at((address - start)/WTF::pageSize()));
+    }
+
+    std::vector<quint64> entries = std::vector<quint64>(qMax<size_t>(WindowSize/WTF::pageSize(), 1));
+    quintptr windowStart = 1;
+    bool valid = false;
+    bool error = false;
+};
+#else
+static bool isSupported() { return false; }
+static void clearLocked() { ++epoch; }
+
+struct Map {
+    bool isDirty(quintptr) { return true; }
+    bool error = true;
+};
+#endif
+
+} // namespace SoftDirtyPages
+
 #ifdef DUMP_SWEEP
 QString binary(quintptr n) {
     QString s = QString::number(n, 2);
@@ -275,7 +575,7 @@ QString binary(quintptr) { return QString(); }
 #define SDUMP if (1) ; else qDebug
 #endif
 
-bool Chunk::sweep()
+bool Chunk::sweep(bool keepBlackBits, std::vector<Heap::Base *> *deferredDestroys)
 {
     bool hasUsedSlots = false;
     SDUMP() << "sweeping chunk" << this;
@@ -312,13 +612,18 @@ bool Chunk::sweep()
             HeapItem *itemToFree = o + index;
             Heap::Base *b = *itemToFree;
             if (b->vtable()->destroy) {
-                b->vtable()->destroy(b);
-                b->_checkIsDestroyed();
+                if (deferredDestroys && !b->vtable()->isString) {
+                    deferredDestroys->push_back(b);
+                } else {
+                    b->vtable()->destroy(b);
+                    b->_checkIsDestroyed();
+                }
             }
         }
         objectBitmap[i] = blackBitmap[i];
         hasUsedSlots |= (blackBitmap[i] != 0);
-        blackBitmap[i] = 0;
+        if (!keepBlackBits)
+            blackBitmap[i] = 0;
         extendsBitmap[i] = e;
         lastSlotFree = !((objectBitmap[i]|extendsBitmap[i]) >> (sizeof(quintptr)*8 - 1));
         SDUMP() << "        new extends =" << binary(e);
@@ -488,6 +793,7 @@ HeapItem *BlockAllocator::allocate(size_t size, bool forceAllocation) {
 
     HeapItem *m;
 
+retry:
     if (slotsRequired < NumBins - 1) {
         m = freeBins[slotsRequired];
         if (m) {
@@ -557,6 +863,13 @@ HeapItem *BlockAllocator::allocate(size_t size, bool forceAllocation) {
     }
 
     if (!m) {
+        if (!sparseChunks.empty()) {
+            sparseChunks.back()->sortIntoBins(freeBins, NumBins);
+            sparseChunks.pop_back();
+            goto retry;
+        }
+        if (sweeper && adoptSweptChunk())
+            goto retry;
         if (!forceAllocation)
             return 0;
         Chunk *newChunk = chunkAllocator->allocate();
@@ -574,21 +887,32 @@ done:
     return m;
 }
 
-void BlockAllocator::sweep()
+/*
+ * Defragmentation.
+ *
+ * Objects never move, so a chunk that is mostly empty can only be given back once its last
+ * survivor died. When the heap is fragmented, we therefore stop allocating from the sparse
+ * chunks: their free slots only go into the bins once all other chunks are full, the fullest
+ * sparse chunk first. Their remaining objects die over time, and the chunk gets freed.
+ */
+void BlockAllocator::sweep(bool keepBlackBits, bool defragment)
 {
     nextFree = 0;
     nFree = 0;
     memset(freeBins, 0, sizeof(freeBins));
+    sparseChunks.clear();
 
 //    qDebug() << "BlockAlloc: sweep";
     usedSlotsAfterLastSweep = 0;
 
-    auto isFree = [this] (Chunk *c) {
-        bool isUsed = c->sweep();
+    std::vector<uint> usedSlots;
+    usedSlots.reserve(chunks.size());
+    auto isFree = [this, keepBlackBits, &usedSlots] (Chunk *c) {
+        bool isUsed = c->sweep(keepBlackBits);
 
         if (isUsed) {
-            c->sortIntoBins(freeBins, NumBins);
-            usedSlotsAfterLastSweep += c->nUsedSlots();
+            usedSlots.push_back(c->nUsedSlots());
+            usedSlotsAfterLastSweep += usedSlots.back();
         } else {
             chunkAllocator->free(c);
         }
@@ -597,16 +921,243 @@ void BlockAllocator::sweep()
 
     auto newEnd = std::remove_if(chunks.begin(), chunks.end(), isFree);
     chunks.erase(newEnd, chunks.end());
+
+    defragment = defragment
+            && usedSlotsAfterLastSweep*FragmentationLimit < totalSlots()*100;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (defragment && usedSlots.at(i)*100 < size_t(Chunk::AvailableSlots)*SparseChunkOccupancy)
+            sparseChunks.push_back(chunks.at(i));
+        else
+            chunks.at(i)->sortIntoBins(freeBins, NumBins);
+    }
+    std::sort(sparseChunks.begin(), sparseChunks.end(), [] (Chunk *a, Chunk *b) {
+        return a->nUsedSlots() < b->nUsedSlots();
+    });
+}
+
+size_t BlockAllocator::freeSlotsInSparseChunks() const
+{
+    size_t nSlots = 0;
+    for (Chunk *c : sparseChunks)
+        nSlots += c->nFreeSlots();
+    return nSlots;
+}
+
+void BlockAllocator::resetBlackBits()
+{
+    for (auto c : chunks)
+        c->resetBlackBits();
 }
 
 void BlockAllocator::freeAll()
 {
+    finishSweeping();
+    delete sweeper;
+    sweeper = nullptr;
+
     for (auto c : chunks) {
         c->freeAll();
         chunkAllocator->free(c);
     }
 }
 
+struct SweptChunk {
+    Chunk *chunk;
+    std::vector<Heap::Base *> deferredDestroys;
+    size_t usedSlots;
+    bool isUsed;
+};
+
+/*
+ * Sweeps chunks of the block allocator on a background thread.
+ *
+ * Sweeping a chunk only touches its bitmaps and the dead objects in it. Live objects are not
+ * looked at, so the GUI thread can go on running JS while the chunks are being swept, as long
+ * as it doesn't allocate from them. Destroying a dead object is a different matter though, as
+ * most destroy() functions release data that is shared with the GUI thread without any
+ * locking. Only strings, whose data is reference counted atomically, are destroyed on the
+ * sweeper thread. All other dead objects are collected, and destroyed when the chunk is
+ * adopted by the allocator again.
+ */
+class ChunkSweeper : public QThread
+{
+public:
+    ~ChunkSweeper()
+    {
+        {
+            QMutexLocker locker(&mutex);
+            Q_ASSERT(pending.empty() && done.empty());
+            quit = true;
+            workAvailable.wakeOne();
+        }
+        wait();
+    }
+
+    void sweep(std::vector<Chunk *> &&chunks, bool keepBlackBits)
+    {
+        // Until a chunk is swept, its dead objects count as used.
+        size_t used = 0;
+        for (Chunk *c : chunks)
+            used += c->nUsedSlots();
+
+        QMutexLocker locker(&mutex);
+        Q_ASSERT(pending.empty());
+        nInFlight += chunks.size();
+        nUsedSlotsInFlight += used;
+        pending = std::move(chunks);
+        sweepKeepsBlackBits = keepBlackBits;
+        if (!isRunning())
+            start();
+        workAvailable.wakeOne();
+    }
+
+    // Returns a swept chunk, waiting for one if all remaining chunks are still being swept.
+    // Returns false if there are no chunks left.
+    bool take(SweptChunk *swept)
+    {
+        QMutexLocker locker(&mutex);
+        while (done.empty()) {
+            if (!nInFlight)
+                return false;
+            chunkSwept.wait(&mutex);
+        }
+        *swept = std::move(done.back());
+        done.pop_back();
+        --nInFlight;
+        nUsedSlotsInFlight -= swept->usedSlots;
+        return true;
+    }
+
+    void waitForAll()
+    {
+        QMutexLocker locker(&mutex);
+        while (done.size() < nInFlight)
+            chunkSwept.wait(&mutex);
+    }
+
+    size_t chunksInFlight()
+    {
+        QMutexLocker locker(&mutex);
+        return nInFlight;
+    }
+
+    // Doesn't wait for the sweep, the chunks that are not swept yet count with all their
+    // objects from before.
+    size_t usedSlotsInFlight()
+    {
+        QMutexLocker locker(&mutex);
+        return nUsedSlotsInFlight;
+    }
+
+protected:
+    void run() override
+    {
+        QMutexLocker locker(&mutex);
+        while (true) {
+            while (pending.empty() && !quit)
+                workAvailable.wait(&mutex);
+            if (quit)
+                return;
+
+            SweptChunk swept;
+            swept.chunk = pending.back();
+            pending.pop_back();
+            const bool keepBlackBits = sweepKeepsBlackBits;
+            const size_t usedBefore = swept.chunk->nUsedSlots();
+
+            locker.unlock();
+            swept.isUsed = swept.chunk->sweep(keepBlackBits, &swept.deferredDestroys);
+            swept.usedSlots = swept.chunk->nUsedSlots();
+            locker.relock();
+
+            nUsedSlotsInFlight -= usedBefore - swept.usedSlots;
+            done.push_back(std::move(swept));
+            chunkSwept.wakeAll();
+        }
+    }
+
+private:
+    QMutex mutex;
+    QWaitCondition workAvailable;
+    QWaitCondition chunkSwept;
+    std::vector<Chunk *> pending;
+    std::vector<SweptChunk> done;
+    size_t nInFlight = 0;
+    size_t nUsedSlotsInFlight = 0;
+    bool sweepKeepsBlackBits = false;
+    bool quit = false;
+};
+
+void BlockAllocator::sweepConcurrently(bool keepBlackBits)
+{
+    nextFree = 0;
+    nFree = 0;
+    memset(freeBins, 0, sizeof(freeBins));
+    sparseChunks.clear();
+    usedSlotsAfterLastSweep = 0;
+
+    if (chunks.empty())
+        return;
+    if (!sweeper)
+        sweeper = new ChunkSweeper;
+    sweeper->sweep(std::move(chunks), keepBlackBits);
+    chunks.clear();
+}
+
+bool BlockAllocator::adoptSweptChunk()
+{
+    SweptChunk swept;
+    if (!sweeper || !sweeper->take(&swept))
+        return false;
+
+    for (Heap::Base *b : swept.deferredDestroys) {
+        b->vtable()->destroy(b);
+        b->_checkIsDestroyed();
+    }
+
+    Chunk *c = swept.chunk;
+    if (swept.isUsed) {
+        c->sortIntoBins(freeBins, NumBins);
+        usedSlotsAfterLastSweep += swept.usedSlots;
+        chunks.push_back(c);
+    } else {
+        chunkAllocator->free(c);
+    }
+    return true;
+}
+
+void BlockAllocator::finishSweeping()
+{
+    while (adoptSweptChunk())
+        ;
+}
+
+void BlockAllocator::waitForConcurrentSweep() const
+{
+    if (sweeper)
+        sweeper->waitForAll();
+}
+
+size_t BlockAllocator::totalSlots() const
+{
+    return Chunk::AvailableSlots*(chunks.size() + (sweeper ? sweeper->chunksInFlight() : 0));
+}
+
+size_t BlockAllocator::allocatedMem() const
+{
+    return (chunks.size() + (sweeper ? sweeper->chunksInFlight() : 0))*Chunk::DataSize;
+}
+
+size_t BlockAllocator::usedMem() const
+{
+    size_t used = 0;
+    for (auto c : chunks)
+        used += c->nUsedSlots();
+    if (sweeper)
+        used += sweeper->usedSlotsInFlight();
+    return used*Chunk::SlotSize;
+}
+
 #if MM_DEBUG
 void BlockAllocator::stats() {
     DEBUG << "MM stats:";
@@ -638,13 +1189,33 @@ void BlockAllocator::stats() {
 #endif
 
 
-HeapItem *HugeItemAllocator::allocate(size_t size) {
-    Chunk *c = chunkAllocator->allocate(size);
+HeapItem *HugeItemAllocator::allocate(size_t size, bool growable) {
+    Chunk *c;
+    if (growable && MaxGrowableItemReservation)
+        c = chunkAllocator->allocateGrowable(size, qMin(size*GrowableItemReservation, MaxGrowableItemReservation));
+    else
+        c = chunkAllocator->allocate(size);
     chunks.push_back(HugeChunk{c, size});
     Chunk::setBit(c->objectBitmap, c->first() - c->realBase());
     return c->first();
 }
 
+bool HugeItemAllocator::grow(HeapItem *item, size_t newSize, size_t *oldSize)
+{
+    Chunk *c = item->chunk();
+    for (auto &h : chunks) {
+        if (h.chunk != c)
+            continue;
+        if (newSize <= h.size || !chunkAllocator->grow(c, h.size, newSize))
+            return false;
+        *oldSize = h.size;
+        h.size = newSize;
+        return true;
+    }
+    // the first item of a regular chunk
+    return false;
+}
+
 static void freeHugeChunk(ChunkAllocator *chunkAllocator, const HugeItemAllocator::HugeChunk &c)
 {
     HeapItem *itemToFree = c.chunk->first();
@@ -656,10 +1227,11 @@ static void freeHugeChunk(ChunkAllocator *chunkAllocator, const HugeItemAllocato
     chunkAllocator->free(c.chunk, c.size);
 }
 
-void HugeItemAllocator::sweep() {
-    auto isBlack = [this] (const HugeChunk &c) {
+void HugeItemAllocator::sweep(bool keepBlackBits) {
+    auto isBlack = [this, keepBlackBits] (const HugeChunk &c) {
         bool b = c.chunk->first()->isBlack();
-        Chunk::clearBit(c.chunk->blackBitmap, c.chunk->first() - c.chunk->realBase());
+        if (!keepBlackBits)
+            Chunk::clearBit(c.chunk->blackBitmap, c.chunk->first() - c.chunk->realBase());
         if (!b)
             freeHugeChunk(chunkAllocator, c);
         return !b;
@@ -669,6 +1241,12 @@ void HugeItemAllocator::sweep() {
     chunks.erase(newEnd, chunks.end());
 }
 
+void HugeItemAllocator::resetBlackBits()
+{
+    for (auto &c : chunks)
+        Chunk::clearBit(c.chunk->blackBitmap, c.chunk->first() - c.chunk->realBase());
+}
+
 void HugeItemAllocator::freeAll()
 {
     for (auto &c : chunks) {
@@ -689,6 +1267,25 @@ MemoryManager::MemoryManager(ExecutionEngine *engine)
     , aggressiveGC(!qEnvironmentVariableIsEmpty("QV4_MM_AGGRESSIVE_GC"))
     , gcStats(!qEnvironmentVariableIsEmpty(QV4_MM_STATS))
 {
+    useSoftDirtyPages = !qEnvironmentVariableIsEmpty(QV4_MM_SOFT_DIRTY_PAGES)
+            && SoftDirtyPages::isSupported();
+    generationalGC = !qEnvironmentVariableIsEmpty(QV4_MM_GENERATIONAL_GC) && useSoftDirtyPages;
+    m_incrementalGCBudget = qMax(0, qEnvironmentVariableIntValue(QV4_MM_INCREMENTAL_GC_BUDGET));
+    concurrentSweep = !qEnvironmentVariableIsEmpty(QV4_MM_CONCURRENT_SWEEP) && !aggressiveGC;
+    if (!qEnvironmentVariableIsEmpty(QV4_MM_TRACK_ALLOCATIONS))
+        setAllocationTracking(true);
+    defragment = !qEnvironmentVariableIsEmpty(QV4_MM_DEFRAGMENT) && !aggressiveGC;
+    bool ok = false;
+    const int growth = qEnvironmentVariableIntValue(QV4_MM_HEAP_GROWTH, &ok);
+    m_heapGrowthFactor = GCOverallocation;
+    if (ok)
+        setHeapGrowthFactor(growth);
+    m_maximumHeapSize = static_cast<std::size_t>(qMax(0, qEnvironmentVariableIntValue(QV4_MM_MAX_HEAP_SIZE)));
+    const int retainedLimit = qEnvironmentVariableIntValue(QV4_MM_RETAINED_MEMORY_LIMIT, &ok);
+    retainedMemoryLimit = ok ? static_cast<std::size_t>(qMax(0, retainedLimit)) : DEFAULT_RETAINED_MEMORY_LIMIT;
+    chunkAllocator->maxFreeChunks = retainedMemoryLimit/Chunk::ChunkSize;
+    if (qEnvironmentVariableIsSet(QV4_MM_GC_THREADS))
+        setGCThreadCount(qEnvironmentVariableIntValue(QV4_MM_GC_THREADS));
 #ifdef V4_USE_VALGRIND
     VALGRIND_CREATE_MEMPOOL(this, 0, true);
 #endif
@@ -710,15 +1307,18 @@ Heap::Base *MemoryManager::allocString(std::size_t unmanagedSize)
         runGC();
         didGCRun = true;
     }
+    bytesAllocatedSinceLastGC += stringSize;
 
-    unmanagedHeapSize += unmanagedSize;
-    if (unmanagedHeapSize > unmanagedHeapSizeGCLimit) {
+    if (unmanagedHeapSize.fetchAndAddRelaxed(unmanagedSize) + unmanagedSize > unmanagedHeapSizeGCLimit) {
         runGC();
+        // the string data is released by the sweeper thread
+        blockAllocator.waitForConcurrentSweep();
 
-        if (3*unmanagedHeapSizeGCLimit <= 4*unmanagedHeapSize)
+        const std::size_t heapSize = unmanagedHeapSize.load();
+        if (3*unmanagedHeapSizeGCLimit <= 4*heapSize)
             // more than 75% full, raise limit
-            unmanagedHeapSizeGCLimit = std::max(unmanagedHeapSizeGCLimit, unmanagedHeapSize) * 2;
-        else if (unmanagedHeapSize * 4 <= unmanagedHeapSizeGCLimit)
+            unmanagedHeapSizeGCLimit = std::max(unmanagedHeapSizeGCLimit, heapSize) * 2;
+        else if (heapSize * 4 <= unmanagedHeapSizeGCLimit)
             // less than 25% full, lower limit
             unmanagedHeapSizeGCLimit = qMax(MIN_UNMANAGED_HEAPSIZE_GC_LIMIT, unmanagedHeapSizeGCLimit/2);
         didGCRun = true;
@@ -735,7 +1335,7 @@ Heap::Base *MemoryManager::allocString(std::size_t unmanagedSize)
     return *m;
 }
 
-Heap::Base *MemoryManager::allocData(std::size_t size)
+Heap::Base *MemoryManager::allocData(std::size_t size, bool growable)
 {
 #ifndef QT_NO_DEBUG
     lastAllocRequestedSlots = size >> Chunk::SlotSizeShift;
@@ -755,8 +1355,13 @@ Heap::Base *MemoryManager::allocData(std::size_t size)
 
 //    qDebug() << "unmanagedHeapSize:" << unmanagedHeapSize << "limit:" << unmanagedHeapSizeGCLimit << "unmanagedSize:" << unmanagedSize;
 
-    if (size > Chunk::DataSize)
-        return *hugeItemAllocator.allocate(size);
+    bytesAllocatedSinceLastGC += size;
+
+    if (size > Chunk::DataSize) {
+        if (!didRunGC && isOverHeapLimit(size) && shouldRunGC())
+            runGC();
+        return *hugeItemAllocator.allocate(size, growable);
+    }
 
     HeapItem *m = blockAllocator.allocate(size);
     if (!m) {
@@ -774,6 +1379,8 @@ Heap::Object *MemoryManager::allocObjectWithMemberData(const QV4::VTable *vtable
     uint size = (vtable->nInlineProperties + vtable->inlinePropertyOffset)*sizeof(Value);
     Q_ASSERT(!(size % sizeof(HeapItem)));
     Heap::Object *o = static_cast<Heap::Object *>(allocData(size));
+    if (Q_UNLIKELY(m_allocationStatistics))
+        trackAllocation(vtable, size);
 
     // ### Could optimize this and allocate both in one go through the block allocator
     if (nMembers > vtable->nInlineProperties) {
@@ -791,13 +1398,291 @@ Heap::Object *MemoryManager::allocObjectWithMemberData(const QV4::VTable *vtable
         Q_ASSERT(o->memberData->internalClass);
         o->memberData->size = static_cast<uint>((memberSize - sizeof(Heap::MemberData) + sizeof(Value))/sizeof(Value));
         o->memberData->init();
+        if (Q_UNLIKELY(m_allocationStatistics))
+            trackAllocation(o->memberData->internalClass->vtable, memberSize);
 //        qDebug() << "    got" << o->memberData << o->memberData->size;
     }
     return o;
 }
 
-static void drainMarkStack(QV4::ExecutionEngine *engine, Value *markBase)
+/*
+ * Parallel marking.
+ *
+ * The roots are collected on the GUI thread as usual, and distributed over the mark stacks of
+ * the marker threads. Each marker thread then traces the heap from its share of the roots. The
+ * black bits get set atomically, so that every object is scanned by exactly one thread, and
+ * Heap::Base::mark() pushes the objects to scan onto the mark stack of the current thread.
+ *
+ * To balance the load, a marker thread moves half of its mark stack to a shared stack when its
+ * own stack grows large, and a marker thread running out of work steals half of the shared
+ * stack of another one. Marking is done once all threads are out of work at the same time.
+ *
+ * Only the markObjects() implementations of the core JS types are run on the marker threads.
+ * They were audited to do nothing but read the object and mark the values it references. All
+ * others, e.g. the ones of QObjectWrapper and its subclasses, which look at QQmlData, the
+ * VME meta object and the QObject tree, are left to the GUI thread. It runs them once the
+ * marker threads are done, and marks whatever they reach on its own.
+ */
+#ifdef Q_COMPILER_THREAD_LOCAL
+struct MarkWorker {
+    QMutex mutex;
+    std::vector<Heap::Base *> shared; // can be stolen by other threads, protected by mutex
+    QAtomicInt nShared;
+    std::vector<Heap::Base *> local;
+    std::vector<Heap::Base *> deferred; // to be marked by the GUI thread
+    std::size_t nMarked = 0;
+};
+
+static thread_local MarkWorker *currentMarkWorker = nullptr;
+
+class ParallelMarker
+{
+public:
+    enum {
+        ShareThreshold = 64
+    };
+
+    typedef void (*MarkObjects)(Heap::Base *, ExecutionEngine *);
+
+    ParallelMarker(ExecutionEngine *engine, int nThreads);
+
+    int threadCount() const { return static_cast<int>(workers.size()); }
+
+    // Traces the heap from roots, and returns the objects that have to be scanned by the GUI
+    // thread in deferred.
+    void mark(std::vector<Heap::Base *> &roots, std::vector<Heap::Base *> *deferred);
+    void run(MarkWorker *w);
+
+    std::size_t markedObjects() const;
+
+private:
+    bool isSafe(MarkObjects markObjects) const;
+    bool takeWork(MarkWorker *w);
+    bool steal(MarkWorker *victim, MarkWorker *w);
+    void share(MarkWorker *w);
+
+    ExecutionEngine *engine;
+    std::vector<MarkWorker> workers;
+    std::vector<MarkObjects> safeMarkObjects;
+    QAtomicInt nIdle;
+    QThreadPool pool;
+};
+
+ParallelMarker::ParallelMarker(ExecutionEngine *engine, int nThreads)
+    : engine(engine)
+    , workers(nThreads)
+{
+    pool.setMaxThreadCount(nThreads - 1);
+
+    // The audited markObjects() implementations, the most frequent ones first. Subclasses
+    // inheriting one of them are covered as well.
+    safeMarkObjects = {
+        Object::staticVTable()->markObjects,
+        String::staticVTable()->markObjects,
+        MemberData::staticVTable()->markObjects,
+        SimpleArrayData::staticVTable()->markObjects,
+        FunctionObject::staticVTable()->markObjects,
+        ExecutionContext::staticVTable()->markObjects,
+        SparseArrayData::staticVTable()->markObjects,
+        ArgumentsObject::staticVTable()->markObjects,
+        BoundFunction::staticVTable()->markObjects,
+        ErrorObject::staticVTable()->markObjects,
+        StringObject::staticVTable()->markObjects,
+        RegExpObject::staticVTable()->markObjects,
+        RegExpCtor::staticVTable()->markObjects,
+        RegExp::staticVTable()->markObjects,
+        TypedArray::staticVTable()->markObjects,
+        DataView::staticVTable()->markObjects,
+        ForEachIteratorObject::staticVTable()->markObjects,
+        QObjectMethod::staticVTable()->markObjects
+    };
+}
+
+bool ParallelMarker::isSafe(MarkObjects markObjects) const
+{
+    return std::find(safeMarkObjects.cbegin(), safeMarkObjects.cend(), markObjects)
+            != safeMarkObjects.cend();
+}
+
+std::size_t ParallelMarker::markedObjects() const
+{
+    std::size_t n = 0;
+    for (const MarkWorker &w : workers)
+        n += w.nMarked;
+    return n;
+}
+
+class MarkTask : public QRunnable
+{
+public:
+    MarkTask(ParallelMarker *marker, MarkWorker *worker) : marker(marker), worker(worker) {}
+    void run() override { marker->run(worker); }
+
+private:
+    ParallelMarker *marker;
+    MarkWorker *worker;
+};
+
+void ParallelMarker::mark(std::vector<Heap::Base *> &roots, std::vector<Heap::Base *> *deferred)
+{
+    const size_t nWorkers = workers.size();
+    for (size_t i = 0; i < roots.size(); ++i)
+        workers[i % nWorkers].shared.push_back(roots[i]);
+    for (MarkWorker &w : workers) {
+        w.nShared.store(static_cast<int>(w.shared.size()));
+        w.nMarked = 0;
+    }
+    roots.clear();
+    nIdle.store(0);
+
+    engine->isMarkingInParallel = true;
+    for (size_t i = 1; i < nWorkers; ++i)
+        pool.start(new MarkTask(this, &workers[i]));
+    run(&workers[0]);
+    pool.waitForDone();
+    engine->isMarkingInParallel = false;
+
+    for (MarkWorker &w : workers) {
+        deferred->insert(deferred->end(), w.deferred.begin(), w.deferred.end());
+        w.deferred.clear();
+    }
+}
+
+void ParallelMarker::run(MarkWorker *w)
+{
+    currentMarkWorker = w;
+    while (takeWork(w)) {
+        while (!w->local.empty()) {
+            Heap::Base *h = w->local.back();
+            w->local.pop_back();
+            const MarkObjects markObjects = h->vtable()->markObjects;
+            Q_ASSERT(markObjects);
+            if (Q_UNLIKELY(!isSafe(markObjects))) {
+                w->deferred.push_back(h);
+                continue;
+            }
+            markObjects(h, engine);
+            ++w->nMarked;
+            if (w->local.size() > ShareThreshold && !w->nShared.load())
+                share(w);
+        }
+    }
+    currentMarkWorker = nullptr;
+}
+
+void ParallelMarker::share(MarkWorker *w)
+{
+    QMutexLocker locker(&w->mutex);
+    if (!w->shared.empty())
+        return;
+    // the bottom of the stack is the oldest part, and probably leads to the most work
+    const size_t n = w->local.size()/2;
+    w->shared.assign(w->local.begin(), w->local.begin() + n);
+    w->local.erase(w->local.begin(), w->local.begin() + n);
+    w->nShared.store(static_cast<int>(n));
+}
+
+bool ParallelMarker::steal(MarkWorker *victim, MarkWorker *w)
+{
+    QMutexLocker locker(&victim->mutex);
+    if (victim->shared.empty())
+        return false;
+    const size_t n = victim == w ? victim->shared.size() : (victim->shared.size() + 1)/2;
+    w->local.insert(w->local.end(), victim->shared.end() - n, victim->shared.end());
+    victim->shared.resize(victim->shared.size() - n);
+    victim->nShared.store(static_cast<int>(victim->shared.size()));
+    return true;
+}
+
+// Returns false once all threads ran out of work.
+bool ParallelMarker::takeWork(MarkWorker *w)
+{
+    if (steal(w, w))
+        return true;
+
+    const int nWorkers = threadCount();
+    const int self = static_cast<int>(w - workers.data());
+    nIdle.ref();
+    while (true) {
+        for (int i = 1; i < nWorkers; ++i) {
+            MarkWorker *victim = &workers[(self + i) % nWorkers];
+            if (!victim->nShared.load())
+                continue;
+            // we're not idle while looking at the work of others, so that no one quits early
+            nIdle.deref();
+            if (steal(victim, w))
+                return true;
+            nIdle.ref();
+        }
+        if (nIdle.load() == nWorkers)
+            return false;
+        QThread::yieldCurrentThread();
+    }
+}
+
+void ParallelMarking::push(Heap::Base *m)
+{
+    Q_ASSERT(currentMarkWorker);
+    currentMarkWorker->local.push_back(m);
+}
+#else
+class ParallelMarker {};
+
+void ParallelMarking::push(Heap::Base *)
+{
+    Q_UNREACHABLE();
+}
+#endif
+
+void MemoryManager::setGCThreadCount(int count)
+{
+    count = qBound(1, count, 64);
+    if (count == m_gcThreadCount)
+        return;
+    m_gcThreadCount = count;
+    delete parallelMarker;
+    parallelMarker = nullptr;
+}
+
+bool MemoryManager::shouldMarkInParallel() const
+{
+#ifdef Q_COMPILER_THREAD_LOCAL
+    // Waking up the other threads is not worth it for small heaps.
+    return m_gcThreadCount > 1 && blockAllocator.totalSlots() >= MinSlotsGCLimit;
+#else
+    return false;
+#endif
+}
+
+void MemoryManager::markInParallel()
 {
+#ifdef Q_COMPILER_THREAD_LOCAL
+    if (!parallelMarker)
+        parallelMarker = new ParallelMarker(engine, m_gcThreadCount);
+    std::vector<Heap::Base *> deferred;
+    parallelMarker->mark(incrementalMarkStack, &deferred);
+    ++parallelMarkingStatistics.collections;
+    parallelMarkingStatistics.markedObjects += parallelMarker->markedObjects();
+    parallelMarkingStatistics.deferredObjects += deferred.size();
+
+    // The objects are black already, only their references remain to be marked.
+    Value *markBase = engine->jsStackTop;
+    for (Heap::Base *h : deferred) {
+        h->vtable()->markObjects(h, engine);
+        drainMarkStack(markBase);
+    }
+#endif
+}
+
+void MemoryManager::drainMarkStack(Value *markBase)
+{
+    if (deferMarking) {
+        // Only collecting the roots of an incremental collection. The marking happens in slices.
+        for (Value *v = markBase; v < engine->jsStackTop; ++v)
+            incrementalMarkStack.push_back(v->heapObject());
+        engine->jsStackTop = markBase;
+        return;
+    }
     while (engine->jsStackTop > markBase) {
         Heap::Base *h = engine->popForGC();
         Q_ASSERT(h); // at this point we should only have Heap::Base objects in this area on the stack. If not, weird things might happen.
@@ -808,6 +1693,11 @@ static void drainMarkStack(QV4::ExecutionEngine *engine, Value *markBase)
 
 void MemoryManager::mark()
 {
+    // When marking in parallel, only the roots are grayed here. Tracing the heap from them is
+    // then split up between the marker threads.
+    const bool parallel = !deferMarking && shouldMarkInParallel();
+    QScopedValueRollback<bool> deferRoots(deferMarking, deferMarking || parallel);
+
     Value *markBase = engine->jsStackTop;
 
     engine->markObjects();
@@ -816,12 +1706,23 @@ void MemoryManager::mark()
 
     m_persistentValues->mark(engine);
 
-    // Preserve QObject ownership rules within JavaScript: A parent with c++ ownership
-    // keeps all of its children alive in JavaScript.
-
     // Do this _after_ collectFromStack to ensure that processing the weak
     // managed objects in the loop down there doesn't make then end up as leftovers
     // on the stack and thus always get collected.
+    collectFromQObjectWrappers(markBase);
+
+    drainMarkStack(markBase);
+
+    if (parallel) {
+        deferMarking = false;
+        markInParallel();
+    }
+}
+
+// Preserve QObject ownership rules within JavaScript: A parent with c++ ownership
+// keeps all of its children alive in JavaScript.
+void MemoryManager::collectFromQObjectWrappers(Value *markBase)
+{
     for (PersistentValueStorage::Iterator it = m_weakValues->begin(); it != m_weakValues->end(); ++it) {
         QObjectWrapper *qobjectWrapper = (*it).as<QObjectWrapper>();
         if (!qobjectWrapper)
@@ -844,10 +1745,32 @@ void MemoryManager::mark()
             qobjectWrapper->mark(engine);
 
         if (engine->jsStackTop >= engine->jsStackLimit)
-            drainMarkStack(engine, markBase);
+            drainMarkStack(markBase);
     }
+}
+
+bool MemoryManager::writeHeapSnapshot(QIODevice *device)
+{
+    QScopedValueRollback<bool> gcBlocker(gcBlocked, true);
+    // Objects that are being swept must not be reached through stale references on the JS stack.
+    blockAllocator.finishSweeping();
 
-    drainMarkStack(engine, markBase);
+    HeapSnapshot snapshot(this);
+    {
+        QScopedValueRollback<HeapSnapshot *> recordReferences(engine->heapSnapshot, &snapshot);
+        Value *markBase = engine->jsStackTop;
+        snapshot.beginRoots(HeapSnapshot::EngineRoots);
+        engine->markObjects();
+        snapshot.beginRoots(HeapSnapshot::JSStackRoots);
+        collectFromJSStack();
+        snapshot.beginRoots(HeapSnapshot::PersistentRoots);
+        m_persistentValues->mark(engine);
+        snapshot.beginRoots(HeapSnapshot::QObjectRoots);
+        collectFromQObjectWrappers(markBase);
+        snapshot.traverse();
+        Q_ASSERT(engine->jsStackTop == markBase);
+    }
+    return snapshot.write(device);
 }
 
 void MemoryManager::sweep(bool lastSweep)
@@ -897,19 +1820,245 @@ void MemoryManager::sweep(bool lastSweep)
         }
     }
 
-    blockAllocator.sweep();
-    hugeItemAllocator.sweep();
+    // In generational mode the survivors keep their black bits and become old objects.
+    const bool keepBlackBits = generationalGC && !lastSweep;
+    if (concurrentSweep && !lastSweep)
+        blockAllocator.sweepConcurrently(keepBlackBits);
+    else
+        blockAllocator.sweep(keepBlackBits, defragment && !lastSweep);
+    hugeItemAllocator.sweep(keepBlackBits);
+}
+
+bool MemoryManager::tryGrow(Heap::Base *item, std::size_t newSize)
+{
+    HeapItem *h = reinterpret_cast<HeapItem *>(item);
+    newSize = align(newSize);
+    size_t oldSize;
+    // only huge items can grow, and those always start a chunk
+    if (newSize <= Chunk::DataSize || h != h->chunk()->first() || !hugeItemAllocator.grow(h, newSize, &oldSize))
+        return false;
+    bytesAllocatedSinceLastGC += newSize - oldSize;
+    return true;
 }
 
 bool MemoryManager::shouldRunGC() const
 {
+    if (isOverHeapLimit()) {
+        // Collect as soon as a little more was allocated, instead of growing the heap further.
+        return bytesAllocatedSinceLastGC * 100 >= getAllocatedMem() * OverLimitGrowth;
+    }
     size_t total = blockAllocator.totalSlots();
     size_t usedSlots = blockAllocator.usedSlotsAfterLastSweep;
-    if (total > MinSlotsGCLimit && usedSlots * GCOverallocation < total * 100)
+    if (total > MinSlotsGCLimit && usedSlots * m_heapGrowthFactor < total * 100)
         return true;
     return false;
 }
 
+bool MemoryManager::isOverHeapLimit(std::size_t extra) const
+{
+    return m_maximumHeapSize && getAllocatedMem() + extra > m_maximumHeapSize;
+}
+
+void MemoryManager::setHeapGrowthFactor(int percent)
+{
+    m_heapGrowthFactor = qMax(int(MinHeapGrowth), percent);
+}
+
+qint64 MemoryManager::estimatedGCPause() const
+{
+    const qint64 slots = qint64(blockAllocator.totalSlots());
+    if (!slotsAtLastFullGC)
+        return slots * DefaultGCNsecsPerSlot;
+    return lastFullGCPause * slots / qint64(slotsAtLastFullGC);
+}
+
+bool MemoryManager::collectWhenIdle(int msecs)
+{
+    if (gcBlocked || msecs <= 0)
+        return false;
+
+    const qint64 budget = qint64(msecs) * 1000000;
+    if (incrementalMarking) {
+        bool done;
+        {
+            QScopedValueRollback<bool> gcBlocker(gcBlocked, true);
+            done = incrementalMark(budget);
+        }
+        if (done)
+            runGC(/*forceFullCollection*/true);
+        return true;
+    }
+
+    // Wait until at least half of the growth allowed before the next collection was allocated.
+    const size_t usedBytes = qMax<size_t>(blockAllocator.usedSlotsAfterLastSweep, MinSlotsGCLimit)
+            * Chunk::SlotSize;
+    if (bytesAllocatedSinceLastGC * 200 < usedBytes * (m_heapGrowthFactor - 100))
+        return false;
+
+    if (estimatedGCPause() <= budget) {
+        runGC(/*forceFullCollection*/true);
+        return true;
+    }
+    if (canMarkIncrementally() || generationalGC) {
+        // starts marking incrementally, or does a minor collection
+        runGC();
+        return true;
+    }
+    return false;
+}
+
+bool MemoryManager::collectIfCheap()
+{
+    if (gcBlocked || incrementalMarking)
+        return false;
+    if (estimatedGCPause() > qMax<qint64>(CheapGCPause, qint64(m_incrementalGCBudget) * 1000000))
+        return false;
+    runGC(/*forceFullCollection*/true);
+    return true;
+}
+
+void MemoryManager::reportCollection(qint64 pause, std::size_t heapSizeBefore)
+{
+    m_lastGCPause = pause;
+    bytesAllocatedSinceLastGC = 0;
+
+    if (aggressiveGC || !engine->v8Engine)
+        return;
+    QJSEngine *jsEngine = engine->jsEngine();
+    if (!jsEngine)
+        return;
+    // Don't post an event per collection, incremental slices included, if nobody listens.
+    QJSEngineGarbageCollectionNotifier *notifier = QJSEnginePrivate::get(jsEngine)->gcNotifier;
+    if (notifier && notifier->isGarbageCollectedConnected()) {
+        // Queued, as the collection may have been triggered in the middle of an allocation.
+        static const QMetaMethod garbageCollected = QMetaMethod::fromSignal(
+                    &QJSEngineGarbageCollectionNotifier::garbageCollected);
+        garbageCollected.invoke(notifier, Qt::QueuedConnection, Q_ARG(qint64, pause),
+                                Q_ARG(qint64, qint64(heapSizeBefore)),
+                                Q_ARG(qint64, qint64(getAllocatedMem())));
+    }
+}
+
+bool MemoryManager::shouldRunFullGC() const
+{
+    if (!generationalGC || aggressiveGC)
+        return true;
+    if (softDirtyEpoch != SoftDirtyPages::epoch)
+        return true; // someone else reset the dirty bits since our last collection
+    // The old generation is only collected by full collections, so do one once it has grown
+    // too much since the last one.
+    const size_t oldSlots = blockAllocator.usedSlotsAfterLastSweep;
+    return oldSlots * 100 > usedSlotsAfterLastFullGC * OldGenerationGrowth;
+}
+
+#if QT_CONFIG(animation)
+// Advances an incremental collection once per animation tick, i.e. once per frame.
+class IncrementalGCJob : public QAbstractAnimationJob
+{
+public:
+    IncrementalGCJob(MemoryManager *mm) : mm(mm) {}
+
+    int duration() const override { return -1; }
+
+protected:
+    void updateCurrentTime(int) override
+    {
+        mm->incrementalGCStep();
+        if (!mm->isIncrementalMarking())
+            stop();
+    }
+
+private:
+    MemoryManager *mm;
+};
+#endif
+
+void MemoryManager::setIncrementalGCBudget(int msecs)
+{
+    m_incrementalGCBudget = qMax(0, msecs);
+}
+
+bool MemoryManager::canMarkIncrementally() const
+{
+    return m_incrementalGCBudget > 0 && !aggressiveGC && useSoftDirtyPages;
+}
+
+void MemoryManager::startIncrementalGC()
+{
+    Q_ASSERT(gcBlocked && !incrementalMarking);
+
+    blockAllocator.resetBlackBits();
+    hugeItemAllocator.resetBlackBits();
+    {
+        QMutexLocker locker(&SoftDirtyPages::mutex);
+        SoftDirtyPages::clearLocked();
+        softDirtyEpoch = SoftDirtyPages::epoch;
+    }
+    incrementalMarking = true;
+    minorGC = false;
+    slotsAtIncrementalStart = blockAllocator.totalSlots();
+
+    // gray the roots, and do the first slice right away
+    deferMarking = true;
+    mark();
+    deferMarking = false;
+    incrementalMark();
+
+#if QT_CONFIG(animation)
+    if (!incrementalGCJob)
+        incrementalGCJob = new IncrementalGCJob(this);
+    incrementalGCJob->start();
+#endif
+}
+
+// Marks until the mark stack is empty or the budget (in nanoseconds) for this slice is used
+// up. Returns true if the marking is complete.
+bool MemoryManager::incrementalMark(qint64 budget)
+{
+    QElapsedTimer timer;
+    timer.start();
+    ++incrementalSlices;
+
+    Value *markBase = engine->jsStackTop;
+    uint n = 0;
+    while (true) {
+        Heap::Base *h;
+        if (engine->jsStackTop > markBase) {
+            h = engine->popForGC();
+        } else if (!incrementalMarkStack.empty()) {
+            h = incrementalMarkStack.back();
+            incrementalMarkStack.pop_back();
+        } else {
+            break;
+        }
+        Q_ASSERT(h->vtable()->markObjects);
+        h->vtable()->markObjects(h, engine);
+        if (!(++n % 128) && timer.nsecsElapsed() >= budget)
+            break;
+    }
+
+    // keep what's left for the next slice
+    for (Value *v = markBase; v < engine->jsStackTop; ++v)
+        incrementalMarkStack.push_back(v->heapObject());
+    engine->jsStackTop = markBase;
+    return incrementalMarkStack.empty();
+}
+
+void MemoryManager::incrementalGCStep()
+{
+    if (!incrementalMarking || gcBlocked)
+        return;
+
+    if (!incrementalMarkStack.empty()) {
+        QScopedValueRollback<bool> gcBlocker(gcBlocked, true);
+        incrementalMark();
+        return;
+    }
+
+    // The final pause: re-scan roots and modified objects, and sweep.
+    runGC(/*forceFullCollection*/true);
+}
+
 size_t dumpBins(BlockAllocator *b, bool printOutput = true)
 {
     size_t totalFragmentedSlots = 0;
@@ -938,7 +2087,7 @@ size_t dumpBins(BlockAllocator *b, bool printOutput = true)
     return totalFragmentedSlots*Chunk::SlotSize;
 }
 
-void MemoryManager::runGC()
+void MemoryManager::runGC(bool forceFullCollection)
 {
     if (gcBlocked) {
 //        qDebug() << "Not running GC.";
@@ -947,19 +2096,89 @@ void MemoryManager::runGC()
 
     QScopedValueRollback<bool> gcBlocker(gcBlocked, true);
 
+    QElapsedTimer pauseTimer;
+    pauseTimer.start();
+    const bool finishingIncrementalGC = incrementalMarking;
+
+    // The mark bits of chunks still being swept can't be touched.
+    blockAllocator.finishSweeping();
+    const size_t heapSizeBefore = getAllocatedMem();
+    const size_t slotsBefore = blockAllocator.totalSlots();
+
+    if (incrementalMarking) {
+        // Allocations are outpacing the frame driven marking. Help out with another slice,
+        // unless the heap grew too much meanwhile, in which case we finish right away.
+        if (!forceFullCollection
+                && blockAllocator.totalSlots() * 100 < slotsAtIncrementalStart * m_heapGrowthFactor) {
+            incrementalMark();
+            return;
+        }
+
+        QMutexLocker locker(&SoftDirtyPages::mutex);
+        incrementalMarking = false;
+#if QT_CONFIG(animation)
+        if (incrementalGCJob)
+            incrementalGCJob->stop();
+#endif
+        // Finish marking the gray objects, and re-scan the black objects that got modified
+        // since they were marked. Roots are re-scanned by mark() below.
+        bool rescanned = false;
+        if (softDirtyEpoch == SoftDirtyPages::epoch) {
+            Value *markBase = engine->jsStackTop;
+            while (!incrementalMarkStack.empty()) {
+                engine->pushForGC(incrementalMarkStack.back());
+                incrementalMarkStack.pop_back();
+                drainMarkStack(markBase);
+            }
+            rescanned = collectFromRememberedSet();
+        }
+        if (!rescanned) {
+            // Someone reset the dirty bits behind our back. Fall back to a stop the world mark.
+            incrementalMarkStack.clear();
+            blockAllocator.resetBlackBits();
+            hugeItemAllocator.resetBlackBits();
+        }
+    } else if (generationalGC) {
+        QMutexLocker locker(&SoftDirtyPages::mutex);
+        minorGC = !forceFullCollection && !shouldRunFullGC();
+        if (minorGC && !collectFromRememberedSet())
+            minorGC = false;
+        if (!minorGC && !forceFullCollection && canMarkIncrementally()) {
+            locker.unlock();
+            startIncrementalGC();
+            return;
+        }
+        if (!minorGC) {
+            blockAllocator.resetBlackBits();
+            hugeItemAllocator.resetBlackBits();
+        }
+    } else if (!forceFullCollection && canMarkIncrementally()) {
+        startIncrementalGC();
+        return;
+    }
+
+    // Reading the resident memory means opening a file in /proc, so only do it for the stats.
+    if (gcStats && !aggressiveGC)
+        residentMemoryBeforeLastGC = residentMemory();
+
     if (!gcStats) {
 //        uint oldUsed = allocator.usedMem();
         mark();
+        if (m_allocationStatistics)
+            countSurvivors();
         sweep();
+        releaseFreeMemory();
 //        DEBUG << "RUN GC: allocated:" << allocator.allocatedMem() << "used before" << oldUsed << "used now" << allocator.usedMem();
     } else {
-        bool triggeredByUnmanagedHeap = (unmanagedHeapSize > unmanagedHeapSizeGCLimit);
-        size_t oldUnmanagedSize = unmanagedHeapSize;
+        bool triggeredByUnmanagedHeap = (unmanagedHeapSize.load() > unmanagedHeapSizeGCLimit);
+        size_t oldUnmanagedSize = unmanagedHeapSize.load();
         const size_t totalMem = getAllocatedMem();
         const size_t usedBefore = getUsedMem();
         const size_t largeItemsBefore = getLargeItemsMem();
 
         qDebug() << "========== GC ==========";
+        if (generationalGC)
+            qDebug() << (minorGC ? "    Minor collection." : "    Full collection.");
 #ifndef QT_NO_DEBUG
         qDebug() << "    Triggered by alloc request of" << lastAllocRequestedSlots << "slots.";
 #endif
@@ -972,7 +2191,11 @@ void MemoryManager::runGC()
         t.start();
         mark();
         qint64 markTime = t.restart();
+        if (m_allocationStatistics)
+            countSurvivors();
         sweep();
+        blockAllocator.finishSweeping();
+        releaseFreeMemory();
         const size_t usedAfter = getUsedMem();
         const size_t largeItemsAfter = getLargeItemsMem();
         qint64 sweepTime = t.elapsed();
@@ -980,7 +2203,7 @@ void MemoryManager::runGC()
         if (triggeredByUnmanagedHeap) {
             qDebug() << "triggered by unmanaged heap:";
             qDebug() << "   old unmanaged heap size:" << oldUnmanagedSize;
-            qDebug() << "   new unmanaged heap:" << unmanagedHeapSize;
+            qDebug() << "   new unmanaged heap:" << unmanagedHeapSize.load();
             qDebug() << "   unmanaged heap limit:" << unmanagedHeapSizeGCLimit;
         }
         size_t memInBins = dumpBins(&blockAllocator);
@@ -990,7 +2213,10 @@ void MemoryManager::runGC()
         qDebug() << "Used memory after GC:" << usedAfter;
         qDebug() << "Freed up bytes:" << (usedBefore - usedAfter);
         qDebug() << "Freed up chunks:" << (oldChunks - blockAllocator.chunks.size());
-        size_t lost = blockAllocator.allocatedMem() - memInBins - usedAfter;
+        const size_t memInSparseChunks = blockAllocator.freeSlotsInSparseChunks()*Chunk::SlotSize;
+        if (memInSparseChunks)
+            qDebug() << "Free memory in sparse chunks:" << memInSparseChunks << "in" << blockAllocator.sparseChunks.size() << "chunks";
+        size_t lost = blockAllocator.allocatedMem() - memInBins - memInSparseChunks - usedAfter;
         if (lost)
             qDebug() << "!!!!!!!!!!!!!!!!!!!!! LOST MEM:" << lost << "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!";
         if (largeItemsBefore || largeItemsAfter) {
@@ -998,13 +2224,40 @@ void MemoryManager::runGC()
             qDebug() << "Large item memory after GC:" << largeItemsAfter;
             qDebug() << "Large item memory freed up:" << (largeItemsBefore - largeItemsAfter);
         }
+        qDebug() << "Retained free memory:" << getRetainedMem();
+        if (residentMemoryAfterLastGC) {
+            qDebug() << "Resident memory before GC:" << residentMemoryBeforeLastGC;
+            qDebug() << "Resident memory after GC:" << residentMemoryAfterLastGC;
+        }
         qDebug() << "======== End GC ========";
     }
 
+    const bool fullCollection = !minorGC && !finishingIncrementalGC;
+
+    if (generationalGC) {
+        if (minorGC)
+            ++minorCollections;
+        else
+            usedSlotsAfterLastFullGC = qMax<size_t>(blockAllocator.usedSlotsAfterLastSweep, MinSlotsGCLimit);
+        minorGC = false;
+        // Start tracking writes to the now old objects.
+        QMutexLocker locker(&SoftDirtyPages::mutex);
+        SoftDirtyPages::clearLocked();
+        softDirtyEpoch = SoftDirtyPages::epoch;
+    }
+
     if (aggressiveGC) {
         // ensure we don't 'loose' any memory
         Q_ASSERT(blockAllocator.allocatedMem() == getUsedMem() + dumpBins(&blockAllocator, false));
     }
+
+    const qint64 pause = pauseTimer.nsecsElapsed();
+    if (fullCollection) {
+        // for estimating the cost of the next one
+        lastFullGCPause = pause;
+        slotsAtLastFullGC = qMax<size_t>(slotsBefore, 1);
+    }
+    reportCollection(pause, heapSizeBefore);
 }
 
 size_t MemoryManager::getUsedMem() const
@@ -1022,10 +2275,40 @@ size_t MemoryManager::getLargeItemsMem() const
     return hugeItemAllocator.usedMem();
 }
 
+size_t MemoryManager::getRetainedMem() const
+{
+    return chunkAllocator->retainedMemory();
+}
+
+void MemoryManager::releaseFreeMemory()
+{
+    // Keep enough free chunks around for the heap to grow back a bit, but not more than the
+    // configured limit.
+    const size_t chunksInUse = blockAllocator.chunks.size() + stackAllocator.chunks.size();
+    chunkAllocator->releaseFreeChunks(qMin(chunkAllocator->maxFreeChunks,
+                                           chunksInUse/RetainedChunksRatio + 1));
+    if (gcStats && !aggressiveGC)
+        residentMemoryAfterLastGC = residentMemory();
+}
+
 MemoryManager::~MemoryManager()
 {
+    if (gcStats)
+        dumpStats();
+    setAllocationTracking(false);
+
     delete m_persistentValues;
 
+#if QT_CONFIG(animation)
+    delete incrementalGCJob;
+#endif
+    delete parallelMarker;
+    blockAllocator.finishSweeping();
+    incrementalMarkStack.clear();
+    incrementalMarking = false;
+    // old objects and objects marked by an unfinished incremental collection are black
+    blockAllocator.resetBlackBits();
+    hugeItemAllocator.resetBlackBits();
     sweep(/*lastSweep*/true);
     blockAllocator.freeAll();
     hugeItemAllocator.freeAll();
@@ -1039,8 +2322,153 @@ MemoryManager::~MemoryManager()
 }
 
 
+void MemoryManager::setAllocationTracking(bool enabled)
+{
+    if (enabled == isTrackingAllocations())
+        return;
+    if (enabled) {
+        m_allocationStatistics = new AllocationStatistics;
+    } else {
+        resetAllocationStatistics();
+        delete m_allocationStatistics;
+        m_allocationStatistics = nullptr;
+    }
+}
+
+void MemoryManager::resetAllocationStatistics()
+{
+    if (!m_allocationStatistics)
+        return;
+    for (auto it = m_allocationStatistics->sites.cbegin(), end = m_allocationStatistics->sites.cend();
+         it != end; ++it) {
+        if (Function *function = it.key().first)
+            function->compilationUnit->release();
+    }
+    m_allocationStatistics->sites.clear();
+    m_allocationStatistics->types.clear();
+    m_allocationStatistics->collections = 0;
+}
+
+// Allocations are attributed to the innermost JS function that is running. Called by the
+// allocation functions only if allocations are tracked.
+void MemoryManager::trackAllocation(const VTable *vtable, std::size_t size)
+{
+    AllocationCounters &type = m_allocationStatistics->types[vtable];
+    ++type.allocations;
+    type.bytes += size;
+
+    Function *function = nullptr;
+    int line = -1;
+    if (Heap::ExecutionContext *context = engine->current) {
+        line = qAbs(context->lineNumber);
+        for (Heap::ExecutionContext *it = context; it; it = it->outer) {
+            if (it->type >= Heap::ExecutionContext::Type_SimpleCallContext) {
+                function = static_cast<Heap::CallContext *>(it)->v4Function;
+                break;
+            }
+            if (it->type != Heap::ExecutionContext::Type_CatchContext
+                    && it->type != Heap::ExecutionContext::Type_WithContext) {
+                break;
+            }
+        }
+        if (!function)
+            function = engine->globalCode;
+    }
+
+    auto site = m_allocationStatistics->sites.find(qMakePair(function, line));
+    if (site == m_allocationStatistics->sites.end()) {
+        // keep the function around for reporting
+        if (function)
+            function->compilationUnit->addref();
+        site = m_allocationStatistics->sites.insert(qMakePair(function, line), AllocationCounters());
+    }
+    ++site->allocations;
+    site->bytes += size;
+}
+
+// Counts the marked objects per type. Called between marking and sweeping.
+void MemoryManager::countSurvivors()
+{
+    QHash<const VTable *, AllocationCounters> &types = m_allocationStatistics->types;
+    for (auto it = types.begin(), end = types.end(); it != end; ++it)
+        it->survivors = it->survivedBytes = 0;
+
+    for (Chunk *c : blockAllocator.chunks) {
+        HeapItem *base = c->realBase();
+        for (uint i = 0; i < Chunk::EntriesInBitmap; ++i) {
+            quintptr live = c->objectBitmap[i] & c->blackBitmap[i];
+            while (live) {
+                const uint index = qCountTrailingZeroBits(live);
+                live &= live - 1;
+                HeapItem *item = base + i*Chunk::Bits + index;
+                AllocationCounters &counters = types[static_cast<Heap::Base *>(*item)->vtable()];
+                ++counters.survivors;
+                counters.survivedBytes += item->size();
+            }
+        }
+    }
+    for (const auto &h : hugeItemAllocator.chunks) {
+        HeapItem *item = h.chunk->first();
+        if (!item->isBlack())
+            continue;
+        AllocationCounters &counters = types[static_cast<Heap::Base *>(*item)->vtable()];
+        ++counters.survivors;
+        counters.survivedBytes += h.size;
+    }
+    ++m_allocationStatistics->collections;
+}
+
+template <typename Key>
+static bool moreBytesAllocated(const std::pair<Key, const AllocationCounters *> &a,
+                               const std::pair<Key, const AllocationCounters *> &b)
+{
+    return a.second->bytes > b.second->bytes;
+}
+
 void MemoryManager::dumpStats() const
 {
+    std::cerr << "=================" << std::endl;
+    std::cerr << "Memory stats:" << std::endl;
+    std::cerr << "\tallocated: " << getAllocatedMem() << " bytes, used: " << getUsedMem()
+              << " bytes, large items: " << getLargeItemsMem() << " bytes" << std::endl;
+    std::cerr << "\tretained free memory: " << getRetainedMem() << " bytes (limit "
+              << retainedMemoryLimit << " bytes)" << std::endl;
+    std::cerr << "\tresident memory before last GC: " << residentMemoryBeforeLastGC
+              << " bytes, after: " << residentMemoryAfterLastGC << " bytes" << std::endl;
+
+    if (const AllocationStatistics *stats = m_allocationStatistics) {
+        std::vector<std::pair<const VTable *, const AllocationCounters *>> types;
+        for (auto it = stats->types.cbegin(), end = stats->types.cend(); it != end; ++it)
+            types.emplace_back(it.key(), &it.value());
+        std::sort(types.begin(), types.end(), moreBytesAllocated<const VTable *>);
+        std::cerr << "=================" << std::endl;
+        std::cerr << "Allocations per type (survivors of the last of " << stats->collections
+                  << " collections):" << std::endl;
+        for (const auto &t : types) {
+            const AllocationCounters *c = t.second;
+            std::cerr << "\t" << t.first->className << ": " << c->allocations << " allocations, "
+                      << c->bytes << " bytes, " << c->survivors << " survivors, "
+                      << c->survivedBytes << " bytes" << std::endl;
+        }
+
+        std::vector<std::pair<AllocationStatistics::Site, const AllocationCounters *>> sites;
+        for (auto it = stats->sites.cbegin(), end = stats->sites.cend(); it != end; ++it)
+            sites.emplace_back(it.key(), &it.value());
+        std::sort(sites.begin(), sites.end(), moreBytesAllocated<AllocationStatistics::Site>);
+        std::cerr << "Top allocation sites:" << std::endl;
+        for (size_t i = 0; i < qMin(sites.size(), size_t(20)); ++i) {
+            Function *function = sites[i].first.first;
+            const AllocationCounters *c = sites[i].second;
+            QString location = QStringLiteral("<native>");
+            if (function) {
+                location = function->name()->toQString() + QLatin1Char('@') + function->sourceFile()
+                        + QLatin1Char(':') + QString::number(sites[i].first.second);
+            }
+            std::cerr << "\t" << qPrintable(location) << ": " << c->allocations << " allocations, "
+                      << c->bytes << " bytes" << std::endl;
+        }
+    }
+
 #ifdef DETAILED_MM_STATS
     std::cerr << "=================" << std::endl;
     std::cerr << "Allocation stats:" << std::endl;
@@ -1065,6 +2493,92 @@ void MemoryManager::willAllocate(std::size_t size)
 
 #endif // DETAILED_MM_STATS
 
+static void pushOldObjects(ExecutionEngine *engine, Chunk *c, uint first, uint end)
+{
+    // find the start of an object extending into the range
+    while (first > Chunk::HeaderSize/Chunk::SlotSize && Chunk::testBit(c->extendsBitmap, first))
+        --first;
+    HeapItem *base = c->realBase();
+    while (first < end) {
+        const uint i = first >> Chunk::BitShift;
+        const uint wordEnd = (i + 1) << Chunk::BitShift;
+        quintptr old = c->objectBitmap[i] & c->blackBitmap[i];
+        old &= ~static_cast<quintptr>(0) << (first & (Chunk::Bits - 1));
+        if (end < wordEnd)
+            old &= (static_cast<quintptr>(1) << (end & (Chunk::Bits - 1))) - 1;
+        while (old) {
+            const uint index = qCountTrailingZeroBits(old);
+            old &= old - 1;
+            engine->pushForGC(base[i*Chunk::Bits + index]);
+        }
+        first = wordEnd;
+    }
+}
+
+/*
+ * The remembered set of a minor collection consists of all old objects that might point to
+ * young ones: the objects on pages written to since the last collection, and the QObject
+ * wrappers, as those mark through the QObject tree and the VME meta objects, which live
+ * outside of the GC heap.
+ *
+ * Old objects are black already. Pushing them onto the mark stack makes their children get
+ * marked, whereas marking stops at all other old objects.
+ *
+ * Returns false if the dirty bits could not be read.
+ */
+bool MemoryManager::collectFromRememberedSet()
+{
+    Value *markBase = engine->jsStackTop;
+    const size_t pageSize = WTF::pageSize();
+    const uint slotsPerPage = qMin<size_t>(pageSize, Chunk::ChunkSize) >> Chunk::SlotSizeShift;
+
+    SoftDirtyPages::Map dirtyPages;
+    for (Chunk *c : blockAllocator.chunks) {
+        const quintptr chunkStart = reinterpret_cast<quintptr>(c);
+        uint runStart = 0;
+        bool inRun = false;
+        for (uint slot = 0; slot < Chunk::NumSlots; slot += slotsPerPage) {
+            const bool dirty = dirtyPages.isDirty(chunkStart + slot*Chunk::SlotSize);
+            if (dirty && !inRun)
+                runStart = slot;
+            else if (!dirty && inRun)
+                pushOldObjects(engine, c, runStart, slot);
+            inRun = dirty;
+        }
+        if (inRun)
+            pushOldObjects(engine, c, runStart, Chunk::NumSlots);
+        drainMarkStack(markBase);
+    }
+
+    for (const auto &h : hugeItemAllocator.chunks) {
+        HeapItem *item = h.chunk->first();
+        if (!item->isBlack())
+            continue;
+        const quintptr start = reinterpret_cast<quintptr>(h.chunk);
+        for (size_t offset = 0; offset < h.size; offset += pageSize) {
+            if (dirtyPages.isDirty(start + offset)) {
+                engine->pushForGC(*item);
+                drainMarkStack(markBase);
+                break;
+            }
+        }
+    }
+
+    if (dirtyPages.error)
+        return false;
+
+    for (PersistentValueStorage::Iterator it = m_weakValues->begin(); it != m_weakValues->end(); ++it) {
+        QObjectWrapper *qobjectWrapper = (*it).as<QObjectWrapper>();
+        if (!qobjectWrapper || !qobjectWrapper->markBit())
+            continue;
+        engine->pushForGC(qobjectWrapper->d());
+        if (engine->jsStackTop >= engine->jsStackLimit)
+            drainMarkStack(markBase);
+    }
+    drainMarkStack(markBase);
+    return true;
+}
+
 void MemoryManager::collectFromJSStack() const
 {
     Value *v = engine->jsStackBase;
@@ -57,20 +57,39 @@
 #include <private/qv4object_p.h>
 #include <private/qv4mmdefs_p.h>
 #include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QAtomicInteger>
 
 //#define DETAILED_MM_STATS
 
 #define QV4_MM_MAXBLOCK_SHIFT "QV4_MM_MAXBLOCK_SHIFT"
 #define QV4_MM_MAX_CHUNK_SIZE "QV4_MM_MAX_CHUNK_SIZE"
 #define QV4_MM_STATS "QV4_MM_STATS"
+#define QV4_MM_GENERATIONAL_GC "QV4_MM_GENERATIONAL_GC"
+#define QV4_MM_SOFT_DIRTY_PAGES "QV4_MM_SOFT_DIRTY_PAGES"
+#define QV4_MM_INCREMENTAL_GC_BUDGET "QV4_MM_INCREMENTAL_GC_BUDGET"
+#define QV4_MM_CONCURRENT_SWEEP "QV4_MM_CONCURRENT_SWEEP"
+#define QV4_MM_GC_THREADS "QV4_MM_GC_THREADS"
+#define QV4_MM_RETAINED_MEMORY_LIMIT "QV4_MM_RETAINED_MEMORY_LIMIT"
+#define QV4_MM_DEFRAGMENT "QV4_MM_DEFRAGMENT"
+#define QV4_MM_TRACK_ALLOCATIONS "QV4_MM_TRACK_ALLOCATIONS"
+#define QV4_MM_HEAP_GROWTH "QV4_MM_HEAP_GROWTH"
+#define QV4_MM_MAX_HEAP_SIZE "QV4_MM_MAX_HEAP_SIZE"
 
 #define MM_DEBUG 0
 
 QT_BEGIN_NAMESPACE
 
+class QIODevice;
+
 namespace QV4 {
 
 struct ChunkAllocator;
+struct Function;
+class ChunkSweeper;
+class ParallelMarker;
+class IncrementalGCJob;
 
 template<typename T>
 struct StackAllocator {
@@ -138,22 +157,21 @@ struct BlockAllocator {
 
     HeapItem *allocate(size_t size, bool forceAllocation = false);
 
-    size_t totalSlots() const {
-        return Chunk::AvailableSlots*chunks.size();
-    }
-
-    size_t allocatedMem() const {
-        return chunks.size()*Chunk::DataSize;
-    }
-    size_t usedMem() const {
-        uint used = 0;
-        for (auto c : chunks)
-            used += c->nUsedSlots()*Chunk::SlotSize;
-        return used;
-    }
+    size_t totalSlots() const;
+    size_t allocatedMem() const;
+    size_t usedMem() const;
 
-    void sweep();
+    void sweep(bool keepBlackBits = false, bool defragment = false);
+    void resetBlackBits();
     void freeAll();
+    size_t freeSlotsInSparseChunks() const;
+
+    // Hands the chunks over to a background thread for sweeping. They get adopted again
+    // as soon as the allocator runs out of memory, or by finishSweeping().
+    void sweepConcurrently(bool keepBlackBits = false);
+    bool adoptSweptChunk();
+    void finishSweeping();
+    void waitForConcurrentSweep() const;
 
     // bump allocations
     HeapItem *nextFree = 0;
@@ -162,6 +180,10 @@ struct BlockAllocator {
     HeapItem *freeBins[NumBins];
     ChunkAllocator *chunkAllocator;
     std::vector<Chunk *> chunks;
+    // Mostly empty chunks, whose free slots are only handed out once all other chunks are full.
+    // Sorted by the number of used slots, the fullest one last.
+    std::vector<Chunk *> sparseChunks;
+    ChunkSweeper *sweeper = nullptr;
 #if MM_DEBUG
     uint allocations[NumBins];
 #endif
@@ -172,8 +194,11 @@ struct HugeItemAllocator {
         : chunkAllocator(chunkAllocator)
     {}
 
-    HeapItem *allocate(size_t size);
-    void sweep();
+    HeapItem *allocate(size_t size, bool growable = false);
+    // On success, oldSize is set to the size of the item before growing it.
+    bool grow(HeapItem *item, size_t newSize, size_t *oldSize);
+    void sweep(bool keepBlackBits = false);
+    void resetBlackBits();
     void freeAll();
 
     size_t usedMem() const {
@@ -193,6 +218,24 @@ struct HugeItemAllocator {
 };
 
 
+struct AllocationCounters {
+    quint64 allocations = 0;
+    quint64 bytes = 0;
+    // live objects after the last collection, only counted per type
+    quint64 survivors = 0;
+    quint64 survivedBytes = 0;
+};
+
+// Allocations per type and per allocation site (the running JS function and line) since the
+// statistics were last reset.
+struct AllocationStatistics {
+    typedef QPair<Function *, int> Site;
+
+    QHash<const VTable *, AllocationCounters> types;
+    QHash<Site, AllocationCounters> sites;
+    uint collections = 0;
+};
+
 class Q_QML_EXPORT MemoryManager
 {
     Q_DISABLE_COPY(MemoryManager);
@@ -219,12 +262,16 @@ public:
     void freeSimpleCallContext()
     { stackAllocator.free(); }
 
+    // Growable items larger than a chunk get address space reserved behind them, so that
+    // tryGrow() can usually enlarge them without moving.
     template<typename ManagedType>
-    inline typename ManagedType::Data *allocManaged(std::size_t size)
+    inline typename ManagedType::Data *allocManaged(std::size_t size, bool growable = false)
     {
         V4_ASSERT_IS_TRIVIAL(typename ManagedType::Data)
         size = align(size);
-        Heap::Base *o = allocData(size);
+        Heap::Base *o = allocData(size, growable);
+        if (Q_UNLIKELY(m_allocationStatistics))
+            trackAllocation(ManagedType::staticVTable(), size);
         InternalClass *ic = ManagedType::defaultInternalClass(engine);
         ic = ic->changeVTable(ManagedType::staticVTable());
         o->internalClass = ic;
@@ -261,6 +308,8 @@ public:
         typename ManagedType::Data *o = reinterpret_cast<typename ManagedType::Data *>(allocString(unmanagedSize));
         o->internalClass = ManagedType::defaultInternalClass(engine);
         Q_ASSERT(o->internalClass && o->internalClass->vtable);
+        if (Q_UNLIKELY(m_allocationStatistics))
+            trackAllocation(o->internalClass->vtable, align(sizeof(typename ManagedType::Data)));
         o->init(arg1);
         return o;
     }
@@ -429,22 +478,70 @@ public:
         return t->d();
     }
 
-    void runGC();
+    // Enlarges an item in place to newSize bytes. The new memory is zero initialized. Returns
+    // false if that's not possible, e.g. for items that weren't allocated as growable.
+    bool tryGrow(Heap::Base *item, std::size_t newSize);
+
+    void runGC(bool forceFullCollection = false);
+
+    // Incremental marking is driven by the animation tick, and does at most msecs of work per
+    // frame. A budget of 0 disables it.
+    void setIncrementalGCBudget(int msecs);
+    int incrementalGCBudget() const { return m_incrementalGCBudget; }
+    bool isIncrementalMarking() const { return incrementalMarking; }
+    void incrementalGCStep();
+
+    // Pacing: the heap may grow to percent of the memory in use after the last collection
+    // before the next one runs. Above the maximum heap size, collections run much more often.
+    // A maximum of 0 means no limit.
+    void setHeapGrowthFactor(int percent);
+    int heapGrowthFactor() const { return m_heapGrowthFactor; }
+    void setMaximumHeapSize(std::size_t bytes) { m_maximumHeapSize = bytes; }
+    std::size_t maximumHeapSize() const { return m_maximumHeapSize; }
+
+    // Use idle time, e.g. after a frame was rendered early, to do garbage collection work that
+    // is going to be due soon. Returns true if something was done.
+    bool collectWhenIdle(int msecs);
+    // Runs a full collection if it's expected to take less than a millisecond or the
+    // incremental budget.
+    bool collectIfCheap();
+    // in nanoseconds, extrapolated from the last full collection
+    qint64 estimatedGCPause() const;
+    qint64 lastGCPause() const { return m_lastGCPause; }
+
+    // The number of threads used to mark the heap, including the GUI thread.
+    void setGCThreadCount(int count);
+    int gcThreadCount() const { return m_gcThreadCount; }
+
+    // Processes the mark stack on the JS stack down to markBase.
+    void drainMarkStack(Value *markBase);
 
     void dumpStats() const;
 
+    // Writes the reachable objects and the references between them to device, in the
+    // .heapsnapshot format of Chrome's developer tools.
+    bool writeHeapSnapshot(QIODevice *device);
+
+    // Opt-in allocation tracking, for finding out which types and which code allocate most.
+    void setAllocationTracking(bool enabled);
+    bool isTrackingAllocations() const { return m_allocationStatistics; }
+    const AllocationStatistics *allocationStatistics() const { return m_allocationStatistics; }
+    void resetAllocationStatistics();
+    void trackAllocation(const VTable *vtable, std::size_t size);
+
     size_t getUsedMem() const;
     size_t getAllocatedMem() const;
     size_t getLargeItemsMem() const;
+    size_t getRetainedMem() const;
 
     // called when a JS object grows itself. Specifically: Heap::String::append
-    void changeUnmanagedHeapSizeUsage(qptrdiff delta) { unmanagedHeapSize += delta; }
+    void changeUnmanagedHeapSizeUsage(qptrdiff delta) { unmanagedHeapSize.fetchAndAddRelaxed(delta); }
 
 
 protected:
     /// expects size to be aligned
     Heap::Base *allocString(std::size_t unmanagedSize);
-    Heap::Base *allocData(std::size_t size);
+    Heap::Base *allocData(std::size_t size, bool growable = false);
     Heap::Object *allocObjectWithMemberData(const QV4::VTable *vtable, uint nMembers);
 
 #ifdef DETAILED_MM_STATS
@@ -453,9 +550,22 @@ protected:
 
 private:
     void collectFromJSStack() const;
+    void collectFromQObjectWrappers(Value *markBase);
+    bool collectFromRememberedSet();
     void mark();
+    bool shouldMarkInParallel() const;
+    void markInParallel();
+    bool canMarkIncrementally() const;
+    void startIncrementalGC();
+    bool incrementalMark(qint64 budget);
+    bool incrementalMark() { return incrementalMark(qint64(m_incrementalGCBudget) * 1000000); }
     void sweep(bool lastSweep = false);
+    void releaseFreeMemory();
+    void countSurvivors();
     bool shouldRunGC() const;
+    bool shouldRunFullGC() const;
+    bool isOverHeapLimit(std::size_t extra = 0) const;
+    void reportCollection(qint64 pause, std::size_t heapSizeBefore);
 
 public:
     QV4::ExecutionEngine *engine;
@@ -467,10 +577,61 @@ public:
     PersistentValueStorage *m_weakValues;
     QVector<Value *> m_pendingFreedObjectWrapperValue;
 
-    std::size_t unmanagedHeapSize = 0; // the amount of bytes of heap that is not managed by the memory manager, but which is held onto by managed items.
+    // the amount of bytes of heap that is not managed by the memory manager, but which is held onto by managed items.
+    // Atomic, as strings release their data when they are swept on the background thread.
+    QAtomicInteger<std::size_t> unmanagedHeapSize;
     std::size_t unmanagedHeapSizeGCLimit;
 
+    // Generational mode: objects surviving a collection keep their black bit ("sticky" mark
+    // bits) and form the old generation. A minor collection only traces the young objects
+    // reachable from the roots and from old objects on pages written to since the last GC.
+    std::size_t usedSlotsAfterLastFullGC = 0;
+    uint softDirtyEpoch = 0;
+    bool useSoftDirtyPages = false;
+    bool generationalGC = false;
+    bool minorGC = false;
+    uint minorCollections = 0;
+
+    // Incremental mode: the objects left gray between two marking slices. Writes into black
+    // objects are caught by the same dirty page tracking, so those get re-scanned when the
+    // marking is finished.
+    std::vector<Heap::Base *> incrementalMarkStack;
+    std::size_t slotsAtIncrementalStart = 0;
+    IncrementalGCJob *incrementalGCJob = nullptr;
+    int m_incrementalGCBudget = 0;
+    uint incrementalSlices = 0;
+    bool incrementalMarking = false;
+    bool deferMarking = false;
+
+    // Free chunks are kept committed up to this limit, and given back to the OS beyond it.
+    std::size_t retainedMemoryLimit;
+    // only measured with QV4_MM_STATS
+    std::size_t residentMemoryBeforeLastGC = 0;
+    std::size_t residentMemoryAfterLastGC = 0;
+
+    ParallelMarker *parallelMarker = nullptr;
+    int m_gcThreadCount = 1;
+    // Collections marked in parallel, and the objects scanned by the marker threads vs. the
+    // ones left to the GUI thread.
+    struct ParallelMarkingStatistics {
+        uint collections = 0;
+        std::size_t markedObjects = 0;
+        std::size_t deferredObjects = 0;
+    } parallelMarkingStatistics;
+
+    AllocationStatistics *m_allocationStatistics = nullptr;
+
+    // Pacing
+    std::size_t m_maximumHeapSize = 0;
+    std::size_t bytesAllocatedSinceLastGC = 0;
+    qint64 m_lastGCPause = 0;
+    qint64 lastFullGCPause = 0;
+    std::size_t slotsAtLastFullGC = 0;
+    int m_heapGrowthFactor;
+
     bool gcBlocked = false;
+    bool concurrentSweep = false;
+    bool defragment = false;
     bool aggressiveGC = false;
     bool gcStats = false;
 };
@@ -53,8 +53,11 @@
 #include <private/qv4global_p.h>
 #include <private/qv4runtimeapi_p.h>
 #include <QtCore/qalgorithms.h>
+#include <QtCore/qatomic.h>
 #include <qdebug.h>
 
+#include <vector>
+
 QT_BEGIN_NAMESPACE
 
 namespace QV4 {
@@ -85,6 +88,14 @@ typedef void(*ClassDestroyStatsCallback)(const char *);
  *
  * When sweeping, simply copy the black bits over to the object bits.
  *
+ * In generational mode, the black bits are kept after sweeping. All objects surviving a
+ * collection are therefore black, and objects allocated afterwards are white. This is what
+ * tells old objects from young ones.
+ *
+ * Chunks can also be swept on a background thread. In that case only strings get destroyed
+ * right away. The other dead objects are handed back to the GUI thread, which destroys them
+ * before it allocates from the chunk again.
+ *
  */
 struct HeapItem;
 struct Chunk {
@@ -128,6 +139,13 @@ struct Chunk {
         quintptr bit = static_cast<quintptr>(1) << (index & (Bits - 1));
         *bitmap &= ~bit;
     }
+    // Returns true if the bit was not set before. Used when marking with several threads.
+    static bool testAndSetBit(quintptr *bitmap, size_t index) {
+        bitmap += index >> BitShift;
+        quintptr bit = static_cast<quintptr>(1) << (index & (Bits - 1));
+        QBasicAtomicInteger<quintptr> *word = reinterpret_cast<QBasicAtomicInteger<quintptr> *>(bitmap);
+        return !(word->fetchAndOrRelaxed(bit) & bit);
+    }
     static bool testBit(quintptr *bitmap, size_t index) {
 //        Q_ASSERT(index >= HeaderSize/SlotSize && index < ChunkSize/SlotSize);
         bitmap += index >> BitShift;
@@ -179,7 +197,10 @@ struct Chunk {
         return usedSlots;
     }
 
-    bool sweep();
+    bool sweep(bool keepBlackBits = false, std::vector<Heap::Base *> *deferredDestroys = nullptr);
+    void resetBlackBits() {
+        memset(blackBitmap, 0, sizeof(blackBitmap));
+    }
     void freeAll();
 
     void sortIntoBins(HeapItem **bins, uint nBins);
@@ -405,6 +405,8 @@ public:
 
     inline QQmlPropertyData *overrideData(QQmlPropertyData *) const;
     inline bool isAllowedInRevision(QQmlPropertyData *) const;
+    // Without overrides, looking up a name doesn't depend on the calling context.
+    bool hasPropertyOverrides() const { return _hasPropertyOverrides; }
 
     static QQmlPropertyData *property(QJSEngine *, QObject *, const QStringRef &,
                                               QQmlContextData *, QQmlPropertyData &);
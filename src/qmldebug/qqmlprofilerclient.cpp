@@ -156,6 +156,21 @@ void QQmlProfilerClient::memoryAllocation(QQmlProfilerDefinitions::MemoryType ty
     Q_UNUSED(amount);
 }
 
+void QQmlProfilerClient::allocationStatistics(
+        QQmlProfilerDefinitions::AllocationStatisticsType type, qint64 time, const QString &name,
+        const QQmlEventLocation &location, quint64 allocations, quint64 bytes, quint64 survivors,
+        quint64 survivedBytes)
+{
+    Q_UNUSED(type);
+    Q_UNUSED(time);
+    Q_UNUSED(name);
+    Q_UNUSED(location);
+    Q_UNUSED(allocations);
+    Q_UNUSED(bytes);
+    Q_UNUSED(survivors);
+    Q_UNUSED(survivedBytes);
+}
+
 void QQmlProfilerClient::inputEvent(QQmlProfilerDefinitions::InputEventType type, qint64 time,
                                     int a, int b)
 {
@@ -322,6 +337,22 @@ void QQmlProfilerClient::messageReceived(const QByteArray &data)
         qint64 delta;
         stream >> type >> delta;
         memoryAllocation((QQmlProfilerDefinitions::MemoryType)type, time, delta);
+    } else if (messageType == QQmlProfilerDefinitions::AllocationStatistics) {
+        if (!(d->features & one << QQmlProfilerDefinitions::ProfileAllocationStatistics))
+            return;
+        int type;
+        QString name;
+        QString file;
+        int line;
+        quint64 allocations;
+        quint64 bytes;
+        quint64 survivors;
+        quint64 survivedBytes;
+        stream >> type >> name >> file >> line >> allocations >> bytes >> survivors
+               >> survivedBytes;
+        allocationStatistics((QQmlProfilerDefinitions::AllocationStatisticsType)type, time,
+                             name, QQmlEventLocation(file, line, -1), allocations, bytes,
+                             survivors, survivedBytes);
     } else {
         int range;
         stream >> range;
@@ -96,6 +96,10 @@ private:
 
     virtual void memoryAllocation(QQmlProfilerDefinitions::MemoryType type, qint64 time,
                                   qint64 amount);
+    virtual void allocationStatistics(QQmlProfilerDefinitions::AllocationStatisticsType type,
+                                      qint64 time, const QString &name,
+                                      const QQmlEventLocation &location, quint64 allocations,
+                                      quint64 bytes, quint64 survivors, quint64 survivedBytes);
 
     virtual void inputEvent(QQmlProfilerDefinitions::InputEventType type, qint64 time, int a,
                             int b);
@@ -30,6 +30,7 @@
 #include <QtTest/QtTest>
 
 #include <private/qqmldata_p.h>
+#include <private/qjsengine_p.h>
 #include <qjsengine.h>
 #include <qjsvalueiterator.h>
 #include <qgraphicsitem.h>
@@ -39,6 +40,11 @@
 #include <qqmlcomponent.h>
 #include <stdlib.h>
 #include <private/qv4alloca_p.h>
+#include <private/qv4engine_p.h>
+#include <private/qv4isel_p.h>
+#include <private/qv4perfmap_p.h>
+#include <private/qv4regexpcache_p.h>
+#include <private/qv8engine_p.h>
 
 #ifdef Q_CC_MSVC
 #define NO_INLINE __declspec(noinline)
@@ -126,6 +132,9 @@ private slots:
     void reentrancy_objectCreation();
     void jsIncDecNonObjectProperty();
     void JSONparse();
+    void JSONparseRecords();
+    void JSONstringify();
+    void toJson();
     void arraySort();
     void lookupOnDisappearingProperty();
 
@@ -135,10 +144,17 @@ private slots:
     void dateRoundtripQtJSQt();
     void dateConversionJSQt();
     void dateConversionQtJS();
+    void dateLocalTimeCache();
     void functionPrototypeExtensions();
     void threadedEngine();
 
     void functionDeclarationsInConditionals();
+    void inlinedFunctionCalls_data();
+    void inlinedFunctionCalls();
+    void nonEscapingObjectLiterals_data();
+    void nonEscapingObjectLiterals();
+    void loopCounters_data();
+    void loopCounters();
 
     void arrayPop_QTBUG_35979();
     void array_unshift_QTBUG_52065();
@@ -146,6 +162,10 @@ private slots:
 
     void regexpLastMatch();
     void regexpLastIndex();
+    void regexpCacheEviction();
+    void regexpCacheJitLimit();
+    void regexpLiteralsCompiledOnUse();
+    void perfMap();
     void indexedAccesses();
 
     void prototypeChainGc();
@@ -2984,6 +3004,103 @@ void tst_QJSEngine::JSONparse()
     QVERIFY(ret.isObject());
 }
 
+void tst_QJSEngine::JSONparseRecords()
+{
+    // objects following each other on the same level share their class as long as the keys match
+    QJSEngine eng;
+    QJSValue ret = eng.evaluate(
+            "var text = '[{\"a\": 1, \"b\": \"x\", \"c\": {\"d\": 2.5}},'\n"
+            "         + ' {\"a\": 2, \"b\": \"y\", \"c\": {\"d\": -3}},'\n"
+            "         + ' {\"a\": 3, \"b\": \"z\"},'\n"
+            "         + ' {\"a\": 4, \"x\": 5, \"b\": 6},'\n"
+            "         + ' {\"a\": 7, \"a\": 8, \"\\\\u0062\": 9, \"0\": 10},'\n"
+            "         + ' {}, {\"a\\\\\"\": 11}, {\"a\": 12, \"b\": 123456789012, \"c\": [1, 2]}]';\n"
+            "var expected = [{a: 1, b: 'x', c: {d: 2.5}},\n"
+            "                {a: 2, b: 'y', c: {d: -3}},\n"
+            "                {a: 3, b: 'z'},\n"
+            "                {a: 4, x: 5, b: 6},\n"
+            "                {0: 10, a: 8, b: 9},\n"
+            "                {}, {'a\"': 11}, {a: 12, b: 123456789012, c: [1, 2]}];\n"
+            "JSON.stringify(JSON.parse(text)) === JSON.stringify(expected);");
+    QVERIFY2(!ret.isError(), qPrintable(ret.toString()));
+    QVERIFY(ret.toBool());
+
+    ret = eng.evaluate("JSON.parse('[{\"a\": 1}, {\"a\" 1}]');");
+    QVERIFY(ret.isError());
+    ret = eng.evaluate("JSON.parse('[{\"a\": 1}, {\"a\": 1, \"a\" 2}]');");
+    QVERIFY(ret.isError());
+}
+
+void tst_QJSEngine::JSONstringify()
+{
+    QJSEngine eng;
+    QJSValue ret = eng.evaluate(
+            "var o = {a: [1, 'x', null, undefined, function() {}, {}], b: {c: true, d: undefined},"
+            "         e: 'q\"\\\\\\n\\u0001\\u00e9', f: 1.5, g: NaN, h: new Number(3), i: [],"
+            "         j: {toJSON: function(key) { return key + '!'; }}};\n"
+            "[JSON.stringify(o), JSON.stringify(o, null, 2), JSON.stringify(o, ['b', 'f']),"
+            " JSON.stringify(o, function(k, v) { return k === 'a' ? undefined : v; }),"
+            " JSON.stringify(undefined), JSON.stringify(function() {})]");
+    QVERIFY2(!ret.isError(), qPrintable(ret.toString()));
+    QCOMPARE(ret.property(0).toString(),
+             QString::fromUtf8("{\"a\":[1,\"x\",null,null,null,{}],\"b\":{\"c\":true},"
+                               "\"e\":\"q\\\"\\\\\\n\\u0001\xc3\xa9\",\"f\":1.5,\"g\":null,\"h\":3,\"i\":[],"
+                               "\"j\":\"j!\"}"));
+    QCOMPARE(ret.property(1).toString(),
+             QString::fromUtf8("{\n  \"a\": [\n    1,\n    \"x\",\n    null,\n    null,\n    null,\n    {}\n  ],\n"
+                               "  \"b\": {\n    \"c\": true\n  },\n"
+                               "  \"e\": \"q\\\"\\\\\\n\\u0001\xc3\xa9\",\n  \"f\": 1.5,\n  \"g\": null,\n"
+                               "  \"h\": 3,\n  \"i\": [],\n  \"j\": \"j!\"\n}"));
+    QCOMPARE(ret.property(2).toString(), QStringLiteral("{\"b\":{},\"f\":1.5}"));
+    QVERIFY(!ret.property(3).toString().contains(QLatin1String("\"a\"")));
+    QVERIFY(ret.property(4).isUndefined());
+    QVERIFY(ret.property(5).isUndefined());
+
+    ret = eng.evaluate("var cycle = {a: {}}; cycle.a.b = cycle; JSON.stringify(cycle);");
+    QVERIFY(ret.isError());
+}
+
+void tst_QJSEngine::toJson()
+{
+    QJSEngine eng;
+    QJSValue value = eng.evaluate(
+            "({name: 'caf\\u00e9 \\ud83d\\ude00', lone: '\\ud83d', list: [1, 2.5, true, null],"
+            "  nested: {empty: {}, f: function() {}}})");
+    QVERIFY(value.isObject());
+
+    QCOMPARE(QJSEnginePrivate::toJson(&eng, value),
+             QByteArray("{\"name\":\"caf\xc3\xa9 \xf0\x9f\x98\x80\",\"lone\":\"\\ud83d\","
+                        "\"list\":[1,2.5,true,null],\"nested\":{\"empty\":{}}}"));
+    QCOMPARE(QJSEnginePrivate::toJson(&eng, value.property("list"), 1),
+             QByteArray("[\n 1,\n 2.5,\n true,\n null\n]"));
+    QCOMPARE(QJSEnginePrivate::toJson(&eng, QJSValue(42)), QByteArray("42"));
+    QCOMPARE(QJSEnginePrivate::toJson(&eng, QJSValue(QStringLiteral("a\"b"))), QByteArray("\"a\\\"b\""));
+    QVERIFY(QJSEnginePrivate::toJson(&eng, QJSValue()).isEmpty());
+    QVERIFY(QJSEnginePrivate::toJson(&eng, value.property("nested").property("f")).isEmpty());
+
+    QJSValue cycle = eng.evaluate("var cycle = {a: [1]}; cycle.a.push(cycle); cycle");
+    QVERIFY(QJSEnginePrivate::toJson(&eng, cycle).isEmpty());
+    QVERIFY(!eng.evaluate("1").isError()); // the exception has been cleared
+
+    // large values are written in pieces
+    QJSValue large = eng.evaluate(
+            "var large = [];\n"
+            "for (var i = 0; i < 20000; ++i)\n"
+            "    large.push({index: i, text: 'some text \\u00e4\\u00f6\\u00fc'});\n"
+            "large");
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QVERIFY(QJSEnginePrivate::writeJson(&eng, large, &buffer, 4));
+    QVERIFY(buffer.data().size() > 64 * 1024);
+    QCOMPARE(QString::fromUtf8(buffer.data()),
+             eng.evaluate("JSON.stringify(large, null, 4)").toString());
+
+    QBuffer readOnly;
+    QVERIFY(readOnly.open(QIODevice::ReadOnly));
+    QTest::ignoreMessage(QtWarningMsg, "QIODevice::write (QBuffer): ReadOnly device");
+    QVERIFY(!QJSEnginePrivate::writeJson(&eng, QJSValue(1), &readOnly));
+}
+
 void tst_QJSEngine::arraySort()
 {
     // tests that calling Array.sort with a bad sort function doesn't cause issues
@@ -3092,6 +3209,36 @@ void tst_QJSEngine::dateRoundtripJSQtJS()
     }
 }
 
+void tst_QJSEngine::dateLocalTimeCache()
+{
+#ifdef Q_OS_WIN
+    QSKIP("This test fails on Windows due to a bug in QDateTime.");
+#endif
+    QJSEngine eng;
+    QJSValue minutesOfDay = eng.evaluate(
+            "(function(t) { var d = new Date(t); return d.getHours() * 60 + d.getMinutes(); })");
+    QVERIFY(minutesOfDay.isCallable());
+
+    // fill the cache forwards, backwards and in random order
+    const qint64 start = QDateTime(QDate(2014, 1, 1), QTime(0, 0), Qt::UTC).toMSecsSinceEpoch();
+    const qint64 step = (5 * 60 + 17) * 60 * 1000;
+    const int count = 6000;
+    QVector<qint64> times;
+    for (int i = 0; i < count; ++i)
+        times << start + i * step;
+    for (int i = count; i > 0; --i)
+        times << start + i * step + count * step;
+    for (int i = 0; i < count; ++i)
+        times << start + ((i * 7919) % (2 * count)) * step;
+
+    for (qint64 t : qAsConst(times)) {
+        const QTime time = QDateTime::fromMSecsSinceEpoch(t).time();
+        const int result = minutesOfDay.call(QJSValueList() << double(t)).toInt();
+        if (result != time.hour() * 60 + time.minute())
+            QFAIL(qPrintable(QDateTime::fromMSecsSinceEpoch(t).toString()));
+    }
+}
+
 void tst_QJSEngine::dateRoundtripQtJSQt()
 {
 #ifdef Q_OS_WIN
@@ -3202,6 +3349,168 @@ void tst_QJSEngine::functionDeclarationsInConditionals()
     QCOMPARE(result.toBool(), true);
 }
 
+void tst_QJSEngine::inlinedFunctionCalls_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("simple")
+            << "(function() { function sq(x) { return x * x; }\n"
+               "  var s = 0; for (var i = 0; i < 10; ++i) s += sq(i); return s; })()"
+            << "285";
+    QTest::newRow("missing and extra arguments")
+            << "(function() { function f(a, b) { return String(a) + String(b); }\n"
+               "  return [f(1), f(1, 2, 3), f()].join(); })()"
+            << "1undefined,12,undefinedundefined";
+    QTest::newRow("no return value")
+            << "(function() { function f(x) { x = 1; } var r = f(2); return typeof r; })()"
+            << "undefined";
+    QTest::newRow("outer variables")
+            << "(function(n) { var count = 0; function inc(by) { count += by; return count; }\n"
+               "  inc(n); inc(2); return inc(n) + ',' + count + ',' + n; })(3)"
+            << "8,8,3";
+    QTest::newRow("nested helpers")
+            << "(function() { function add(a, b) { return a + b; }\n"
+               "  function mul(a, b) { var r = 0; for (var i = 0; i < b; ++i) r = add(r, a); return r; }\n"
+               "  function sq(x) { return mul(x, x); }\n"
+               "  return sq(7); })()"
+            << "49";
+    QTest::newRow("recursion")
+            << "(function() { function fac(n) { return n <= 1 ? 1 : n * fac(n - 1); }\n"
+               "  return fac(10); })()"
+            << "3628800";
+    QTest::newRow("reassigned function")
+            << "(function() { function f() { return 1; } var a = f(); f = function() { return 2; };\n"
+               "  return a + f(); })()"
+            << "3";
+    QTest::newRow("reassigned by nested function")
+            << "(function() { function f() { return 1; }\n"
+               "  function g() { f = function() { return 2; }; }\n"
+               "  var a = f(); g(); return a + f(); })()"
+            << "3";
+    QTest::newRow("reassigned by eval")
+            << "(function() { function f() { return 1; }\n"
+               "  var a = f(); eval('f = function() { return 2; }'); return a + f(); })()"
+            << "3";
+    QTest::newRow("called before assignment")
+            << "(function() { var r = typeof g(); function g() { return f; }\n"
+               "  var f = function() { return 1; }; return r + ',' + f(); })()"
+            << "undefined,1";
+    QTest::newRow("exception")
+            << "(function() { function check(x) { if (x > 2) throw new RangeError('x'); return x; }\n"
+               "  var r = 0; for (var i = 0; i < 5; ++i) r += check(i); return r; })()"
+            << "RangeError: x";
+    QTest::newRow("this")
+            << "(function() { 'use strict'; function f() { return this; } return typeof f(); })()"
+            << "undefined";
+    QTest::newRow("arguments")
+            << "(function() { function f() { return arguments.length; } return f(1, 2, 3); })()"
+            << "3";
+}
+
+void tst_QJSEngine::inlinedFunctionCalls()
+{
+    QFETCH(QString, code);
+    QFETCH(QString, expected);
+
+    QJSEngine eng;
+    QJSValue result = eng.evaluate(code);
+    QCOMPARE(result.toString(), expected);
+}
+
+void tst_QJSEngine::nonEscapingObjectLiterals_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("reads")
+            << "(function(a, b) { var p = {x: a, y: b, z: 3}; return p.x * p.y + p.z; })(4, 5)"
+            << "23";
+    QTest::newRow("loop")
+            << "(function() { var s = 0;\n"
+               "  for (var i = 0; i < 10; ++i) { var p = {x: i, y: i + 1}; s += p.x * p.y; }\n"
+               "  return s; })()"
+            << "330";
+    QTest::newRow("duplicate keys")
+            << "(function() { var p = {x: 1, x: 2}; return p.x; })()"
+            << "2";
+    QTest::newRow("inlined constructor")
+            << "(function() { function point(x, y) { return {x: x, y: y}; }\n"
+               "  var p = point(2, 3); return p.x + p.y; })()"
+            << "5";
+    QTest::newRow("missing property")
+            << "(function() { var p = {x: 1}; return typeof p.y + ',' + typeof p.toString; })()"
+            << "undefined,function";
+    QTest::newRow("written")
+            << "(function() { var p = {x: 1}; p.x = 2; return p.x; })()"
+            << "2";
+    QTest::newRow("escaping")
+            << "(function() { var p = {x: 1}; var q = p; q.x = 3; return p.x; })()"
+            << "3";
+    QTest::newRow("accessor")
+            << "(function() { var n = 0; var p = {get x() { return ++n; }}; p.x; return p.x; })()"
+            << "2";
+    QTest::newRow("array entries")
+            << "(function() { var p = {0: 'a', length: 1}; return Array.prototype.join.call(p); })()"
+            << "a";
+}
+
+void tst_QJSEngine::nonEscapingObjectLiterals()
+{
+    QFETCH(QString, code);
+    QFETCH(QString, expected);
+
+    QJSEngine eng;
+    QJSValue result = eng.evaluate(code);
+    QCOMPARE(result.toString(), expected);
+}
+
+void tst_QJSEngine::loopCounters_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("int32 bound")
+            << "(function() { var n = 100; var s = 0;\n"
+               "  for (var i = 0; i < n; ++i) s += i; return s + ',' + i; })()"
+            << "4950,100";
+    QTest::newRow("bound near INT_MAX")
+            << "(function() { var n = 2147483647; var c = 0;\n"
+               "  for (var i = 2147483640; i < n; ++i) ++c; return c + ',' + i; })()"
+            << "7,2147483647";
+    QTest::newRow("less or equal INT_MAX")
+            << "(function() { var n = 2147483647; var c = 0;\n"
+               "  for (var i = 2147483645; i <= n; ++i) ++c; return c + ',' + i; })()"
+            << "3,2147483648";
+    QTest::newRow("double bound")
+            << "(function() { var n = 2.5; var c = 0;\n"
+               "  for (var i = 0; i < n; ++i) ++c; return c + ',' + i; })()"
+            << "3,3";
+    QTest::newRow("modified in body")
+            << "(function() { var n = 2147483647; var c = 0;\n"
+               "  for (var i = 2147483640; i < n; ++i) { if (i === 2147483645) i += 10; ++c; }\n"
+               "  return c + ',' + i; })()"
+            << "6,2147483656";
+    QTest::newRow("invariant product")
+            << "(function(a) { var x = +a; var s = 0;\n"
+               "  for (var i = 0; i < 10; ++i) s += x * 2; return s; })(3)"
+            << "60";
+    QTest::newRow("invariant in a loop that doesn't run")
+            << "(function(a) { var x = +a; var s = 0;\n"
+               "  for (var i = 0; i < 0; ++i) s += x / 0; return s; })(3)"
+            << "0";
+}
+
+void tst_QJSEngine::loopCounters()
+{
+    QFETCH(QString, code);
+    QFETCH(QString, expected);
+
+    QJSEngine eng;
+    QJSValue result = eng.evaluate(code);
+    QCOMPARE(result.toString(), expected);
+}
+
 void tst_QJSEngine::arrayPop_QTBUG_35979()
 {
     QJSEngine eng;
@@ -3319,6 +3628,153 @@ void tst_QJSEngine::regexpLastIndex()
     QVERIFY(result.toBool());
 }
 
+void tst_QJSEngine::regexpCacheEviction()
+{
+    // Evicted patterns drop their compiled code. Whoever still holds them must get the same
+    // results, and patterns created again after eviction must work, too.
+    qputenv("QV4_REGEXP_CACHE_SIZE", "4");
+    QJSEngine eng;
+    qunsetenv("QV4_REGEXP_CACHE_SIZE");
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(&eng);
+    QVERIFY(v4->regExpCache);
+    QCOMPARE(v4->regExpCache->maxEntries, 4);
+    const QV4::RegExpCache::Statistics before = v4->regExpCache->statistics();
+
+    QJSValue result = eng.evaluate(
+            "function literal() { return /x+y/; }\n"
+            "var kept = literal();\n"
+            "var ok = true;\n"
+            "for (var i = 0; i < 100; ++i) {\n"
+            "    var rx = new RegExp('a' + i + '(b+)');\n"
+            "    var m = rx.exec('za' + i + 'bbb');\n"
+            "    ok = ok && m !== null && m[1] === 'bbb';\n"
+            "    ok = ok && new RegExp('a' + i + '(b+)').test('a' + i + 'b');\n"
+            "    ok = ok && new RegExp('a' + (i >> 1) + '(b+)').test('a' + (i >> 1) + 'b');\n"
+            "}\n"
+            "ok && 'xxy-xy'.replace(kept, 'z') === 'z-xy' && new RegExp('a0(b+)').test('a0b')");
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(result.toBool());
+
+    const QV4::RegExpCache::Statistics stats = v4->regExpCache->statistics();
+    QVERIFY(stats.evictions > before.evictions);
+    QVERIFY(stats.entries <= 4);
+    QVERIFY(stats.hits - before.hits >= 100); // the second pattern of every iteration
+    QVERIFY(stats.misses - before.misses >= 100);
+
+    // The literal's pattern got evicted. Evaluating the literal again has to look it up and
+    // compile it again, once. The same goes for exec() on an object that still holds the evicted
+    // pattern, which then finds the pattern compiled for the literal.
+    QV4::RegExpCache::Statistics last = stats;
+    QVERIFY(eng.evaluate("literal() instanceof RegExp").toBool());
+    QCOMPARE(v4->regExpCache->statistics().misses, last.misses + 1);
+    QCOMPARE(v4->regExpCache->statistics().hits, last.hits);
+
+    last = v4->regExpCache->statistics();
+    QVERIFY(eng.evaluate("literal() instanceof RegExp").toBool());
+    QCOMPARE(v4->regExpCache->statistics().misses, last.misses);
+
+    last = v4->regExpCache->statistics();
+    QCOMPARE(eng.evaluate("kept.exec('zxxy')[0]").toString(), QStringLiteral("xxy"));
+    QCOMPARE(v4->regExpCache->statistics().hits, last.hits + 1);
+    QCOMPARE(v4->regExpCache->statistics().misses, last.misses);
+
+    last = v4->regExpCache->statistics();
+    QVERIFY(eng.evaluate("kept.test('xy')").toBool());
+    QCOMPARE(v4->regExpCache->statistics().hits, last.hits);
+}
+
+void tst_QJSEngine::regexpCacheJitLimit()
+{
+    // With a JIT code limit of one byte, every pattern compiled with the JIT evicts all others.
+    qputenv("QV4_REGEXP_CACHE_JIT_SIZE", "1");
+    QJSEngine eng;
+    qunsetenv("QV4_REGEXP_CACHE_JIT_SIZE");
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(&eng);
+    QVERIFY(v4->regExpCache);
+    QCOMPARE(v4->regExpCache->maxJitCodeSize, size_t(1));
+
+    eng.evaluate("var first = new RegExp('a(b+)c');");
+    if (!v4->regExpCache->statistics().jitCodeSize)
+        QSKIP("Regular expressions are not compiled with the JIT here.");
+    const QV4::RegExpCache::Statistics before = v4->regExpCache->statistics();
+    QCOMPARE(before.entries, 1);
+
+    QJSValue result = eng.evaluate(
+            "var ok = true;\n"
+            "for (var i = 0; i < 50; ++i)\n"
+            "    ok = ok && new RegExp('x' + i + '(y+)').exec('x' + i + 'yy')[1] === 'yy';\n"
+            "ok && first.test('abbc')");
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(result.toBool());
+
+    const QV4::RegExpCache::Statistics stats = v4->regExpCache->statistics();
+    QVERIFY(stats.evictions > before.evictions);
+    QVERIFY(stats.entries <= 1); // far below maxEntries
+    QVERIFY(stats.jitCodeSize > 0);
+}
+
+void tst_QJSEngine::regexpLiteralsCompiledOnUse()
+{
+    // Literals are compiled the first time they are evaluated. Every evaluation must still
+    // yield a fresh object, and literals that are never reached must not get in the way.
+    QJSEngine eng;
+    QJSValue result = eng.evaluate(
+            "function unused() { return /never(used)/i; }\n"
+            "function make() { return /a(b+)/g; }\n"
+            "var first = make();\n"
+            "first.exec('abb');\n"
+            "var second = make();\n"
+            "first !== second && first.lastIndex === 3 && second.lastIndex === 0\n"
+            "    && second.global && /ABC/i.test('abc') && /^b/m.test('a\\nb')\n"
+            "    && make().exec('xabbb')[1] === 'bbb'");
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(result.toBool());
+}
+
+void tst_QJSEngine::perfMap()
+{
+#if !defined(Q_OS_LINUX)
+    QSKIP("Perf maps are only written on Linux.");
+#else
+    // Code compiled while the map is enabled shows up in /tmp/perf-<pid>.map, one
+    // "<address> <size> <name>" line per function or pattern.
+    QV4::PerfMap::setEnabled(true);
+    QJSEngine eng;
+    if (QV8Engine::getV4(&eng)->iselFactory->codeGeneratorName != QLatin1String("jit")) {
+        QV4::PerfMap::setEnabled(false);
+        QSKIP("Nothing is compiled to machine code without the JIT.");
+    }
+    QJSValue result = eng.evaluate(
+            "function perfMapFunction(s) { return /perf+Map(\\d+)/g.exec(s)[1]; }\n"
+            "perfMapFunction('perffMap42')", QStringLiteral("perfmaptest.js"));
+    QV4::PerfMap::setEnabled(false);
+    QCOMPARE(result.toString(), QStringLiteral("42"));
+
+    QFile map(QStringLiteral("/tmp/perf-%1.map").arg(QCoreApplication::applicationPid()));
+    QVERIFY2(map.open(QIODevice::ReadOnly | QIODevice::Text), qPrintable(map.errorString()));
+    bool foundFunction = false;
+    bool foundRegExp = false;
+    while (!map.atEnd()) {
+        const QByteArray line = map.readLine().trimmed();
+        const int addressEnd = line.indexOf(' ');
+        const int sizeEnd = line.indexOf(' ', addressEnd + 1);
+        QVERIFY2(addressEnd > 0 && sizeEnd > addressEnd, line.constData());
+        bool ok = false;
+        QVERIFY2(line.left(addressEnd).toULongLong(&ok, 16) && ok, line.constData());
+        QVERIFY2(line.mid(addressEnd + 1, sizeEnd - addressEnd - 1).toULongLong(&ok, 16) && ok,
+                 line.constData());
+
+        const QByteArray name = line.mid(sizeEnd + 1);
+        if (name.startsWith("perfMapFunction (") && name.endsWith("perfmaptest.js:1)"))
+            foundFunction = true;
+        else if (name == "RegExp /perf+Map(\\d+)/g")
+            foundRegExp = true;
+    }
+    QVERIFY(foundFunction);
+    QVERIFY(foundRegExp);
+#endif
+}
+
 void tst_QJSEngine::indexedAccesses()
 {
     QJSEngine engine;
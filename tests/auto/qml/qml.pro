@@ -72,6 +72,7 @@ PRIVATETESTS += \
     qqmlimport \
     qqmlobjectmodel \
     qv4mm \
+    qv4tiering \
     ecmascripttests
 }
 
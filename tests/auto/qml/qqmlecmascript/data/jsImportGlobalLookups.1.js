@@ -0,0 +1,7 @@
+.import "jsImportGlobalLookups.2.js" as Other
+
+var base = 10
+
+function compute() {
+    return base + Other.value + root.offset
+}
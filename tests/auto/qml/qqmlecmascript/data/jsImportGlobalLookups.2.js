@@ -0,0 +1 @@
+var value = 32
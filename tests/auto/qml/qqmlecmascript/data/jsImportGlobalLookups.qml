@@ -0,0 +1,8 @@
+import QtQml 2.0
+import "jsImportGlobalLookups.1.js" as Script
+
+QtObject {
+    id: root
+    property int offset: 5
+    property int result: Script.compute()
+}
@@ -0,0 +1,45 @@
+import QtQml 2.0
+
+QtObject {
+    property var proto: ({ value: 1 })
+
+    function sum(objects) {
+        var total = 0;
+        for (var i = 0; i < 10 * objects.length; ++i)
+            total += objects[i % objects.length].value;
+        return total;
+    }
+
+    function shapes(count) {
+        var objects = [];
+        for (var i = 0; i < count; ++i) {
+            var o = {};
+            // a different property before value gives every object its own internal class
+            o["p" + i] = i;
+            o.value = 1;
+            objects.push(o);
+        }
+        return objects;
+    }
+
+    function others() {
+        var inherited = Object.create(proto);
+        var accessor = { get value() { return 1; } };
+        return [inherited, accessor];
+    }
+
+    function fewShapes() {
+        return sum(shapes(4)) === 40 && sum(shapes(4).concat(others())) === 60;
+    }
+
+    // more internal classes than the polymorphic cache holds
+    function manyShapes() {
+        var many = shapes(20).concat(others(), ["string"]);
+        var ok = isNaN(sum(many));
+        many.pop();
+        ok = ok && sum(many) === 220;
+        proto.value = 2;
+        ok = ok && sum(many) === 230;
+        return ok;
+    }
+}
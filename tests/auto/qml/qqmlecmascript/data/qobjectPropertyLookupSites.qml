@@ -0,0 +1,11 @@
+import QtQml 2.0
+
+QtObject {
+    property QtObject first: QtObject { property int value: 1 }
+    property QtObject second: QtObject { property int value: 2; property int other: 3 }
+
+    function read(o) { return o.value; }
+    function write(o, v) { o.value = v; }
+    function readPlain() { return read({ value: 4 }); }
+    function writePlain() { write({}, 5); }
+}
@@ -0,0 +1,35 @@
+import QtQml 2.0
+
+QtObject {
+    property QtObject first: QtObject { property int value: 1 }
+    property QtObject second: QtObject { property int value: 2; property int other: 3 }
+    property QtObject timer: Timer { interval: 5 }
+    property bool result: false
+
+    function sum(objects) {
+        var total = 0;
+        for (var i = 0; i < 100; ++i)
+            total += objects[i % objects.length].value;
+        return total;
+    }
+
+    function assign(objects) {
+        for (var i = 0; i < 100; ++i)
+            objects[i % objects.length].value = i;
+    }
+
+    Component.onCompleted: {
+        var ok = sum([first]) === 100;
+        ok = ok && sum([first, second]) === 150;
+        ok = ok && sum([first, { value: 5 }]) === 300;
+        assign([first, second]);
+        ok = ok && first.value === 98 && second.value === 99;
+        var plain = { value: 0 };
+        assign([first, plain]);
+        ok = ok && first.value === 98 && plain.value === 99;
+        for (var i = 0; i < 10; ++i)
+            timer.interval = timer.interval + 1;
+        ok = ok && timer.interval === 15;
+        result = ok;
+    }
+}
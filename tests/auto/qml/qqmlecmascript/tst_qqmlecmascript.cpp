@@ -47,6 +47,9 @@
 #include <private/qv4object_p.h>
 #include <private/qqmlcomponentattached_p.h>
 #include <private/qv4objectiterator_p.h>
+#include <private/qv4lookup_p.h>
+#include <private/qqmlcomponent_p.h>
+#include <private/qqmldata_p.h>
 
 #ifdef Q_CC_MSVC
 #define NO_INLINE __declspec(noinline)
@@ -338,6 +341,9 @@ private slots:
     void freeze_empty_object();
     void singleBlockLoops();
     void qtbug_60547();
+    void qobjectPropertyLookups();
+    void polymorphicLookups();
+    void jsImportGlobalLookups();
 
 private:
 //    static void propertyVarWeakRefCallback(v8::Persistent<v8::Value> object, void* parameter);
@@ -8257,6 +8263,115 @@ void tst_qqmlecmascript::qtbug_60547()
     QCOMPARE(object->property("counter"), QVariant(int(1)));
 }
 
+// Returns the only lookup of \a type for \a name in the compilation unit of \a component.
+static QV4::Lookup *findLookup(QQmlComponent *component, QV4::CompiledData::Lookup::Type type, const QString &name)
+{
+    QV4::CompiledData::CompilationUnit *unit = QQmlComponentPrivate::get(component)->compilationUnit.data();
+    if (!unit || !unit->runtimeLookups)
+        return nullptr;
+
+    const QV4::CompiledData::Lookup *compiledLookups = unit->data->lookupTable();
+    QV4::Lookup *found = nullptr;
+    for (uint i = 0; i < unit->data->lookupTableSize; ++i) {
+        if (uint(compiledLookups[i].type_and_flags) != uint(type)
+                || unit->data->stringAt(compiledLookups[i].nameIndex) != name)
+            continue;
+        if (found)
+            return nullptr;
+        found = unit->runtimeLookups + i;
+    }
+    return found;
+}
+
+// Property lookups on QObjects are cached per property cache and need to
+// give the same results as uncached ones when the objects at a site vary.
+void tst_qqmlecmascript::qobjectPropertyLookups()
+{
+    QQmlComponent component(&engine, testFileUrl("qobjectPropertyLookups.qml"));
+    QScopedPointer<QObject> object(component.create());
+    QVERIFY2(!object.isNull(), qPrintable(component.errorString()));
+    QVERIFY(object->property("result").toBool());
+
+    QQmlComponent sites(&engine, testFileUrl("qobjectPropertyLookupSites.qml"));
+    QScopedPointer<QObject> root(sites.create());
+    QVERIFY2(!root.isNull(), qPrintable(sites.errorString()));
+    QObject *first = root->property("first").value<QObject *>();
+    QObject *second = root->property("second").value<QObject *>();
+    QVERIFY(first && second);
+    QV4::Lookup *getter = findLookup(&sites, QV4::CompiledData::Lookup::Type_Getter, QStringLiteral("value"));
+    QV4::Lookup *setter = findLookup(&sites, QV4::CompiledData::Lookup::Type_Setter, QStringLiteral("value"));
+    QVERIFY(getter && setter);
+
+    QVariant result;
+    QVERIFY(QMetaObject::invokeMethod(root.data(), "read", Q_RETURN_ARG(QVariant, result),
+                                      Q_ARG(QVariant, QVariant::fromValue(first))));
+    QCOMPARE(result.toInt(), 1);
+    QVERIFY(getter->getter == QV4::Lookup::getterQObject);
+    QCOMPARE(getter->qobjectLookup.propertyCache, QQmlData::get(first)->propertyCache);
+
+    // a different property cache misses and the site caches the new one
+    QVERIFY(QMetaObject::invokeMethod(root.data(), "read", Q_RETURN_ARG(QVariant, result),
+                                      Q_ARG(QVariant, QVariant::fromValue(second))));
+    QCOMPARE(result.toInt(), 2);
+    QVERIFY(getter->getter == QV4::Lookup::getterQObject);
+    QCOMPARE(getter->qobjectLookup.propertyCache, QQmlData::get(second)->propertyCache);
+
+    // a plain object falls back to the generic lookups
+    QVERIFY(QMetaObject::invokeMethod(root.data(), "readPlain", Q_RETURN_ARG(QVariant, result)));
+    QCOMPARE(result.toInt(), 4);
+    QVERIFY(getter->getter != QV4::Lookup::getterQObject);
+
+    QVERIFY(QMetaObject::invokeMethod(root.data(), "write", Q_ARG(QVariant, QVariant::fromValue(first)),
+                                      Q_ARG(QVariant, 10)));
+    QCOMPARE(first->property("value").toInt(), 10);
+    QVERIFY(setter->setter == QV4::Lookup::setterQObject);
+    QCOMPARE(setter->qobjectLookup.propertyCache, QQmlData::get(first)->propertyCache);
+
+    QVERIFY(QMetaObject::invokeMethod(root.data(), "write", Q_ARG(QVariant, QVariant::fromValue(second)),
+                                      Q_ARG(QVariant, 11)));
+    QCOMPARE(second->property("value").toInt(), 11);
+    QCOMPARE(first->property("value").toInt(), 10);
+    QVERIFY(setter->setter == QV4::Lookup::setterQObject);
+    QCOMPARE(setter->qobjectLookup.propertyCache, QQmlData::get(second)->propertyCache);
+
+    QVERIFY(QMetaObject::invokeMethod(root.data(), "writePlain"));
+    QVERIFY(setter->setter != QV4::Lookup::setterQObject);
+}
+
+void tst_qqmlecmascript::polymorphicLookups()
+{
+    QQmlComponent component(&engine, testFileUrl("polymorphicLookups.qml"));
+    QScopedPointer<QObject> object(component.create());
+    QVERIFY2(!object.isNull(), qPrintable(component.errorString()));
+    QV4::Lookup *getter = findLookup(&component, QV4::CompiledData::Lookup::Type_Getter, QStringLiteral("value"));
+    QVERIFY(getter);
+
+    QVariant result;
+    QVERIFY(QMetaObject::invokeMethod(object.data(), "fewShapes", Q_RETURN_ARG(QVariant, result)));
+    QVERIFY(result.toBool());
+    QVERIFY(getter->getter == QV4::Lookup::getterPolymorphic);
+    QVERIFY(getter->polymorphicCache->count > 2);
+    QVERIFY(getter->polymorphicCache->count <= QV4::PolymorphicLookupCache::Size);
+    QVERIFY(getter->polymorphicCache->hits > 0);
+
+    QVERIFY(QMetaObject::invokeMethod(object.data(), "manyShapes", Q_RETURN_ARG(QVariant, result)));
+    QVERIFY(result.toBool());
+    QVERIFY(getter->getter == QV4::Lookup::getterMegamorphic);
+    QV4::LookupStubCache *stubCache = QV8Engine::getV4(&engine)->lookupStubCache;
+    QVERIFY(stubCache);
+    QVERIFY(stubCache->hits > 0);
+}
+
+// Names in functions of imported scripts are resolved through the QML context,
+// not through global lookups on the global object.
+void tst_qqmlecmascript::jsImportGlobalLookups()
+{
+    QQmlComponent component(&engine, testFileUrl("jsImportGlobalLookups.qml"));
+    QScopedPointer<QObject> object(component.create());
+    QVERIFY2(!object.isNull(), qPrintable(component.errorString()));
+    QCOMPARE(object->property("result").toInt(), 47);
+}
+
 QTEST_MAIN(tst_qqmlecmascript)
 
 #include "tst_qqmlecmascript.moc"
@@ -28,7 +28,20 @@
 
 #include <qtest.h>
 #include <QQmlEngine>
+#include <QJSEngine>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <private/qjsengine_p.h>
 #include <private/qv4mm_p.h>
+#include <private/qv4engine_p.h>
+#include <private/qv8engine_p.h>
+#include <private/qv4function_p.h>
+#include <private/qv4string_p.h>
+#include <private/qv4arraydata_p.h>
 
 class tst_qv4mm : public QObject
 {
@@ -37,8 +50,36 @@ class tst_qv4mm : public QObject
 private slots:
     void gcStats();
     void tweaks();
+    void generationalGC();
+    void incrementalGC();
+    void concurrentSweep();
+    void parallelMarking();
+    void releaseFreeMemory();
+    void defragment();
+    void allocationStatistics();
+    void heapSnapshot();
+    void gcPacing();
+    void growHugeArrays();
+    void packedArrays();
 };
 
+// Stores young objects into old ones, so that they are only reachable through objects that
+// got modified after they were last marked.
+static const char youngIntoOldScript[] =
+        "var old = [];\n"
+        "for (var i = 0; i < 1000; ++i)\n"
+        "    old.push({ value: -1 });\n"
+        "gc();\n"
+        "for (var i = 0; i < 200000; ++i) {\n"
+        "    var young = { value: i, str: 'v' + i };\n"
+        "    if (i % 200 === 0)\n"
+        "        old[i / 200].child = young;\n"
+        "}\n"
+        "var ok = true;\n"
+        "for (var i = 0; i < 1000; ++i)\n"
+        "    ok = ok && old[i].child.value === i * 200 && old[i].child.str === 'v' + (i * 200);\n"
+        "ok;";
+
 void tst_qv4mm::gcStats()
 {
     qputenv(QV4_MM_STATS, "1");
@@ -53,6 +94,385 @@ void tst_qv4mm::tweaks()
     QQmlEngine engine;
 }
 
+void tst_qv4mm::generationalGC()
+{
+    qputenv(QV4_MM_SOFT_DIRTY_PAGES, "1");
+    qputenv(QV4_MM_GENERATIONAL_GC, "1");
+    QJSEngine engine;
+    qunsetenv(QV4_MM_GENERATIONAL_GC);
+    qunsetenv(QV4_MM_SOFT_DIRTY_PAGES);
+    QV4::MemoryManager *mm = QV8Engine::getV4(&engine)->memoryManager;
+    if (!mm->generationalGC)
+        QSKIP("Soft-dirty page tracking is not available.");
+
+    engine.installExtensions(QJSEngine::GarbageCollectionExtension);
+    QJSValue result = engine.evaluate(QString::fromLatin1(youngIntoOldScript));
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(result.toBool());
+    QVERIFY(mm->minorCollections > 0);
+}
+
+void tst_qv4mm::incrementalGC()
+{
+    qputenv(QV4_MM_SOFT_DIRTY_PAGES, "1");
+    QJSEngine engine;
+    qunsetenv(QV4_MM_SOFT_DIRTY_PAGES);
+    QV4::MemoryManager *mm = QV8Engine::getV4(&engine)->memoryManager;
+    if (!mm->useSoftDirtyPages)
+        QSKIP("Soft-dirty page tracking is not available.");
+
+    engine.installExtensions(QJSEngine::GarbageCollectionExtension);
+    QJSEnginePrivate::setGarbageCollectionFrameBudget(&engine, 1);
+    QCOMPARE(QJSEnginePrivate::garbageCollectionFrameBudget(&engine), 1);
+
+    QJSValue result = engine.evaluate(QString::fromLatin1(youngIntoOldScript));
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(result.toBool());
+    QTRY_VERIFY(!mm->isIncrementalMarking());
+
+    // a collection that isn't forced starts marking, and the frames finish it
+    const uint slices = mm->incrementalSlices;
+    mm->runGC();
+    QVERIFY(mm->isIncrementalMarking());
+    QVERIFY(mm->incrementalSlices > slices);
+    QTRY_VERIFY(!mm->isIncrementalMarking());
+    QVERIFY(engine.evaluate(QStringLiteral("old[999].child.value === 199800")).toBool());
+}
+
+void tst_qv4mm::concurrentSweep()
+{
+    qputenv(QV4_MM_CONCURRENT_SWEEP, "1");
+    QJSEngine engine;
+    qunsetenv(QV4_MM_CONCURRENT_SWEEP);
+    engine.installExtensions(QJSEngine::GarbageCollectionExtension);
+
+    QJSValue result = engine.evaluate(QString::fromLatin1(youngIntoOldScript));
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(result.toBool());
+
+    QV4::MemoryManager *mm = QV8Engine::getV4(&engine)->memoryManager;
+    QVERIFY(mm->concurrentSweep);
+    mm->runGC();
+    // while the chunks are being swept, the memory stats must still add up
+    const size_t used = mm->getUsedMem();
+    QVERIFY(used > 0);
+    QVERIFY(used <= mm->getAllocatedMem());
+    QVERIFY(engine.evaluate(QStringLiteral("old[999].child.value === 199800")).toBool());
+}
+
+void tst_qv4mm::parallelMarking()
+{
+#ifndef Q_COMPILER_THREAD_LOCAL
+    QSKIP("Parallel marking needs thread_local support.");
+#endif
+    QJSEngine engine;
+    engine.installExtensions(QJSEngine::GarbageCollectionExtension);
+    QJSEnginePrivate::setGarbageCollectionThreadCount(&engine, 4);
+    QCOMPARE(QJSEnginePrivate::garbageCollectionThreadCount(&engine), 4);
+
+    // The wrapper's markObjects() looks at the QObject, so it must stay on this thread.
+    QObject *object = new QObject;
+    object->setObjectName(QStringLiteral("wrapped"));
+    engine.globalObject().setProperty(QStringLiteral("wrapped"), engine.newQObject(object));
+
+    QJSValue result = engine.evaluate(QString::fromLatin1(youngIntoOldScript));
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(result.toBool());
+
+    QV4::MemoryManager *mm = QV8Engine::getV4(&engine)->memoryManager;
+    const auto before = mm->parallelMarkingStatistics;
+    engine.collectGarbage();
+    QCOMPARE(mm->parallelMarkingStatistics.collections, before.collections + 1);
+    QVERIFY(mm->parallelMarkingStatistics.markedObjects > before.markedObjects + 1000);
+    QVERIFY(mm->parallelMarkingStatistics.deferredObjects > before.deferredObjects);
+
+    QVERIFY(engine.evaluate(QStringLiteral("old[999].child.value === 199800")).toBool());
+    QCOMPARE(engine.evaluate(QStringLiteral("wrapped.objectName")).toString(), QStringLiteral("wrapped"));
+}
+
+void tst_qv4mm::releaseFreeMemory()
+{
+    const size_t limit = 4 * 65536;
+    qputenv(QV4_MM_RETAINED_MEMORY_LIMIT, QByteArray::number(int(limit)));
+    QJSEngine engine;
+    qunsetenv(QV4_MM_RETAINED_MEMORY_LIMIT);
+    QV4::MemoryManager *mm = QV8Engine::getV4(&engine)->memoryManager;
+    QCOMPARE(mm->retainedMemoryLimit, limit);
+
+    QJSValue result = engine.evaluate(QStringLiteral(
+            "var data = [];\n"
+            "for (var i = 0; i < 100000; ++i)\n"
+            "    data.push({ index: i });\n"
+            "data.length;"));
+    QCOMPARE(result.toInt(), 100000);
+    const size_t allocatedWithData = mm->getAllocatedMem();
+
+    engine.evaluate(QStringLiteral("data = null;"));
+    engine.collectGarbage();
+    QVERIFY(mm->getAllocatedMem() < allocatedWithData);
+    QVERIFY(mm->getRetainedMem() <= limit);
+}
+
+void tst_qv4mm::defragment()
+{
+    qputenv(QV4_MM_DEFRAGMENT, "1");
+    QJSEngine engine;
+    qunsetenv(QV4_MM_DEFRAGMENT);
+    engine.installExtensions(QJSEngine::GarbageCollectionExtension);
+    QV4::MemoryManager *mm = QV8Engine::getV4(&engine)->memoryManager;
+
+    // keep a few survivors spread out over many chunks
+    QJSValue result = engine.evaluate(QStringLiteral(
+            "var survivors = [];\n"
+            "var garbage = [];\n"
+            "for (var i = 0; i < 200000; ++i) {\n"
+            "    var o = { index: i };\n"
+            "    if (i % 100 === 0)\n"
+            "        survivors.push(o);\n"
+            "    else\n"
+            "        garbage.push(o);\n"
+            "}\n"
+            "garbage = null;\n"
+            "gc();\n"
+            "survivors.length;"));
+    QCOMPARE(result.toInt(), 2000);
+    QVERIFY(!mm->blockAllocator.sparseChunks.empty());
+
+    // allocating again must not touch the survivors in the sparse chunks
+    result = engine.evaluate(QStringLiteral(
+            "var fresh = [];\n"
+            "for (var i = 0; i < 100000; ++i)\n"
+            "    fresh.push({ index: -i });\n"
+            "var ok = true;\n"
+            "for (var i = 0; i < survivors.length; ++i)\n"
+            "    ok = ok && survivors[i].index === i * 100;\n"
+            "ok;"));
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(result.toBool());
+}
+
+void tst_qv4mm::allocationStatistics()
+{
+    QJSEngine engine;
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(&engine);
+    QV4::MemoryManager *mm = v4->memoryManager;
+    QVERIFY(!mm->isTrackingAllocations());
+    mm->setAllocationTracking(true);
+
+    QJSValue result = engine.evaluate(QStringLiteral(
+            "function allocate() {\n"
+            "    var data = [];\n"
+            "    for (var i = 0; i < 1000; ++i)\n"
+            "        data.push({ index: i });\n"
+            "    return data;\n"
+            "}\n"
+            "var kept = allocate();\n"
+            "kept.length;"), QStringLiteral("allocations.js"));
+    QCOMPARE(result.toInt(), 1000);
+    engine.collectGarbage();
+
+    const QV4::AllocationStatistics *stats = mm->allocationStatistics();
+    QVERIFY(stats);
+    QCOMPARE(stats->collections, 1u);
+    const QV4::AllocationCounters objects = stats->types.value(QV4::Object::staticVTable());
+    QVERIFY(objects.allocations >= 1000);
+    QVERIFY(objects.bytes >= objects.allocations * sizeof(QV4::Heap::Object));
+    QVERIFY(objects.survivors >= 1000);
+    QVERIFY(objects.survivedBytes <= objects.bytes);
+
+    bool foundSite = false;
+    for (auto it = stats->sites.cbegin(), end = stats->sites.cend(); it != end; ++it) {
+        QV4::Function *function = it.key().first;
+        if (function && function->name()->toQString() == QLatin1String("allocate")
+                && it.key().second == 4) {
+            QCOMPARE(function->sourceFile(), QStringLiteral("allocations.js"));
+            QVERIFY(it->allocations >= 1000);
+            foundSite = true;
+        }
+    }
+    QVERIFY(foundSite);
+
+    mm->resetAllocationStatistics();
+    QVERIFY(stats->types.isEmpty());
+    QVERIFY(stats->sites.isEmpty());
+    mm->setAllocationTracking(false);
+    QVERIFY(!mm->allocationStatistics());
+}
+
+void tst_qv4mm::heapSnapshot()
+{
+    QJSEngine engine;
+    QObject *object = new QObject;
+    object->setObjectName(QStringLiteral("leaked"));
+    engine.globalObject().setProperty(QStringLiteral("leakedObject"), engine.newQObject(object));
+    QJSValue result = engine.evaluate(QStringLiteral(
+            "function makeClosure() {\n"
+            "    var retained = { payload: 'heap snapshot payload' };\n"
+            "    return function retainer() { return retained; };\n"
+            "}\n"
+            "var closure = makeClosure();\n"
+            "closure().payload;"));
+    QCOMPARE(result.toString(), QStringLiteral("heap snapshot payload"));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath(QStringLiteral("test.heapsnapshot"));
+    QVERIFY(QJSEnginePrivate::writeHeapSnapshot(&engine, fileName));
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonParseError error;
+    const QJsonObject snapshot = QJsonDocument::fromJson(file.readAll(), &error).object();
+    QCOMPARE(error.error, QJsonParseError::NoError);
+
+    const QJsonObject meta = snapshot.value(QLatin1String("snapshot")).toObject();
+    const QJsonArray nodes = snapshot.value(QLatin1String("nodes")).toArray();
+    const QJsonArray edges = snapshot.value(QLatin1String("edges")).toArray();
+    const QJsonArray strings = snapshot.value(QLatin1String("strings")).toArray();
+    const int nodeFields = meta.value(QLatin1String("meta")).toObject()
+            .value(QLatin1String("node_fields")).toArray().size();
+    QCOMPARE(nodeFields, 6);
+    QCOMPARE(nodes.size(), meta.value(QLatin1String("node_count")).toInt() * nodeFields);
+    QCOMPARE(edges.size(), meta.value(QLatin1String("edge_count")).toInt() * 3);
+
+    // the edge counts of the nodes add up to the edges, which all point to nodes
+    int edgeCount = 0;
+    QHash<QString, int> nodeByName;
+    for (int i = 0; i < nodes.size(); i += nodeFields) {
+        edgeCount += nodes.at(i + 4).toInt();
+        nodeByName.insert(strings.at(nodes.at(i + 1).toInt()).toString(), i);
+    }
+    QCOMPARE(edgeCount * 3, edges.size());
+    for (int i = 0; i < edges.size(); i += 3) {
+        const int to = edges.at(i + 2).toInt();
+        QVERIFY(to % nodeFields == 0 && to < nodes.size());
+    }
+
+    QVERIFY(nodeByName.contains(QStringLiteral("(JS stack)")));
+    QVERIFY(nodeByName.contains(QStringLiteral("(Persistent values)")));
+    QVERIFY(nodeByName.contains(QStringLiteral("retainer")));
+    QVERIFY(nodeByName.contains(QStringLiteral("heap snapshot payload")));
+    QVERIFY(nodeByName.contains(QStringLiteral("QObject (leaked)")));
+}
+
+void tst_qv4mm::gcPacing()
+{
+    QJSEngine engine;
+    QV4::MemoryManager *mm = QV8Engine::getV4(&engine)->memoryManager;
+
+    QCOMPARE(QJSEnginePrivate::garbageCollectionGrowthFactor(&engine), 2.0);
+    QJSEnginePrivate::setGarbageCollectionGrowthFactor(&engine, 1.5);
+    QCOMPARE(QJSEnginePrivate::garbageCollectionGrowthFactor(&engine), 1.5);
+    QJSEnginePrivate::setGarbageCollectionGrowthFactor(&engine, 0.5);
+    QCOMPARE(QJSEnginePrivate::garbageCollectionGrowthFactor(&engine), 1.1);
+
+    // The heap stays around the limit when allocating lots of garbage
+    const qint64 limit = 2 * 1024 * 1024;
+    QJSEnginePrivate::setMaximumHeapSize(&engine, limit);
+    QCOMPARE(QJSEnginePrivate::maximumHeapSize(&engine), limit);
+    QJSValue result = engine.evaluate(QStringLiteral(
+            "var sum = 0;\n"
+            "for (var i = 0; i < 500000; ++i)\n"
+            "    sum += { index: i, next: { index: i + 1 } }.next.index;\n"
+            "sum;"));
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(mm->getAllocatedMem() < size_t(2 * limit));
+    QJSEnginePrivate::setMaximumHeapSize(&engine, 0);
+
+    // Without a receiver, collections don't post any events.
+    QJSEngineGarbageCollectionNotifier *notifier
+            = QJSEnginePrivate::garbageCollectionNotifier(&engine);
+    engine.collectGarbage();
+    QSignalSpy collections(notifier, &QJSEngineGarbageCollectionNotifier::garbageCollected);
+    QCoreApplication::processEvents();
+    QCOMPARE(collections.count(), 0);
+
+    engine.collectGarbage();
+    QVERIFY(mm->lastGCPause() > 0);
+    QTRY_COMPARE(collections.count(), 1);
+    QCOMPARE(collections.first().at(0).toLongLong(), mm->lastGCPause());
+
+    // Nothing was allocated since, so there's nothing to do when idle.
+    QVERIFY(!QJSEnginePrivate::collectGarbageWhenIdle(&engine, 10));
+    // "Cheap" means within the frame budget, if that's more than a millisecond.
+    QJSEnginePrivate::setGarbageCollectionFrameBudget(&engine, 1000);
+    QVERIFY(QJSEnginePrivate::collectGarbageIfCheap(&engine));
+    QTRY_COMPARE(collections.count(), 2);
+}
+
+void tst_qv4mm::growHugeArrays()
+{
+    QJSEngine engine;
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(&engine);
+    QV4::Scope scope(v4);
+    QV4::ScopedString name(scope, v4->newString(QStringLiteral("data")));
+
+    QJSValue result = engine.evaluate(QStringLiteral(
+            "var data = [];\n"
+            "for (var i = 0; i < 20000; ++i)\n"
+            "    data.push(i);\n"
+            "data.shift();"));
+    QCOMPARE(result.toInt(), 0);
+    QV4::ScopedObject data(scope, v4->globalObject->get(name));
+    QVERIFY(!!data);
+    QV4::Heap::ArrayData *hugeData = data->arrayData();
+    QVERIFY(hugeData->alloc * sizeof(QV4::Value) > QV4::Chunk::DataSize);
+
+    // Fill the array up to wrap around the ring buffer, then grow it further
+    result = engine.evaluate(QStringLiteral(
+            "for (var i = 20000; i < 60000; ++i)\n"
+            "    data.push(i);\n"
+            "var ok = data.length === 59999;\n"
+            "for (var i = 0; i < data.length; ++i)\n"
+            "    ok = ok && data[i] === i + 1;\n"
+            "ok;"));
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(result.toBool());
+#if QT_POINTER_SIZE == 8
+    QCOMPARE(data->arrayData(), hugeData);
+#endif
+}
+
+void tst_qv4mm::packedArrays()
+{
+    QJSEngine engine;
+    engine.installExtensions(QJSEngine::GarbageCollectionExtension);
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(&engine);
+    QV4::Scope scope(v4);
+
+    QJSValue result = engine.evaluate(QStringLiteral(
+            "var ints = [];\n"
+            "for (var i = 0; i < 100; ++i)\n"
+            "    ints.push(i);\n"
+            "var doubles = [0.5, 1, 2];\n"
+            "var holes = [1, 2];\n"
+            "holes[5] = 6;\n"
+            "var objects = [1, {}];"));
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+
+    auto elementKind = [&](const char *name) {
+        QV4::ScopedString s(scope, v4->newString(QString::fromLatin1(name)));
+        QV4::ScopedObject o(scope, v4->globalObject->get(s));
+        return o->arrayData()->elementKind;
+    };
+    QCOMPARE(elementKind("ints"), QV4::Heap::ArrayData::PackedInt32);
+    QCOMPARE(elementKind("doubles"), QV4::Heap::ArrayData::PackedDouble);
+    QCOMPARE(elementKind("holes"), QV4::Heap::ArrayData::Generic);
+    QCOMPARE(elementKind("objects"), QV4::Heap::ArrayData::Generic);
+
+    // Objects stored into a packed array need to be marked from then on
+    result = engine.evaluate(QStringLiteral(
+            "ints[50] = { value: 42 };\n"
+            "gc();\n"
+            "var junk = [];\n"
+            "for (var i = 0; i < 1000; ++i)\n"
+            "    junk.push({ value: i });\n"
+            "ints[50].value === 42 && ints[49] === 49 && holes[3] === undefined;"));
+    QVERIFY2(!result.isError(), qPrintable(result.toString()));
+    QVERIFY(result.toBool());
+    QCOMPARE(elementKind("ints"), QV4::Heap::ArrayData::Generic);
+}
+
 QTEST_MAIN(tst_qv4mm)
 
 #include "tst_qv4mm.moc"
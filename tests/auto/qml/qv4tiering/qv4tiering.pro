@@ -0,0 +1,7 @@
+CONFIG += testcase
+TARGET = tst_qv4tiering
+osx:CONFIG -= app_bundle
+
+SOURCES += tst_qv4tiering.cpp
+
+QT += qml qml-private testlib
@@ -0,0 +1,225 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <qtest.h>
+#include <QJSEngine>
+#include <private/qjsvalue_p.h>
+#include <private/qv4engine_p.h>
+#include <private/qv4function_p.h>
+#include <private/qv4functionobject_p.h>
+#include <private/qv4scopedvalue_p.h>
+#include <private/qv4tiering_p.h>
+#include <private/qv8engine_p.h>
+
+// Tiering is configured once per process, when the first engine is created. That's why these
+// tests live in their own binary: they need QV4_JIT_TIERING set before that happens.
+class tst_qv4tiering : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void tieredExecution_data();
+    void tieredExecution();
+    void coldFunctions();
+    void typeFeedback_data();
+    void typeFeedback();
+};
+
+enum {
+    CallThreshold = 10,
+    LoopThreshold = 100
+};
+
+static QV4::Function *v4Function(QJSEngine *engine, const QString &name)
+{
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(engine);
+    QV4::Scope scope(v4);
+    QV4::ScopedFunctionObject function(
+                scope, QJSValuePrivate::convertedToValue(v4, engine->globalObject().property(name)));
+    return function ? function->function() : nullptr;
+}
+
+void tst_qv4tiering::initTestCase()
+{
+    qputenv("QV4_JIT_TIERING", "1");
+    qputenv("QV4_JIT_CALL_THRESHOLD", QByteArray::number(CallThreshold));
+    qputenv("QV4_JIT_LOOP_THRESHOLD", QByteArray::number(LoopThreshold));
+
+    QJSEngine engine;
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(&engine);
+    if (!v4->tiering)
+        QSKIP("The JIT is not available, so there is nothing to tier up to.");
+    QCOMPARE(v4->tiering->callThreshold, uint(CallThreshold));
+    QCOMPARE(v4->tiering->backEdgeThreshold, uint(LoopThreshold));
+}
+
+// These functions start out in the interpreter and get promoted to the JIT while they run.
+// The function in the "promoted" column has to end up in the JIT tier.
+void tst_qv4tiering::tieredExecution_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<QString>("expected");
+    QTest::addColumn<QString>("promoted");
+
+    QTest::newRow("calls")
+            << "function add(a, b) { return a + b; }\n"
+               "var s = 0; for (var i = 0; i < 200; ++i) s = add(s, i); s"
+            << "19900" << "add";
+    QTest::newRow("loop")
+            << "function sum(n) { var s = 0; for (var i = 0; i < n; ++i) s += i; return s; }\n"
+               "[sum(5000), sum(10)].join()"
+            << "12497500,45" << "sum";
+    QTest::newRow("recursion")
+            << "function fib(n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }\n"
+               "fib(15)"
+            << "610" << "fib";
+    QTest::newRow("closures")
+            << "function counter() { var n = 0; return function() { return ++n; }; }\n"
+               "var c; for (var i = 0; i < 100; ++i) c = counter(); c(); c()"
+            << "2" << "counter";
+    QTest::newRow("exception")
+            << "function check(i) { if (i == 150) throw new RangeError('at ' + i); return i; }\n"
+               "var r; try { for (var i = 0; i < 200; ++i) check(i); } catch (e) { r = e.toString(); } r"
+            << "RangeError: at 150" << "check";
+    QTest::newRow("strict")
+            << "function f() { 'use strict'; return this === undefined; }\n"
+               "var ok = true; for (var i = 0; i < 100; ++i) ok = ok && f(); ok"
+            << "true" << "f";
+    QTest::newRow("Function constructor")
+            << "var f = new Function('a', 'b', 'return a * b;');\n"
+               "var s = 0; for (var i = 0; i < 100; ++i) s += f(i, 2); s"
+            << "9900" << "f";
+    QTest::newRow("eval")
+            << "function g(n) { return eval('(function(k) { var t = 0; for (var j = 0; j < k; ++j) t += j + n; return t; })'); }\n"
+               "var h = g(1); [h(3000), h(4)].join()"
+            << "4501500,10" << "h";
+}
+
+void tst_qv4tiering::tieredExecution()
+{
+    QFETCH(QString, code);
+    QFETCH(QString, expected);
+    QFETCH(QString, promoted);
+
+    QJSEngine engine;
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(&engine);
+    QJSValue result = engine.evaluate(code);
+    QCOMPARE(result.toString(), expected);
+
+    QV4::Function *function = v4Function(&engine, promoted);
+    QVERIFY(function);
+    QCOMPARE(function->tier, QV4::Function::JitTier);
+    QVERIFY(v4->tiering->promotedFunctions > 0);
+    QVERIFY(v4->tiering->compiledUnits > 0);
+}
+
+void tst_qv4tiering::coldFunctions()
+{
+    QJSEngine engine;
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(&engine);
+    QJSValue result = engine.evaluate(
+                "function cold(n) { var s = 0; for (var i = 0; i < n; ++i) s += i; return s; }\n"
+                "[cold(3), cold(4)].join()");
+    QCOMPARE(result.toString(), QStringLiteral("3,6"));
+
+    QV4::Function *function = v4Function(&engine, QStringLiteral("cold"));
+    QVERIFY(function);
+    QCOMPARE(function->tier, QV4::Function::InterpreterTier);
+    QCOMPARE(function->invocationCount, 2u);
+    QVERIFY(function->backEdgeCount > 0);
+    QVERIFY(function->backEdgeCount < uint(LoopThreshold));
+    QCOMPARE(v4->tiering->promotedFunctions, 0u);
+}
+
+// The interpreter records the operand types of these functions until they are promoted. The
+// JIT code is specialized for the recorded types, and has to fall back to the generic
+// operations when it sees different types afterwards.
+void tst_qv4tiering::typeFeedback_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<QString>("expected");
+    QTest::addColumn<QString>("promoted");
+    QTest::addColumn<int>("observed");
+
+    QTest::newRow("numeric comparison, then other types")
+            << "function lt(a, b) { if (a < b) return 1; return 0; }\n"
+               "var n = 0; for (var i = 0; i < 200; ++i) n += lt(i, 100.5);\n"
+               "[n, lt('a', 'b'), lt('b', 'a'), lt(1, '2'), lt(NaN, 1), lt(1, NaN), lt({ valueOf: function() { return 0; } }, 1)].join()"
+            << "101,1,0,1,0,0,1" << "lt" << int(QV4::Tiering::ObservedNumber);
+    QTest::newRow("string additions, then numbers")
+            << "function add(a, b) { return a + b; }\n"
+               "var s; for (var i = 0; i < 200; ++i) s = add('x', i);\n"
+               "[s, add(1, 2), add(0.5, 1), add(1, '2')].join()"
+            << "x199,3,1.5,12"
+            << "add" << int(QV4::Tiering::ObservedString | QV4::Tiering::ObservedInteger);
+    QTest::newRow("numeric additions, then other types")
+            << "function add(a, b) { return a + b; }\n"
+               "var s = 0; for (var i = 0; i < 200; ++i) s = add(s, i + 0.5);\n"
+               "[s, add('a', 1), add(1, 'a'), add({ valueOf: function() { return 2; } }, 1), add(1, null), add(true, 1), add(undefined, 1), add(2147483647, 1)].join()"
+            << "20000,a1,1a,3,1,2,NaN,2147483648"
+            << "add" << int(QV4::Tiering::ObservedNumber);
+    QTest::newRow("numeric divisions, then other types")
+            << "function div(a, b) { return a / b; }\n"
+               "var s = 0; for (var i = 0; i < 200; ++i) s += div(i, 4);\n"
+               "[s, div('9', 3), div({ valueOf: function() { return 8; } }, 2), div(1, 0), div(null, 2), div('x', 2)].join()"
+            << "4975,3,4,Infinity,0,NaN"
+            << "div" << int(QV4::Tiering::ObservedInteger);
+    QTest::newRow("integer comparison in a hot loop, then strings")
+            << "function count(a, n) { var k = 0; for (var i = 0; i < n; ++i) if (a[i] < a[i + 1]) ++k; return k; }\n"
+               "var a = []; for (var i = 0; i < 500; ++i) a.push(i % 7);\n"
+               "[count(a, 499), count(['b', 'a', 'c', 'd'], 3), count([1, '10', '9', 2], 3)].join()"
+            << "428,2,2"
+            << "count" << int(QV4::Tiering::ObservedInteger);
+}
+
+void tst_qv4tiering::typeFeedback()
+{
+    QFETCH(QString, code);
+    QFETCH(QString, expected);
+    QFETCH(QString, promoted);
+    QFETCH(int, observed);
+
+    QJSEngine engine;
+    QJSValue result = engine.evaluate(code);
+    QCOMPARE(result.toString(), expected);
+
+    QV4::Function *function = v4Function(&engine, promoted);
+    QVERIFY(function);
+    QCOMPARE(function->tier, QV4::Function::JitTier);
+
+    // Only the types seen before the promotion are recorded.
+    int recorded = 0;
+    for (quint8 types : qAsConst(function->typeFeedback))
+        recorded |= types;
+    QCOMPARE(recorded, observed);
+}
+
+QTEST_MAIN(tst_qv4tiering)
+
+#include "tst_qv4tiering.moc"
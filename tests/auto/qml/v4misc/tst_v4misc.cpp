@@ -31,6 +31,10 @@
 
 #define V4_AUTOTEST
 #include <private/qv4ssa_p.h>
+#include <private/qv4codegen_p.h>
+#include <private/qqmljsengine_p.h>
+#include <private/qqmljslexer_p.h>
+#include <private/qqmljsparser_p.h>
 
 class tst_v4misc: public QObject
 {
@@ -45,6 +49,15 @@ private slots:
 
     void moveMapping_1();
     void moveMapping_2();
+
+    void inlining_data();
+    void inlining();
+    void scalarReplacement_data();
+    void scalarReplacement();
+    void inductionVariables_data();
+    void inductionVariables();
+    void loopInvariantCodeMotion_data();
+    void loopInvariantCodeMotion();
 };
 
 using namespace QT_PREPEND_NAMESPACE(QV4::IR);
@@ -227,6 +240,247 @@ void tst_v4misc::moveMapping_2()
     QVERIFY(mapping._moves.at(9).needsSwap);
 }
 
+// Compiles the source to IR and runs the optimizer over every function in it, the way the
+// instruction selection does. The functions are left in SSA form.
+template <typename Count>
+static int optimize(const QString &source, Count count)
+{
+    QQmlJS::Engine ee;
+    QQmlJS::Lexer lexer(&ee);
+    lexer.setCode(source, /*line*/1, /*qml mode*/false);
+    QQmlJS::Parser parser(&ee);
+    if (!parser.parseProgram())
+        return -1;
+
+    Module module(/*debugMode*/false);
+    QQmlJS::Codegen cg(/*strict mode*/false);
+    cg.generateFromProgram(QStringLiteral("test.js"), source,
+                           QQmlJS::AST::cast<QQmlJS::AST::Program *>(parser.rootNode()), &module);
+    if (!cg.qmlErrors().isEmpty())
+        return -1;
+
+    int total = 0;
+    for (Function *function : qAsConst(module.functions)) {
+        Optimizer opt(function);
+        opt.run(/*qmlEngine*/nullptr);
+        total += count(opt, function);
+    }
+    return total;
+}
+
+// Counts the int32 phis in loop headers that get an int32 addition from the back edge.
+static int int32LoopCounters(Function *function)
+{
+    QHash<unsigned, Move *> definitions;
+    for (BasicBlock *bb : function->basicBlocks()) {
+        if (bb->isRemoved())
+            continue;
+        for (Stmt *s : bb->statements()) {
+            Move *m = s->asMove();
+            Temp *t = m ? m->target->asTemp() : nullptr;
+            if (t && t->kind == Temp::VirtualRegister)
+                definitions.insert(t->index, m);
+        }
+    }
+
+    int counters = 0;
+    for (BasicBlock *bb : function->basicBlocks()) {
+        if (bb->isRemoved() || !bb->isGroupStart())
+            continue;
+        for (Stmt *s : bb->statements()) {
+            Phi *phi = s->asPhi();
+            if (!phi)
+                break;
+            if (phi->targetTemp->type != SInt32Type)
+                continue;
+            for (Expr *incoming : phi->incoming) {
+                Temp *t = incoming->asTemp();
+                Move *m = t && t->kind == Temp::VirtualRegister ? definitions.value(t->index) : nullptr;
+                Binop *add = m ? m->source->asBinop() : nullptr;
+                if (add && add->op == OpAdd && add->type == SInt32Type
+                        && m->target->type == SInt32Type) {
+                    ++counters;
+                    break;
+                }
+            }
+        }
+    }
+    return counters;
+}
+
+// The results of these are checked in tst_QJSEngine::inlinedFunctionCalls(). This checks that
+// the calls that can be inlined actually are, and the others aren't.
+void tst_v4misc::inlining_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<bool>("inlined");
+
+    QTest::newRow("simple")
+            << "(function() { function sq(x) { return x * x; }\n"
+               "  var s = 0; for (var i = 0; i < 10; ++i) s += sq(i); return s; })()"
+            << true;
+    QTest::newRow("outer variables")
+            << "(function(n) { var count = 0; function inc(by) { count += by; return count; }\n"
+               "  inc(n); inc(2); return inc(n) + ',' + count + ',' + n; })(3)"
+            << true;
+    QTest::newRow("nested helpers")
+            << "(function() { function add(a, b) { return a + b; }\n"
+               "  function mul(a, b) { var r = 0; for (var i = 0; i < b; ++i) r = add(r, a); return r; }\n"
+               "  function sq(x) { return mul(x, x); }\n"
+               "  return sq(7); })()"
+            << true;
+    QTest::newRow("reassigned function")
+            << "(function() { function f() { return 1; } var a = f(); f = function() { return 2; };\n"
+               "  return a + f(); })()"
+            << false;
+    QTest::newRow("reassigned by nested function")
+            << "(function() { function f() { return 1; }\n"
+               "  function g() { f = function() { return 2; }; }\n"
+               "  var a = f(); g(); return a + f(); })()"
+            << false;
+    QTest::newRow("reassigned by eval")
+            << "(function() { function f() { return 1; }\n"
+               "  var a = f(); eval('f = function() { return 2; }'); return a + f(); })()"
+            << false;
+    QTest::newRow("uses this")
+            << "(function() { function f() { return this; } return typeof f(); })()"
+            << false;
+}
+
+void tst_v4misc::inlining()
+{
+    QFETCH(QString, code);
+    QFETCH(bool, inlined);
+
+    const int inlinedCalls = optimize(code, [](const Optimizer &opt, Function *) {
+        return opt.inlinedCallCount();
+    });
+    QVERIFY(inlinedCalls >= 0);
+    QCOMPARE(inlinedCalls > 0, inlined);
+}
+
+// The results of these are checked in tst_QJSEngine::nonEscapingObjectLiterals(). This checks
+// that the allocations of object literals that don't escape are actually gone.
+void tst_v4misc::scalarReplacement_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<int>("replaced");
+
+    QTest::newRow("reads")
+            << "(function(a, b) { var p = {x: a, y: b, z: 3}; return p.x * p.y + p.z; })(4, 5)"
+            << 1;
+    QTest::newRow("loop")
+            << "(function() { var s = 0;\n"
+               "  for (var i = 0; i < 10; ++i) { var p = {x: i, y: i + 1}; s += p.x * p.y; }\n"
+               "  return s; })()"
+            << 1;
+    QTest::newRow("inlined constructor")
+            << "(function() { function point(x, y) { return {x: x, y: y}; }\n"
+               "  var p = point(2, 3); return p.x + p.y; })()"
+            << 1;
+    QTest::newRow("missing property")
+            << "(function() { var p = {x: 1}; return typeof p.y + ',' + typeof p.toString; })()"
+            << 0;
+    QTest::newRow("written")
+            << "(function() { var p = {x: 1}; p.x = 2; return p.x; })()"
+            << 0;
+    QTest::newRow("escaping")
+            << "(function() { var p = {x: 1}; var q = p; q.x = 3; return p.x; })()"
+            << 0;
+    QTest::newRow("accessor")
+            << "(function() { var n = 0; var p = {get x() { return ++n; }}; p.x; return p.x; })()"
+            << 0;
+    QTest::newRow("array entries")
+            << "(function() { var p = {0: 'a', length: 1}; return Array.prototype.join.call(p); })()"
+            << 0;
+}
+
+void tst_v4misc::scalarReplacement()
+{
+    QFETCH(QString, code);
+    QFETCH(int, replaced);
+
+    QCOMPARE(optimize(code, [](const Optimizer &opt, Function *) {
+                 return opt.replacedAllocationCount();
+             }), replaced);
+}
+
+// The results of these are checked in tst_QJSEngine::loopCounters(). This checks that only
+// counters that can't overflow in the loop get typed as int32.
+void tst_v4misc::inductionVariables_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<int>("counters");
+
+    QTest::newRow("int32 bound")
+            << "(function() { var n = 100; var s = 0;\n"
+               "  for (var i = 0; i < n; ++i) s += i; return s; })()"
+            << 1;
+    QTest::newRow("reversed condition")
+            << "(function() { var n = 100; var s = 0;\n"
+               "  for (var i = 0; n > i; i++) s += i; return s; })()"
+            << 1;
+    QTest::newRow("less or equal")
+            << "(function() { var n = 100; var s = 0;\n"
+               "  for (var i = 0; i <= n; ++i) s += i; return s; })()"
+            << 0;
+    QTest::newRow("double bound")
+            << "(function() { var n = 100.5; var s = 0;\n"
+               "  for (var i = 0; i < n; ++i) s += i; return s; })()"
+            << 0;
+    QTest::newRow("modified in body")
+            << "(function() { var n = 100; var s = 0;\n"
+               "  for (var i = 0; i < n; ++i) { if (i === 5) i += 10; s += i; } return s; })()"
+            << 0;
+}
+
+void tst_v4misc::inductionVariables()
+{
+    QFETCH(QString, code);
+    QFETCH(int, counters);
+
+    QCOMPARE(optimize(code, [](const Optimizer &, Function *function) {
+                 return int32LoopCounters(function);
+             }), counters);
+}
+
+// The results of these are checked in tst_QJSEngine::loopCounters().
+void tst_v4misc::loopInvariantCodeMotion_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<bool>("hoisted");
+
+    QTest::newRow("invariant product")
+            << "(function(a) { var x = +a; var s = 0;\n"
+               "  for (var i = 0; i < 10; ++i) s += x * 2; return s; })(3)"
+            << true;
+    QTest::newRow("nested loops")
+            << "(function(a) { var x = +a; var s = 0;\n"
+               "  for (var i = 0; i < 10; ++i) for (var j = 0; j < 10; ++j) s += x * 2;\n"
+               "  return s; })(3)"
+            << true;
+    QTest::newRow("depends on counter")
+            << "(function(a) { var x = +a; var s = 0;\n"
+               "  for (var i = 0; i < 10; ++i) s += x * i; return s; })(3)"
+            << false;
+    QTest::newRow("not a number")
+            << "(function(o) { var s = 0;\n"
+               "  for (var i = 0; i < 10; ++i) s += o.x * 2; return s; })({x: 3})"
+            << false;
+}
+
+void tst_v4misc::loopInvariantCodeMotion()
+{
+    QFETCH(QString, code);
+    QFETCH(bool, hoisted);
+
+    const int hoistedStatements = optimize(code, [](const Optimizer &opt, Function *) {
+        return opt.hoistedStatementCount();
+    });
+    QVERIFY(hoistedStatements >= 0);
+    QCOMPARE(hoistedStatements > 0, hoisted);
+}
+
 QTEST_MAIN(tst_v4misc)
 
 #include "tst_v4misc.moc"
@@ -0,0 +1,20 @@
+// Benchmarks a tight numeric loop over an array, with the length read in the condition.
+
+import QtQuick 2.0
+
+QtObject {
+    property var values: []
+
+    Component.onCompleted: {
+        for (var ii = 0; ii < 10000; ++ii)
+            values.push(ii % 97);
+    }
+
+    function runtest() {
+        var arr = values;
+        var sum = 0;
+        for (var ii = 0; ii < arr.length; ++ii)
+            sum += arr[ii];
+        return sum;
+    }
+}
@@ -0,0 +1,23 @@
+// Benchmarks a tight numeric loop over an array, with an int32 loop bound and a loop-invariant
+// calculation in the body.
+
+import QtQuick 2.0
+
+QtObject {
+    property var values: []
+
+    Component.onCompleted: {
+        for (var ii = 0; ii < 10000; ++ii)
+            values.push(ii % 97);
+    }
+
+    function runtest() {
+        var arr = values;
+        var n = arr.length | 0;
+        var scale = 3;
+        var sum = 0;
+        for (var ii = 0; ii < n; ++ii)
+            sum += arr[ii] * (scale * 2 + 1);
+        return sum;
+    }
+}
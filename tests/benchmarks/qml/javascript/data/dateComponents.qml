@@ -0,0 +1,25 @@
+// Benchmarks converting timestamps to local time, like when formatting a table of dates.
+
+import QtQuick 2.0
+
+QtObject {
+    property var timestamps: []
+
+    Component.onCompleted: {
+        // spread over a few years, to cross daylight saving time transitions
+        var t = Date.UTC(2015, 0, 1);
+        for (var ii = 0; ii < 10000; ++ii) {
+            timestamps.push(new Date(t));
+            t += 3 * 60 * 60 * 1000 + 17 * 60 * 1000;
+        }
+    }
+
+    function runtest() {
+        var sum = 0;
+        for (var ii = 0; ii < timestamps.length; ++ii) {
+            var d = timestamps[ii];
+            sum += d.getFullYear() + d.getMonth() + d.getDate() + d.getHours() + d.getMinutes();
+        }
+        return sum;
+    }
+}
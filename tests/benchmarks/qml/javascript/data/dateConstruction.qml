@@ -0,0 +1,12 @@
+// Benchmarks creating dates from local time components.
+
+import QtQuick 2.0
+
+QtObject {
+    function runtest() {
+        for (var ii = 0; ii < 10000; ++ii) {
+            var d = new Date(2017, ii % 12, ii % 28 + 1, ii % 24, ii % 60);
+            d.setHours(ii % 24 + 1);
+        }
+    }
+}
@@ -3,6 +3,7 @@ SUBDIRS = \
         qjsengine \
         qjsvalue \
         qjsvalueiterator \
+        json \
 
 TRUSTED_BENCHMARKS += \
     qjsvalue \
@@ -0,0 +1,7 @@
+CONFIG += benchmark
+TEMPLATE = app
+TARGET = tst_bench_json
+
+SOURCES += tst_json.cpp
+
+QT = core qml testlib
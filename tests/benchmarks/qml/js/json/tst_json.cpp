@@ -0,0 +1,123 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <qtest.h>
+#include <QtCore/qjsondocument.h>
+#include <QtQml/qjsengine.h>
+#include <QtQml/qjsvalue.h>
+
+class tst_json : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parse_data();
+    void parse();
+    void parseReference_data();
+    void parseReference();
+};
+
+static QString records(int count, bool indented)
+{
+    // a REST style payload: a list of records with the same keys
+    QString json = QStringLiteral("[");
+    const QString separator = indented ? QStringLiteral("\n    ") : QString();
+    for (int i = 0; i < count; ++i) {
+        if (i)
+            json += QLatin1Char(',');
+        json += separator + QStringLiteral("{") + separator;
+        json += QStringLiteral("\"id\": %1,").arg(i) + separator;
+        json += QStringLiteral("\"name\": \"record %1\",").arg(i) + separator;
+        json += QStringLiteral("\"price\": %1,").arg(i * 0.25) + separator;
+        json += QStringLiteral("\"active\": %1,").arg(i % 2 ? QStringLiteral("true") : QStringLiteral("false")) + separator;
+        json += QStringLiteral("\"tags\": [\"a\", \"b\", \"c\"],") + separator;
+        json += QStringLiteral("\"description\": \"line one\\nline \\\"two\\\" \\u00e9\",") + separator;
+        json += QStringLiteral("\"location\": { \"lat\": 52.52, \"lon\": 13.405 }") + separator;
+        json += QStringLiteral("}");
+    }
+    json += QStringLiteral("]");
+    return json;
+}
+
+static void addRows()
+{
+    QTest::addColumn<QString>("json");
+
+    QTest::newRow("records 10") << records(10, false);
+    QTest::newRow("records 10000") << records(10000, false);
+    QTest::newRow("indented records 10000") << records(10000, true);
+
+    QString strings = QStringLiteral("[");
+    for (int i = 0; i < 1000; ++i) {
+        if (i)
+            strings += QLatin1Char(',');
+        strings += QLatin1Char('"') + QString(200, QLatin1Char('x')) + QLatin1Char('"');
+    }
+    strings += QStringLiteral("]");
+    QTest::newRow("long strings") << strings;
+}
+
+void tst_json::parse_data()
+{
+    addRows();
+}
+
+void tst_json::parse()
+{
+    QFETCH(QString, json);
+
+    QJSEngine engine;
+    QJSValue parse = engine.globalObject().property(QStringLiteral("JSON")).property(QStringLiteral("parse"));
+    QJSValueList args;
+    args << QJSValue(json);
+    QVERIFY(parse.call(args).isArray());
+
+    QBENCHMARK {
+        parse.call(args);
+    }
+}
+
+void tst_json::parseReference_data()
+{
+    addRows();
+}
+
+void tst_json::parseReference()
+{
+    QFETCH(QString, json);
+    const QByteArray utf8 = json.toUtf8();
+    QVERIFY(QJsonDocument::fromJson(utf8).isArray());
+
+    QBENCHMARK {
+        QJsonDocument::fromJson(utf8);
+    }
+}
+
+QTEST_MAIN(tst_json)
+
+#include "tst_json.moc"
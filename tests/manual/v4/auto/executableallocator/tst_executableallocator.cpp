@@ -43,6 +43,8 @@ private slots:
     void mergeNext();
     void mergePrev();
     void multipleChunks();
+    void reuseFreeBlock();
+    void statistics();
 };
 
 void tst_ExecutableAllocator::singleAlloc()
@@ -120,5 +122,61 @@ void tst_ExecutableAllocator::multipleChunks()
     QCOMPARE(allocator.freeAllocationCount(), 0);
 }
 
+void tst_ExecutableAllocator::reuseFreeBlock()
+{
+    ExecutableAllocator allocator;
+
+    ExecutableAllocator::Allocation *first = allocator.allocate(100);
+    ExecutableAllocator::Allocation *second = allocator.allocate(200);
+    ExecutableAllocator::Allocation *third = allocator.allocate(10);
+    void *secondStart = second->start();
+
+    allocator.free(second);
+    QCOMPARE(allocator.freeAllocationCount(), 2);
+
+    // The freed block is the best fit, and gets split.
+    ExecutableAllocator::Allocation *fourth = allocator.allocate(150);
+    QCOMPARE(fourth->start(), secondStart);
+    QCOMPARE(allocator.freeAllocationCount(), 2);
+
+    ExecutableAllocator::Allocation *fifth = allocator.allocate(40);
+    QCOMPARE(fifth->start(), static_cast<void *>(static_cast<char *>(secondStart) + 160));
+    QCOMPARE(allocator.freeAllocationCount(), 1);
+
+    allocator.free(first);
+    allocator.free(third);
+    allocator.free(fourth);
+    allocator.free(fifth);
+    QCOMPARE(allocator.chunkCount(), 0);
+    QCOMPARE(allocator.freeAllocationCount(), 0);
+}
+
+void tst_ExecutableAllocator::statistics()
+{
+    ExecutableAllocator allocator;
+
+    ExecutableAllocator::Allocation *first = allocator.allocate(10);
+    ExecutableAllocator::Allocation *second = allocator.allocate(100);
+    ExecutableAllocator::Statistics stats = allocator.statistics();
+    QCOMPARE(stats.chunks, 1);
+    QCOMPARE(stats.used, size_t(16 + 112));
+    QVERIFY(stats.committed >= size_t(ExecutableAllocator::ChunkSize));
+    QCOMPARE(stats.largestFreeBlock, stats.committed - stats.used);
+    QCOMPARE(stats.fragmentation(), qreal(0));
+
+    allocator.free(first);
+    stats = allocator.statistics();
+    QCOMPARE(stats.used, size_t(112));
+    QCOMPARE(stats.peakUsed, size_t(128));
+    QCOMPARE(stats.freeBlocks, 2);
+    QVERIFY(stats.fragmentation() > 0);
+
+    allocator.free(second);
+    stats = allocator.statistics();
+    QCOMPARE(stats.committed, size_t(0));
+    QCOMPARE(stats.used, size_t(0));
+    QVERIFY(stats.peakCommitted >= size_t(ExecutableAllocator::ChunkSize));
+}
+
 QTEST_MAIN(tst_ExecutableAllocator)
 #include "tst_executableallocator.moc"
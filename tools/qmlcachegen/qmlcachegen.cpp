@@ -218,8 +218,8 @@ static bool compileQmlFile(const QString &inputFileName, const QString &outputFi
 
         QV4::ExecutableAllocator allocator;
         QScopedPointer<QV4::EvalInstructionSelection> isel(iselFactory->create(/*engine*/nullptr, &allocator, &irDocument.jsModule, &irDocument.jsGenerator));
-        // Disable lookups in non-standalone (aka QML) mode
-        isel->setUseFastLookups(false);
+        // Names are resolved through the QML context in non-standalone (aka QML) mode
+        isel->setUseGlobalLookups(false);
         irDocument.javaScriptCompilationUnit = isel->compile(/*generate unit*/false);
         QV4::CompiledData::Unit *unit = generator.generate(irDocument);
         unit->flags |= QV4::CompiledData::Unit::StaticData;
@@ -306,8 +306,8 @@ static bool compileJSFile(const QString &inputFileName, const QString &outputFil
 
         QV4::ExecutableAllocator allocator;
         QScopedPointer<QV4::EvalInstructionSelection> isel(iselFactory->create(/*engine*/nullptr, &allocator, &irDocument.jsModule, &irDocument.jsGenerator));
-        // Disable lookups in non-standalone (aka QML) mode
-        isel->setUseFastLookups(false);
+        // Names are resolved through the QML context in non-standalone (aka QML) mode
+        isel->setUseGlobalLookups(false);
         irDocument.javaScriptCompilationUnit = isel->compile(/*generate unit*/false);
         QV4::CompiledData::Unit *unit = generator.generate(irDocument);
         unit->flags |= QV4::CompiledData::Unit::StaticData;
@@ -67,7 +67,8 @@ static const char *features[] = {
     "binding",
     "handlingsignal",
     "inputevents",
-    "debugmessages"
+    "debugmessages",
+    "allocationstatistics"
 };
 
 Q_STATIC_ASSERT(sizeof(features) ==